@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Roger Pearce <rpearce@llnl.gov>.
+ * LLNL-CODE-644630.
+ * All rights reserved.
+ *
+ * This file is part of HavoqGT, Version 0.1.
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ *
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ *
+ * Our Preamble Notice
+ *
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ *
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ *
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ *
+ */
+
+#ifndef HAVOQGT_BINARY_EDGE_LIST_READER_INCLUDED
+#define HAVOQGT_BINARY_EDGE_LIST_READER_INCLUDED
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <algorithm>
+#include <stdint.h>
+
+#include <havoqgt/environment.hpp>
+#include <havoqgt/detail/mapped_file.hpp>
+
+namespace havoqgt {
+
+/// Header at the start of every binary edge list file.  The header is
+/// followed by edge_count records of little-endian uint64_t words:
+/// (source, target) or, when weighted, (source, target, weight).
+struct binary_edge_list_header {
+  static const uint64_t magic_value = 0x314C4554474F5648ULL;  // "HVOGTEL1"
+  static const uint64_t flag_weighted = 1;
+
+  uint64_t magic;
+  uint64_t flags;
+  uint64_t edge_count;
+  uint64_t max_vertex_id;
+
+  bool weighted() const { return flags & flag_weighted; }
+  uint64_t record_words() const { return weighted() ? 3 : 2; }
+};
+
+/// Binary edge list reader
+///
+/// Reads files written in the binary_edge_list_header format directly from
+/// a read-only mapping: no parsing, and since the headers carry the edge
+/// count and max vertex id, no first pass over the edges.  The edges of all
+/// files form one sequence that is split evenly across ranks.  Provides the
+/// same container interface as parallel_edge_list_reader.
+class binary_edge_list_reader {
+
+public:
+  typedef uint64_t                      vertex_descriptor;
+  typedef std::pair<uint64_t, uint64_t> edge_type;
+
+  /// Contiguous run of records in one mapped file owned by this rank
+  struct edge_segment {
+    const uint64_t* records;
+    uint64_t        count;
+  };
+
+  ///
+  /// InputIterator class for binary_edge_list_reader
+
+  class input_iterator_type : public std::iterator<std::input_iterator_tag, edge_type, ptrdiff_t, const edge_type*, const edge_type&> {
+
+  public:
+    input_iterator_type(const binary_edge_list_reader* ptr_reader, uint64_t count)
+      : m_ptr_reader(ptr_reader)
+      , m_count(count)
+      , m_segment(0)
+      , m_offset(0) {
+      if(m_count == 0) {
+        load();
+      }
+    }
+
+    const edge_type& operator*() const { return m_current; }
+
+    input_iterator_type& operator++() {
+      get_next();
+      return *this;
+    }
+
+    input_iterator_type operator++(int) {
+      input_iterator_type __tmp = *this;
+      get_next();
+      return __tmp;
+    }
+
+    const edge_type *operator->() const {
+      return &m_current;
+    }
+
+    /// Weight of the current edge; 1 if the input is unweighted.
+    uint64_t weight() const {
+      if(m_ptr_reader->weighted()) {
+        return record()[2];
+      }
+      return 1;
+    }
+
+    bool is_equal(const input_iterator_type& _x) const {
+      return m_count == (_x.m_count);
+    }
+
+    ///  Return true if x and y are both end or not end, or x and y are the same.
+    friend bool
+    operator==(const input_iterator_type& x, const input_iterator_type& y)
+    { return x.is_equal(y); }
+
+    ///  Return false if x and y are both end or not end, or x and y are the same.
+    friend bool
+    operator!=(const input_iterator_type& x, const input_iterator_type& y)
+    { return !x.is_equal(y); }
+
+  private:
+    input_iterator_type();
+
+    const uint64_t* record() const {
+      const edge_segment& seg = m_ptr_reader->m_segments[m_segment];
+      return seg.records + m_offset * m_ptr_reader->m_record_words;
+    }
+
+    void get_next() {
+      ++m_count;
+      ++m_offset;
+      load();
+    }
+
+    /// Skips exhausted segments and copies out the current record.
+    void load() {
+      const std::vector<edge_segment>& segments = m_ptr_reader->m_segments;
+      while(m_segment < segments.size() && m_offset == segments[m_segment].count) {
+        ++m_segment;
+        m_offset = 0;
+      }
+      if(m_segment < segments.size()) {
+        const uint64_t* rec = record();
+        m_current.first  = rec[0];
+        m_current.second = rec[1];
+        assert(m_current.first <= m_ptr_reader->max_vertex_id());
+        assert(m_current.second <= m_ptr_reader->max_vertex_id());
+      }
+    }
+
+    const binary_edge_list_reader* m_ptr_reader;
+    uint64_t  m_count;
+    size_t    m_segment;
+    uint64_t  m_offset;
+    edge_type m_current;
+  };
+
+
+  binary_edge_list_reader(const std::vector< std::string >& filenames ) {
+    int mpi_rank = havoqgt_env()->world_comm().rank();
+    int mpi_size = havoqgt_env()->world_comm().size();
+    m_local_edge_count = 0;
+    m_global_max_vertex = 0;
+    m_record_words = 2;
+
+    std::vector<const binary_edge_list_header*> headers;
+    uint64_t total_edges = 0;
+    for(size_t i=0; i<filenames.size(); ++i) {
+      m_files.emplace_back(new detail::mapped_file(filenames[i]));
+      const binary_edge_list_header* header = checked_header(*m_files.back(),
+                                                             filenames[i]);
+      if(i == 0) {
+        m_record_words = header->record_words();
+      } else if(header->record_words() != m_record_words) {
+        HAVOQGT_ERROR_MSG("Binary edge lists mix weighted and unweighted files.");
+      }
+      headers.push_back(header);
+      total_edges += header->edge_count;
+      m_global_max_vertex = std::max(m_global_max_vertex, header->max_vertex_id);
+    }
+
+    // identify edges to be read by local rank
+    uint64_t range_begin = split_point(total_edges, mpi_size, mpi_rank);
+    uint64_t range_end   = split_point(total_edges, mpi_size, mpi_rank + 1);
+    uint64_t file_offset = 0;
+    for(size_t i=0; i<headers.size(); ++i) {
+      uint64_t file_end = file_offset + headers[i]->edge_count;
+      uint64_t begin = std::max(range_begin, file_offset);
+      uint64_t end   = std::min(range_end, file_end);
+      if(begin < end) {
+        const uint64_t* records = reinterpret_cast<const uint64_t*>(headers[i] + 1);
+        edge_segment seg = {records + (begin - file_offset) * m_record_words,
+                            end - begin};
+        m_segments.push_back(seg);
+        m_local_edge_count += end - begin;
+      }
+      file_offset = file_end;
+    }
+  }
+
+  /// Returns the begin of the input iterator
+  input_iterator_type begin() const {
+    return input_iterator_type(this, 0);
+  }
+
+  /// Returns the end of the input iterator
+  input_iterator_type end() const {
+    return input_iterator_type(this, m_local_edge_count);
+  }
+
+  uint64_t max_vertex_id() const {
+    return m_global_max_vertex;
+  }
+
+  size_t size() const {
+    return m_local_edge_count;
+  }
+
+  bool weighted() const {
+    return m_record_words == 3;
+  }
+
+  /// True if filename starts with a binary edge list header.
+  static bool is_binary_file(const std::string& filename) {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    uint64_t magic = 0;
+    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    return in.good() && magic == binary_edge_list_header::magic_value;
+  }
+
+private:
+  static uint64_t split_point(uint64_t total, uint64_t parts, uint64_t i) {
+    return (total / parts) * i + std::min(i, total % parts);
+  }
+
+  static const binary_edge_list_header* checked_header(
+      const detail::mapped_file& file, const std::string& filename) {
+    const binary_edge_list_header* header =
+        reinterpret_cast<const binary_edge_list_header*>(file.data());
+    if(file.size() < sizeof(binary_edge_list_header)
+       || header->magic != binary_edge_list_header::magic_value) {
+      std::stringstream error;
+      error << "Not a binary edge list: " << filename;
+      throw std::runtime_error(error.str());
+    }
+    uint64_t record_bytes = header->record_words() * sizeof(uint64_t);
+    if(file.size() < sizeof(binary_edge_list_header)
+                     + header->edge_count * record_bytes) {
+      std::stringstream error;
+      error << "Truncated binary edge list: " << filename;
+      throw std::runtime_error(error.str());
+    }
+    return header;
+  }
+
+  std::vector< std::unique_ptr<detail::mapped_file> > m_files;
+  std::vector< edge_segment > m_segments;
+  uint64_t m_record_words;
+  uint64_t m_local_edge_count;
+  uint64_t m_global_max_vertex;
+};
+
+
+/// Writes edges to a binary edge list file.  The header is rewritten with
+/// the final edge count and max vertex id by close().
+class binary_edge_list_writer {
+public:
+  binary_edge_list_writer(const std::string& filename, bool weighted)
+    : m_out(filename.c_str(), std::ios::binary | std::ios::trunc) {
+    if(!m_out.good()) {
+      std::stringstream error;
+      error << "Error opening filename: " << filename;
+      throw std::runtime_error(error.str());
+    }
+    m_header.magic = binary_edge_list_header::magic_value;
+    m_header.flags = weighted ? binary_edge_list_header::flag_weighted : 0;
+    m_header.edge_count = 0;
+    m_header.max_vertex_id = 0;
+    write_header();
+  }
+
+  ~binary_edge_list_writer() {
+    if(m_out.is_open()) {
+      close();
+    }
+  }
+
+  void write(uint64_t source, uint64_t target, uint64_t weight = 1) {
+    uint64_t record[3] = {source, target, weight};
+    m_out.write(reinterpret_cast<const char*>(record),
+                m_header.record_words() * sizeof(uint64_t));
+    ++m_header.edge_count;
+    m_header.max_vertex_id = std::max(m_header.max_vertex_id,
+                                      std::max(source, target));
+  }
+
+  void close() {
+    m_out.seekp(0);
+    write_header();
+    m_out.close();
+  }
+
+  uint64_t edge_count() const { return m_header.edge_count; }
+
+private:
+  void write_header() {
+    m_out.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+  }
+
+  std::ofstream m_out;
+  binary_edge_list_header m_header;
+};
+
+} //end namespace havoqgt
+
+#endif //HAVOQGT_BINARY_EDGE_LIST_READER_INCLUDED
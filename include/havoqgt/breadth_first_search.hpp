@@ -55,6 +55,9 @@
 
 #include <havoqgt/visitor_queue.hpp>
 #include <boost/container/deque.hpp>
+#include <vector>
+#include <limits>
+#include <utility>
 
 namespace havoqgt { namespace mpi {
 
@@ -263,6 +266,316 @@ void breadth_first_search(TGraph* g,
 }
 
 
+/// Statistics of one level of direction_optimizing_bfs, global over all ranks.
+struct bfs_level_stats {
+  uint64_t level;
+  bool     bottom_up;
+  uint64_t frontier_size;
+  uint64_t edges_examined;
+  double   time;
+};
+
+/**
+ * Level-synchronous BFS that switches between top-down (push) and bottom-up
+ * (pull) steps, after Beamer et al., "Direction-Optimizing Breadth-First
+ * Search", SC'12.
+ *
+ * Top-down steps scan the edges of the frontier and send (target, parent)
+ * pairs to the target's owner.  Bottom-up steps let every unvisited vertex
+ * scan its own edges for a parent in the frontier, stopping at the first one;
+ * the frontier is gathered as a vertex_bitmap so that remote vertices can be
+ * probed locally.  Delegates are replicated: every rank scans its slice of a
+ * delegate's edges and the parent is agreed on with a min-reduction of labels.
+ *
+ * Bottom-up steps follow out-edges as in-edges, so the graph must be
+ * undirected (e.g., generate_rmat).  Like breadth_first_search, level_data
+ * must be reset to a value larger than any level before the call.
+ */
+template <typename TGraph, typename LevelData, typename ParentData>
+class direction_optimizing_bfs_engine {
+public:
+  typedef typename TGraph::vertex_locator vertex_locator;
+  typedef typename TGraph::vertex_bitmap  vertex_bitmap;
+  typedef typename LevelData::value_type  level_type;
+  typedef std::pair<vertex_locator, vertex_locator> visit_msg_type;
+
+  direction_optimizing_bfs_engine(TGraph* g, LevelData& level_data,
+                                  ParentData& parent_data,
+                                  double alpha, double beta)
+    : m_ptr_graph(g)
+    , m_level_data(level_data)
+    , m_parent_data(parent_data)
+    , m_alpha(alpha)
+    , m_beta(beta)
+    , m_frontier_bits(*g)
+    , m_next_bits(*g)
+    , m_delegate_parent(g->num_delegates(), no_parent()) {
+    m_mpi_comm = MPI_COMM_WORLD;
+  }
+
+  void run(vertex_locator s, std::vector<bfs_level_stats>& level_stats) {
+    level_stats.clear();
+
+    uint64_t local_vertices = 0;
+    uint64_t local_edges = 0;
+    for(auto vitr = m_ptr_graph->vertices_begin();
+        vitr != m_ptr_graph->vertices_end(); ++vitr) {
+      ++local_vertices;
+      local_edges += m_ptr_graph->local_degree(*vitr);
+    }
+    for(uint64_t i=0; i<m_ptr_graph->num_delegates(); ++i) {
+      local_edges += m_ptr_graph->local_degree(m_ptr_graph->delegate_locator(i));
+    }
+    const uint64_t global_vertices = m_ptr_graph->num_delegates() +
+        mpi_all_reduce(local_vertices, std::plus<uint64_t>(), m_mpi_comm);
+    uint64_t unexplored_edges = mpi_all_reduce(local_edges,
+        std::plus<uint64_t>(), m_mpi_comm);
+
+    if(s.is_delegate() || s.owner() == uint32_t(mpi_comm_rank())) {
+      m_level_data[s] = 0;
+      m_parent_data[s] = s;
+      add_to_next(s);
+    }
+    swap_frontier();
+
+    bool bottom_up = false;
+    uint64_t prev_frontier_size = 0;
+    for(uint64_t level = 0; ; ++level) {
+      uint64_t frontier_size = mpi_all_reduce(uint64_t(m_frontier.size()),
+          std::plus<uint64_t>(), m_mpi_comm) + m_frontier_bits.delegate_count();
+      if(frontier_size == 0) {
+        break;
+      }
+      uint64_t frontier_edges = mpi_all_reduce(local_frontier_edges(),
+          std::plus<uint64_t>(), m_mpi_comm);
+      unexplored_edges -= frontier_edges;
+
+      if(!bottom_up) {
+        bottom_up = double(frontier_edges) > double(unexplored_edges) / m_alpha;
+      } else if(double(frontier_size) < double(global_vertices) / m_beta &&
+                frontier_size < prev_frontier_size) {
+        bottom_up = false;
+      }
+      prev_frontier_size = frontier_size;
+
+      double time_start = MPI_Wtime();
+      uint64_t edges = bottom_up ? bottom_up_step(level + 1)
+                                 : top_down_step(level + 1);
+      reduce_delegate_parents(level + 1);
+      swap_frontier();
+
+      bfs_level_stats stats;
+      stats.level          = level;
+      stats.bottom_up      = bottom_up;
+      stats.frontier_size  = frontier_size;
+      stats.edges_examined = mpi_all_reduce(edges, std::plus<uint64_t>(),
+                                            m_mpi_comm);
+      stats.time           = MPI_Wtime() - time_start;
+      level_stats.push_back(stats);
+    }
+  }
+
+private:
+  /// Kept below 2^63 so the MIN reduction is correct even if an MPI treats
+  /// MPI_UNSIGNED_LONG as signed.
+  static uint64_t no_parent() {
+    return uint64_t(std::numeric_limits<int64_t>::max());
+  }
+
+  class owner_partitioner {
+  public:
+    int operator()(const visit_msg_type& msg, bool is_counting) const {
+      return msg.first.owner();
+    }
+  };
+
+  bool unvisited(const vertex_locator& v, uint64_t next_level) const {
+    return uint64_t(m_level_data[v]) > next_level;
+  }
+
+  /// Records a visited vertex; delegates are only marked once all ranks agree.
+  void add_to_next(const vertex_locator& v) {
+    m_next_bits.set(v);
+    if(!v.is_delegate()) {
+      m_next.push_back(v);
+    }
+  }
+
+  void swap_frontier() {
+    m_frontier.swap(m_next);
+    m_next.clear();
+    std::swap(m_frontier_bits, m_next_bits);
+    m_next_bits.reset();
+  }
+
+  /// Owned frontier vertices, plus every delegate in the frontier since each
+  /// rank holds a slice of the delegate's edges.
+  void local_frontier(std::vector<vertex_locator>& out) const {
+    out = m_frontier;
+    for(uint64_t i=0; i<m_ptr_graph->num_delegates(); ++i) {
+      vertex_locator d = m_ptr_graph->delegate_locator(i);
+      if(m_frontier_bits.test(d)) {
+        out.push_back(d);
+      }
+    }
+  }
+
+  uint64_t local_frontier_edges() const {
+    std::vector<vertex_locator> work;
+    local_frontier(work);
+    uint64_t edges = 0;
+    for(size_t i=0; i<work.size(); ++i) {
+      edges += m_ptr_graph->local_degree(work[i]);
+    }
+    return edges;
+  }
+
+  void propose_delegate_parent(const vertex_locator& d,
+                               const vertex_locator& parent) {
+    uint64_t label = m_ptr_graph->locator_to_label(parent);
+    m_delegate_parent[d.local_id()] =
+        std::min(m_delegate_parent[d.local_id()], label);
+  }
+
+  uint64_t top_down_step(uint64_t next_level) {
+    typedef typename TGraph::edge_iterator eitr_type;
+    std::vector<vertex_locator> work;
+    local_frontier(work);
+
+    uint64_t edges = 0;
+    size_t pos = 0;
+    owner_partitioner partitioner;
+    std::vector<visit_msg_type> to_send, to_recv;
+    do {
+      to_send.clear();
+      for(; pos < work.size() && to_send.size() < s_chunk_size; ++pos) {
+        const vertex_locator v = work[pos];
+        for(eitr_type eitr = m_ptr_graph->edges_begin(v);
+            eitr != m_ptr_graph->edges_end(v); ++eitr) {
+          ++edges;
+          vertex_locator target = eitr.target();
+          if(target.is_delegate()) {
+            if(unvisited(target, next_level)) {
+              propose_delegate_parent(target, v);
+            }
+          } else {
+            to_send.push_back(std::make_pair(target, v));
+          }
+        }
+      }
+
+      mpi_all_to_all_better(to_send, to_recv, partitioner, m_mpi_comm);
+      for(size_t i=0; i<to_recv.size(); ++i) {
+        const vertex_locator target = to_recv[i].first;
+        if(unvisited(target, next_level)) {
+          m_level_data[target] = next_level;
+          m_parent_data[target] = to_recv[i].second;
+          add_to_next(target);
+        }
+      }
+    } while(mpi_all_reduce(uint32_t(pos < work.size()),
+                           std::plus<uint32_t>(), m_mpi_comm) > 0);
+    return edges;
+  }
+
+  uint64_t bottom_up_step(uint64_t next_level) {
+    typedef typename TGraph::edge_iterator eitr_type;
+    m_frontier_bits.all_gather();
+
+    uint64_t edges = 0;
+    for(auto vitr = m_ptr_graph->vertices_begin();
+        vitr != m_ptr_graph->vertices_end(); ++vitr) {
+      const vertex_locator v = *vitr;
+      if(!unvisited(v, next_level)) {
+        continue;
+      }
+      for(eitr_type eitr = m_ptr_graph->edges_begin(v);
+          eitr != m_ptr_graph->edges_end(v); ++eitr) {
+        ++edges;
+        vertex_locator parent = eitr.target();
+        if(m_frontier_bits.test_global(parent)) {
+          m_level_data[v] = next_level;
+          m_parent_data[v] = parent;
+          add_to_next(v);
+          break;
+        }
+      }
+    }
+
+    for(uint64_t i=0; i<m_ptr_graph->num_delegates(); ++i) {
+      const vertex_locator d = m_ptr_graph->delegate_locator(i);
+      if(!unvisited(d, next_level)) {
+        continue;
+      }
+      for(eitr_type eitr = m_ptr_graph->edges_begin(d);
+          eitr != m_ptr_graph->edges_end(d); ++eitr) {
+        ++edges;
+        vertex_locator parent = eitr.target();
+        if(m_frontier_bits.test_global(parent)) {
+          propose_delegate_parent(d, parent);
+          break;
+        }
+      }
+    }
+    return edges;
+  }
+
+  /// Agrees on the smallest proposed parent label of each delegate.
+  void reduce_delegate_parents(uint64_t next_level) {
+    if(m_delegate_parent.empty()) {
+      return;
+    }
+    mpi_all_reduce_inplace(m_delegate_parent, std::less<uint64_t>(),
+                           m_mpi_comm);
+    for(uint64_t i=0; i<m_delegate_parent.size(); ++i) {
+      if(m_delegate_parent[i] != no_parent()) {
+        const vertex_locator d = m_ptr_graph->delegate_locator(i);
+        assert(unvisited(d, next_level));
+        m_level_data[d] = next_level;
+        m_parent_data[d] = m_ptr_graph->label_to_locator(m_delegate_parent[i]);
+        add_to_next(d);
+        m_delegate_parent[i] = no_parent();
+      }
+    }
+  }
+
+  static const size_t s_chunk_size = 1024*1024;
+
+  TGraph*       m_ptr_graph;
+  LevelData&    m_level_data;
+  ParentData&   m_parent_data;
+  double        m_alpha;
+  double        m_beta;
+  MPI_Comm      m_mpi_comm;
+
+  std::vector<vertex_locator> m_frontier;
+  std::vector<vertex_locator> m_next;
+  vertex_bitmap               m_frontier_bits;
+  vertex_bitmap               m_next_bits;
+  std::vector<uint64_t>       m_delegate_parent;
+};
+
+
+/**
+ * Direction-optimizing BFS; see direction_optimizing_bfs_engine.
+ *
+ * @param level_stats filled with one entry per level
+ * @param alpha switch to bottom-up once frontier edges > unexplored edges / alpha
+ * @param beta  switch back to top-down once frontier < vertices / beta
+ */
+template <typename TGraph, typename LevelData, typename ParentData>
+void direction_optimizing_bfs(TGraph* g,
+                              LevelData& level_data,
+                              ParentData& parent_data,
+                              typename TGraph::vertex_locator s,
+                              std::vector<bfs_level_stats>& level_stats,
+                              double alpha = 14.0, double beta = 24.0) {
+  direction_optimizing_bfs_engine<TGraph, LevelData, ParentData>
+      engine(g, level_data, parent_data, alpha, beta);
+  engine.run(s, level_stats);
+}
+
+
 
 }} //end namespace havoqgt::mpi
 
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Roger Pearce <rpearce@llnl.gov>.
+ * LLNL-CODE-644630.
+ * All rights reserved.
+ *
+ * This file is part of HavoqGT, Version 0.1.
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ *
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ *
+ * Our Preamble Notice
+ *
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ *
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ *
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ *
+ */
+
+
+#ifndef HAVOQGT_DEDUPLICATED_EDGE_LIST_INCLUDED
+#define HAVOQGT_DEDUPLICATED_EDGE_LIST_INCLUDED
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <stdint.h>
+
+#include <havoqgt/mpi.hpp>
+#include <havoqgt/environment.hpp>
+#include <havoqgt/detail/iterator.hpp>
+#include <havoqgt/detail/edge_stage.hpp>
+#include <havoqgt/detail/external_edge_sort.hpp>
+#include <havoqgt/impl/edge_partitioner.hpp>
+
+namespace havoqgt {
+
+/// Wraps an edge container and presents every distinct (source, target)
+/// pair once, optionally with every reverse edge added and without
+/// self-loops, so delegate_partitioned_graph counts degrees, picks
+/// delegates and sizes its CSR from the final graph.  Text inputs can
+/// instead get both from parallel_edge_list_reader while they are parsed.
+///
+/// Edges are exchanged in chunks to rank source % mpi_size, which is also
+/// the default owner of the source, and sorted there.  With
+/// HAVOQGT_EXTERNAL_SORT_MB set, the received edges go through
+/// detail::external_edge_sort in runs of that size and duplicates are
+/// dropped as the runs are merged; otherwise they are sorted in memory and
+/// compacted whenever they double, so heavily duplicated inputs stay near
+/// their distinct size.  The distinct edges, sorted by source then target,
+/// are staged like parsed edges: varint encoded, in memory or in a scratch
+/// file under HAVOQGT_INGEST_SCRATCH.
+template <typename EdgeContainer>
+class deduplicated_edge_list {
+public:
+  typedef std::pair<uint64_t, uint64_t> edge_type;
+  typedef detail::edge_stage::const_iterator input_iterator_type;
+
+  deduplicated_edge_list(EdgeContainer& edges, MPI_Comm mpi_comm,
+                         bool undirected = false,
+                         bool drop_self_loops = false)
+    : m_stage(get_environment().ingest_scratch()) {
+    int mpi_size(0);
+    CHK_MPI( MPI_Comm_size(mpi_comm, &mpi_size) );
+    mpi::edge_source_partitioner partitioner{mpi::label_partition(mpi_size)};
+
+    std::unique_ptr<detail::external_edge_sort> sorter;
+    const uint64_t external_sort_mb = get_environment().external_sort_mb();
+    if (external_sort_mb > 0) {
+      std::string scratch = get_environment().ingest_scratch();
+      sorter.reset(new detail::external_edge_sort(
+          scratch.empty() ? std::string("/tmp") : scratch,
+          (external_sort_mb << 20) / sizeof(edge_type), 64, 64,
+          ingest_thread_count()));
+    }
+
+    const size_t chunk_size = 1024*64;
+    uint64_t local_input = 0;
+    size_t compacted_size = 0;
+    std::vector<edge_type> to_send, received, sorted;
+    auto itr = edges.begin();
+    auto itr_end = edges.end();
+    while (!mpi::detail::global_iterator_range_empty(itr, itr_end, mpi_comm)) {
+      to_send.clear();
+      for (size_t i = 0; i < chunk_size && itr != itr_end; ++i, ++itr) {
+        if (itr->first != itr->second) {
+          to_send.push_back(*itr);
+          if (undirected) {
+            to_send.push_back(edge_type(itr->second, itr->first));
+          }
+        } else if (!drop_self_loops) {
+          to_send.push_back(*itr);
+        } else {
+          ++local_input;
+        }
+      }
+      local_input += to_send.size();
+      mpi::mpi_all_to_all_better(to_send, received, partitioner, mpi_comm);
+      if (sorter) {
+        for (size_t i = 0; i < received.size(); ++i) {
+          sorter->push(received[i]);
+        }
+        continue;
+      }
+      sorted.insert(sorted.end(), received.begin(), received.end());
+      if (sorted.size() >= 2 * std::max(compacted_size, chunk_size)) {
+        compact(sorted);
+        compacted_size = sorted.size();
+      }
+    }
+    std::vector<edge_type>().swap(to_send);
+    std::vector<edge_type>().swap(received);
+
+    uint64_t local_max = 0;
+    edge_type last;
+    auto stage_distinct = [&](const edge_type& edge) {
+      if (m_stage.size() == 0 || edge != last) {
+        m_stage.push(edge);
+        last = edge;
+        local_max = std::max(local_max, std::max(edge.first, edge.second));
+      }
+    };
+    if (sorter) {
+      sorter->merge(stage_distinct);
+    } else {
+      compact(sorted);
+      for (size_t i = 0; i < sorted.size(); ++i) {
+        stage_distinct(sorted[i]);
+      }
+      std::vector<edge_type>().swap(sorted);
+    }
+    m_stage.finish();
+
+    m_global_max_vertex = mpi::mpi_all_reduce(local_max,
+        std::greater<uint64_t>(), mpi_comm);
+    m_global_removed = mpi::mpi_all_reduce(local_input - m_stage.size(),
+        std::plus<uint64_t>(), mpi_comm);
+  }
+
+  /// Returns the begin of the input iterator
+  input_iterator_type begin() const { return m_stage.begin(); }
+
+  /// Returns the end of the input iterator
+  input_iterator_type end() const { return m_stage.end(); }
+
+  uint64_t max_vertex_id() const { return m_global_max_vertex; }
+
+  size_t size() const { return m_stage.size(); }
+
+  /// Duplicate edges and self-loops removed across all ranks, counting
+  /// the added reverse edges as input
+  uint64_t removed_edges() const { return m_global_removed; }
+
+private:
+  static void compact(std::vector<edge_type>& edges) {
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  }
+
+  detail::edge_stage m_stage;
+  uint64_t m_global_max_vertex;
+  uint64_t m_global_removed;
+};
+
+} // namespace havoqgt
+
+#endif  // HAVOQGT_DEDUPLICATED_EDGE_LIST_INCLUDED
@@ -54,8 +54,12 @@
 
 
 #include <limits>
+#include <sstream>
 #include <utility>
+#include <vector>
 #include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <functional>
 
 #include <boost/unordered_set.hpp>
@@ -68,7 +72,12 @@
 #include <havoqgt/mpi.hpp>
 #include <havoqgt/utilities.hpp>
 #include <havoqgt/cache_utilities.hpp>
+#include <havoqgt/detail/hash.hpp>
 #include <havoqgt/detail/iterator.hpp>
+#include <havoqgt/detail/message_codec.hpp>
+#include <havoqgt/detail/count_min_sketch.hpp>
+#include <havoqgt/detail/external_edge_sort.hpp>
+#include <havoqgt/detail/radix_sort.hpp>
 #include <havoqgt/impl/edge_partitioner.hpp>
 #include <havoqgt/impl/edge_node_identifier.hpp>
 
@@ -88,7 +97,6 @@ namespace bip = boost::interprocess;
  * Delegate partitioned graph using MPI for communication.
  *
  * @todo Test using simple deterministic patterns.
- * @todo Add edge_data
  * @todo Make vertex_iterator a random access iterator
  * @todo Add invalid bit or state to vertex_locator
  * @todo Verify low-degree CSR creation:  ipp line 167
@@ -112,12 +120,20 @@ class delegate_partitioned_graph {
   /// Vertex Data storage
   template <typename T, typename Allocator>
   class vertex_data;
+  /// Vertex Data storage with atomic update primitives
+  template <typename T, typename Allocator>
+  class atomic_vertex_data;
+  /// One bit per vertex, e.g., a BFS frontier
+  class vertex_bitmap;
   /// Edge Data storage
   template <typename T, typename SegManagerOther>
   class edge_data;
   /// Stores information about owned vertices
   class vert_info;
 
+  /// Weights of the input edges, stored by construction
+  typedef edge_data<uint64_t, SegementManager> edge_weight_data;
+
   enum ConstructionState { New, MetaDataGenerated, EdgeStorageAllocated,
     LowEdgesPartitioned, HighEdgesPartitioned, GraphReady};
 
@@ -132,23 +148,103 @@ class delegate_partitioned_graph {
                              uint64_t delegate_degree_threshold,
                              ConstructionState stop_after = GraphReady);
 
+  /// Runs the remaining construction phases.  Every rank resumes from the
+  /// earliest phase any rank has completed, so it can continue a
+  /// construction interrupted by a crash, given the same edges.
   template <typename Container>
   void complete_construction(const SegmentAllocator<void>& seg_allocator,
     MPI_Comm mpi_comm, Container& edges);
+
+  /// Last completed construction phase
+  ConstructionState construction_state() const { return m_graph_state; }
   void print_graph_statistics();
 
+  /// Replaces the target arrays by gap/varint encoded streams
+  void compress_targets(const SegmentAllocator<void>& seg_allocator);
+
+  /// True if edge_iterator decodes targets from the compressed streams
+  bool targets_compressed() const { return m_targets_compressed; }
+
+  /// Renumbers each rank's max_vertices highest degree vertices to local
+  /// ids 0, 1, ... in degree order, so the vertex_data of the most visited
+  /// vertices shares cache lines and pages.  Collective; call before
+  /// compress_targets(), add_edges() and creating vertex or edge data.
+  void relabel_vertices(MPI_Comm mpi_comm, uint64_t max_vertices);
+
+  /// True if relabel_vertices() moved any vertex
+  bool vertices_relabeled() const { return !m_relabel_forward.empty(); }
+
+  /// Adds edges, given as label pairs, to a finished graph.  Collective.
+  /// Both labels must be <= max_global_vertex_id() and delegates stay
+  /// fixed.  The edges are kept in a per-rank delta that edge_iterator
+  /// visits after the CSR edges, until compact() merges it.  Not available
+  /// on graphs with edge weights.
+  template <typename Container>
+  void add_edges(const SegmentAllocator<void>& seg_allocator,
+                 MPI_Comm mpi_comm, Container& edges);
+
+  /// Merges this rank's delta into the CSR, or the compressed streams.
+  /// edge_data created before add_edges() or compact() must be recreated.
+  void compact(const SegmentAllocator<void>& seg_allocator);
+
+  /// Number of added edges on this rank not yet merged by compact()
+  size_t delta_size() const {
+    return m_owned_delta.size() + m_delegate_delta.size();
+  }
+
+  /// Range of a vertex's added edges among this rank's delta edges; empty
+  /// if it has none.  edge_iterator visits them after the CSR edges, sorted
+  /// by target.
+  std::pair<uint64_t, uint64_t> delta_range(vertex_locator locator) const;
+
+  /// Which rank owns each label: label % mpi_size, or with
+  /// HAVOQGT_RANGE_PARTITION, label ranges holding equal numbers of edges
+  label_partition ownership() const {
+    return label_partition(m_mpi_size,
+        m_owner_bounds.empty() ? nullptr : &m_owner_bounds[0]);
+  }
+
   /// Converts a vertex_locator to the vertex label
   uint64_t locator_to_label(vertex_locator locator) const;
 
   /// Converts a vertex label to a vertex_locator
   vertex_locator label_to_locator(uint64_t label) const;
 
+  /// Stores the sparse label of every vertex this rank owns, as numbered by
+  /// sparse_label_edge_list, and indexes them for sparse_label_to_locator().
+  /// Collective.  Labels and add_edges() keep using the dense labels.
+  void set_sparse_labels(MPI_Comm mpi_comm,
+                         const std::vector<uint64_t>& owned_labels);
+
+  /// True if set_sparse_labels() was called
+  bool has_sparse_labels() const { return !m_sparse_label_index.empty(); }
+
+  /// Converts the sparse label of an owned vertex or a delegate with one
+  /// hash probe; invalid locator for labels of other ranks' vertices.
+  vertex_locator sparse_label_to_locator(uint64_t label) const;
+
+  /// Converts any sparse label in the graph.  Collective.
+  vertex_locator sparse_label_to_locator(uint64_t label,
+                                         MPI_Comm mpi_comm) const;
+
+  /// Sparse label of an owned vertex or a delegate
+  uint64_t locator_to_sparse_label(vertex_locator locator) const;
+
   /// Returns a begin iterator for edges of a vertex
   edge_iterator edges_begin(vertex_locator locator) const;
 
   /// Returns an end iterator for edges of a vertex
   edge_iterator edges_end(vertex_locator locator) const;
 
+  /// Returns the first of a vertex's targets, sorted by vertex_locator.
+  /// For a delegate these are only the locally stored edges.  Not available
+  /// once the targets are compressed, and without edges added since the
+  /// last compact().
+  const vertex_locator* targets_begin(vertex_locator locator) const;
+
+  /// Returns one past the last of a vertex's sorted targets
+  const vertex_locator* targets_end(vertex_locator locator) const;
+
   /// Returns the degree of a vertex
   uint64_t degree(vertex_locator locator) const;
 
@@ -188,6 +284,13 @@ class delegate_partitioned_graph {
       const T& init, SegManagerOther*,
       const char *obj_name = nullptr) const;
 
+  /// True if the graph was built from weighted edges
+  bool has_edge_weights() const { return m_edge_weights != nullptr; }
+
+  /// The input weight of every edge, written in CSR order during
+  /// construction and kept in the graph's segment; null if unweighted.
+  edge_weight_data* edge_weights() const { return m_edge_weights.get(); }
+
   size_t num_local_vertices() const {
     return m_owned_info.size();
   }
@@ -205,10 +308,22 @@ class delegate_partitioned_graph {
     return m_delegate_degree.size();
   }
 
+  /// Returns the vertex_locator of a delegate, 0 <= delegate_id < num_delegates()
+  vertex_locator delegate_locator(uint64_t delegate_id) const {
+    assert(delegate_id < m_delegate_label.size());
+    return vertex_locator(true, delegate_id,
+                          ownership().owner(m_delegate_label[delegate_id]));
+  }
+
   uint32_t master(const vertex_locator& locator) const {
     return locator.m_local_id % m_mpi_size;
   }
 
+  /// Ranks [first, second) that store edges of a delegate: all of them
+  std::pair<uint32_t, uint32_t> delegate_ranks(const vertex_locator&) const {
+    return std::make_pair(uint32_t(0), uint32_t(m_mpi_size));
+  }
+
   typedef typename bip::vector<vertex_locator, SegmentAllocator<vertex_locator> >
       ::const_iterator controller_iterator;
 
@@ -273,21 +388,45 @@ class delegate_partitioned_graph {
   void initialize_low_meta_data(boost::unordered_set<uint64_t>& global_hub_set);
   void initialize_high_meta_data(boost::unordered_set<uint64_t>& global_hubs);
 
-  void initialize_edge_storage(const SegmentAllocator<void>& seg_allocator);
+  void initialize_edge_storage(const SegmentAllocator<void>& seg_allocator,
+                               bool weighted);
 
-  template <typename Container>
+  template <typename Record, typename Container>
   void partition_low_degree(Container& unsorted_edges);
 
+  /// Appends an edge (or weighted_edge) to its source's slot in the low CSR
+  template <typename Record>
+  void append_low_edge(const Record& edge);
+
   template <typename InputIterator>
   void count_high_degree_edges(InputIterator unsorted_itr,
                  InputIterator unsorted_itr_end,
-                 boost::unordered_set<uint64_t>& global_hub_set);
+                 boost::unordered_set<uint64_t>& global_hub_set,
+                 bool count_low_edges = false);
 
 
-  template <typename Container>
+  template <typename Record, typename Container>
   void partition_high_degree(Container& unsorted_edges,
     std::map< uint64_t, std::deque<OverflowSendInfo> > &transfer_info);
 
+  /// Edge records the partition phases exchange: plain edges, or
+  /// weighted_edge when the input is weighted.
+  template <typename Iterator>
+  static void read_edge_record(const Iterator& itr,
+                               std::pair<uint64_t, uint64_t>& record) {
+    record = *itr;
+  }
+  template <typename Iterator>
+  static void read_edge_record(const Iterator& itr, weighted_edge& record) {
+    record = weighted_edge(*itr, detail::iterator_edge_weight(itr));
+  }
+
+  /// Stores a placed record's weight at the same CSR position as its target
+  void store_edge_weight(const std::pair<uint64_t, uint64_t>&, bool,
+                         uint64_t) { }
+  void store_edge_weight(const weighted_edge& record, bool delegate,
+                         uint64_t position);
+
 
   template <typename InputIterator>
   void count_edge_degrees(InputIterator unsorted_itr,
@@ -295,10 +434,23 @@ class delegate_partitioned_graph {
                  boost::unordered_set<uint64_t>& global_hub_set,
                  uint64_t delegate_degree_threshold);
 
+  uint64_t choose_delegate_threshold();
+
+  template <typename Container>
+  void compute_owner_bounds(Container& edges);
+
+  template <typename Container>
+  void find_hubs_with_sketch(Container& edges,
+                 boost::unordered_set<uint64_t>& global_hub_set,
+                 uint64_t delegate_degree_threshold);
+
 
   void send_high_info(std::vector< boost::container::map< uint64_t, uint64_t> >&
       maps_to_send, int maps_to_send_element_count);
 
+  void send_low_info(std::vector< boost::container::map< uint64_t, uint64_t> >&
+      maps_to_send, int maps_to_send_element_count);
+
 
   void send_vertex_info(uint64_t &high_vertex_count,
       uint64_t delegate_degree_threshold,
@@ -310,10 +462,37 @@ class delegate_partitioned_graph {
   void calculate_overflow(std::map< uint64_t, std::deque<OverflowSendInfo> >
     &transfer_info);
 
+  void sort_adjacency();
+
+  typedef std::pair<uint64_t, uint64_t> relabel_entry;
+  typedef bip::vector<relabel_entry, SegmentAllocator<relabel_entry> >
+      relabel_map;
+
+  /// Looks up local_id of owner in a relabel map; unmoved ids map to
+  /// themselves
+  uint64_t relabel_lookup(const relabel_map& map, uint32_t owner,
+                          uint64_t local_id) const;
+
+  /// Rebuilds m_sparse_label_index from the sparse label arrays
+  void build_sparse_label_index();
+
+  template <typename CsrIndex>
+  void encode_targets(const vertex_locator* targets, size_t num_index,
+    CsrIndex csr_index, std::vector<uint8_t>& stream,
+    std::vector<uint64_t>& offsets);
+
   void generate_send_list(std::vector<uint64_t> &send_list, uint64_t num_send,
     int send_id,
     std::map< uint64_t, std::deque<OverflowSendInfo> > &transfer_info);
 
+  /// Saves and restores calculate_overflow()'s transfer plan, so
+  /// partition_high_degree can run in a resumed construction.
+  void store_transfer_info(
+    const std::map< uint64_t, std::deque<OverflowSendInfo> >& transfer_info);
+  void load_transfer_info(
+    std::map< uint64_t, std::deque<OverflowSendInfo> >& transfer_info) const;
+
+  /// Syncs the graph's segment to disk, checkpointing a completed phase
   void flush_graph();
 
   //////////////////////////////////////////////////////////////////////////////
@@ -339,6 +518,10 @@ class delegate_partitioned_graph {
   bip::vector<uint32_t, SegmentAllocator<uint32_t> > m_local_outgoing_count;
   bip::vector<uint32_t, SegmentAllocator<uint32_t> > m_local_incoming_count;
 
+  // First label of each rank's range, and one past the last label; empty
+  // for label % mpi_size ownership
+  bip::vector<uint64_t, SegmentAllocator<uint64_t> > m_owner_bounds;
+
   bip::vector<vert_info, SegmentAllocator<vert_info>> m_owned_info;
   bip::vector<uint32_t, SegmentAllocator<uint32_t>> m_owned_info_tracker;
   //bip::vector<vertex_locator, SegmentAllocator<vertex_locator>> m_owned_targets;
@@ -356,6 +539,26 @@ class delegate_partitioned_graph {
   bip::offset_ptr<vertex_locator> m_delegate_targets;
   size_t m_delegate_targets_size;
 
+  // Input edge weights, parallel to the target arrays; null if unweighted
+  bip::offset_ptr<edge_weight_data> m_edge_weights;
+
+  // Compressed targets: per vertex, the sort_key() of the first target and
+  // the gaps to the following ones, as varints.  The offsets index the
+  // streams per owned vertex / delegate, like low_csr_idx and m_delegate_info.
+  bool m_targets_compressed {false};
+  bip::vector< uint8_t, SegmentAllocator<uint8_t> > m_owned_target_stream;
+  bip::vector< uint64_t, SegmentAllocator<uint64_t> > m_owned_stream_offsets;
+  bip::vector< uint8_t, SegmentAllocator<uint8_t> > m_delegate_target_stream;
+  bip::vector< uint64_t, SegmentAllocator<uint64_t> > m_delegate_stream_offsets;
+
+  // Edges added after construction as (owned local id or delegate id,
+  // target), sorted by source and in insertion order per source.  Their
+  // edge offsets follow the CSR's: m_owned_targets_size + delta index for
+  // owned sources, m_delegate_targets_size + delta index for delegates.
+  typedef std::pair<uint64_t, vertex_locator> delta_edge;
+  bip::vector< delta_edge, SegmentAllocator<delta_edge> > m_owned_delta;
+  bip::vector< delta_edge, SegmentAllocator<delta_edge> > m_delegate_delta;
+
   //Note: BIP only contains a map, not an unordered_map object.
   /*boost::interprocess::unordered_map<
       uint64_t, vertex_locator, boost::hash<uint64_t>, std::equal_to<uint64_t>,
@@ -366,6 +569,31 @@ class delegate_partitioned_graph {
 
   bip::vector<vertex_locator, SegmentAllocator<vertex_locator> >
     m_controller_locators;
+
+  // Construction checkpoint: the per-delegate edge counts and high edge
+  // count from the meta data phase, which calculate_overflow and
+  // initialize_edge_storage overwrite, and the overflow transfer plan as
+  // (delegate id, destination, count) triples.  Cleared once GraphReady.
+  bip::vector< uint64_t, SegmentAllocator<uint64_t> > m_checkpoint_delegate_info;
+  uint64_t m_checkpoint_edges_high_count {0};
+  bip::vector< uint64_t, SegmentAllocator<uint64_t> > m_checkpoint_transfer_info;
+
+  // Local ids moved by relabel_vertices(), on every rank: (old, new) pairs
+  // sorted by old id and (new, old) pairs sorted by new id.  Rank r's pairs
+  // are [m_relabel_offsets[r], m_relabel_offsets[r+1]) of both maps.
+  bip::vector< uint64_t, SegmentAllocator<uint64_t> > m_relabel_offsets;
+  relabel_map m_relabel_forward;
+  relabel_map m_relabel_backward;
+
+  // Sparse labels of the owned vertices, by local id, and of every delegate.
+  // m_sparse_label_index is an open addressing table from sparse label to
+  // local id, or to delegate id | sparse_delegate_bit; empty slots hold
+  // sparse_empty_slot.
+  static constexpr uint64_t sparse_delegate_bit = uint64_t(1) << 63;
+  static constexpr uint64_t sparse_empty_slot = ~uint64_t(0);
+  bip::vector< uint64_t, SegmentAllocator<uint64_t> > m_sparse_labels;
+  bip::vector< uint64_t, SegmentAllocator<uint64_t> > m_sparse_delegate_labels;
+  relabel_map m_sparse_label_index;
 };  // class delegate_partitioned_graph
 
 
@@ -379,6 +607,8 @@ class delegate_partitioned_graph {
 #include <havoqgt/impl/edge_data.hpp>
 #include <havoqgt/impl/edge_iterator.hpp>
 #include <havoqgt/impl/vertex_data.hpp>
+#include <havoqgt/impl/atomic_vertex_data.hpp>
+#include <havoqgt/impl/vertex_bitmap.hpp>
 #include <havoqgt/impl/vertex_locator.hpp>
 #include <havoqgt/impl/vertex_iterator.hpp>
 
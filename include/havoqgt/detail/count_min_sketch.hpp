@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC. 
+ * Produced at the Lawrence Livermore National Laboratory. 
+ * Written by Roger Pearce <rpearce@llnl.gov>. 
+ * LLNL-CODE-644630. 
+ * All rights reserved.
+ * 
+ * This file is part of HavoqGT, Version 0.1. 
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ * 
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ * 
+ * Our Preamble Notice
+ * 
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ * 
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ * 
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ * 
+ */
+
+#ifndef HAVOQGT_DETAIL_COUNT_MIN_SKETCH_HPP_INCLUDED
+#define HAVOQGT_DETAIL_COUNT_MIN_SKETCH_HPP_INCLUDED
+
+#include <havoqgt/mpi.hpp>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <stdint.h>
+
+namespace havoqgt { namespace detail {
+
+///
+/// Count-Min sketch of 64-bit keys.
+///
+/// depth rows of width counters (width a power of two); a key adds to one
+/// counter per row and its estimate is the minimum of those counters.
+/// Estimates never undercount, and overcount by at most total / width per
+/// row in expectation.  Sketches built with the same shape on different
+/// ranks merge by summing their counters.
+///
+class count_min_sketch {
+public:
+  count_min_sketch(size_t width, size_t depth = 4)
+    : m_mask(width - 1), m_depth(depth), m_counters(width * depth, 0) {
+    assert(width > 0 && (width & (width - 1)) == 0);
+  }
+
+  void add(uint64_t key, uint64_t count = 1) {
+    for(size_t row = 0; row < m_depth; ++row) {
+      m_counters[index(row, key)] += count;
+    }
+  }
+
+  uint64_t estimate(uint64_t key) const {
+    uint64_t est = std::numeric_limits<uint64_t>::max();
+    for(size_t row = 0; row < m_depth; ++row) {
+      est = std::min(est, m_counters[index(row, key)]);
+    }
+    return est;
+  }
+
+  /// Collective: sums the sketches of all ranks of comm.
+  void all_reduce(MPI_Comm comm) {
+    mpi::mpi_all_reduce_inplace(m_counters, std::plus<uint64_t>(), comm);
+  }
+
+  size_t bytes() const { return m_counters.size() * sizeof(uint64_t); }
+
+private:
+  size_t index(size_t row, uint64_t key) const {
+    // splitmix64 finalizer, seeded per row
+    uint64_t z = key + (row + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return row * (m_mask + 1) + (z & m_mask);
+  }
+
+  uint64_t              m_mask;
+  size_t                m_depth;
+  std::vector<uint64_t> m_counters;
+};
+
+}} //end namespace havoqgt::detail
+
+#endif //HAVOQGT_DETAIL_COUNT_MIN_SKETCH_HPP_INCLUDED
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC. 
+ * Produced at the Lawrence Livermore National Laboratory. 
+ * Written by Roger Pearce <rpearce@llnl.gov>. 
+ * LLNL-CODE-644630. 
+ * All rights reserved.
+ * 
+ * This file is part of HavoqGT, Version 0.1. 
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ * 
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ * 
+ * Our Preamble Notice
+ * 
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ * 
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ * 
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ * 
+ */
+
+#ifndef HAVOQGT_DETAIL_EDGE_STAGE_HPP_INCLUDED
+#define HAVOQGT_DETAIL_EDGE_STAGE_HPP_INCLUDED
+
+#include <havoqgt/detail/mapped_file.hpp>
+#include <havoqgt/detail/message_codec.hpp>
+#include <iterator>
+#include <memory>
+#include <vector>
+#include <string>
+#include <utility>
+#include <sstream>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace havoqgt { namespace detail {
+
+///
+/// Collects staged bytes in memory, or in a scratch file under dir when dir
+/// is not empty.
+///
+class stage_sink {
+public:
+  stage_sink(const std::string& dir, bool enabled = true) : m_fd(-1) {
+    if(enabled && !dir.empty()) {
+      m_path = dir + "/havoqgt_stage_XXXXXX";
+      m_fd = mkstemp(&m_path[0]);
+      if(m_fd < 0) {
+        std::stringstream error;
+        error << "Error creating scratch file in: " << dir;
+        throw std::runtime_error(error.str());
+      }
+    }
+  }
+
+  ~stage_sink() {
+    if(m_fd >= 0) {
+      close(m_fd);
+      unlink(m_path.c_str());
+    }
+  }
+
+  void append(const std::vector<uint8_t>& bytes) {
+    if(m_fd < 0) {
+      m_memory.insert(m_memory.end(), bytes.begin(), bytes.end());
+      return;
+    }
+    const uint8_t* ptr = bytes.data();
+    size_t left = bytes.size();
+    while(left > 0) {
+      ssize_t ret = write(m_fd, ptr, left);
+      if(ret < 0) {
+        throw std::runtime_error("Error writing ingest scratch file.");
+      }
+      ptr += ret;
+      left -= ret;
+    }
+  }
+
+  /// Hands the staged bytes to memory, or maps the scratch file, which is
+  /// unlinked right away so it disappears with the mapping.
+  void finish(std::vector<uint8_t>& memory, mapped_file& file) {
+    if(m_fd < 0) {
+      memory.swap(m_memory);
+      memory.shrink_to_fit();
+      return;
+    }
+    close(m_fd);
+    m_fd = -1;
+    file.open(m_path);
+    unlink(m_path.c_str());
+  }
+
+private:
+  stage_sink(const stage_sink&);
+  stage_sink& operator=(const stage_sink&);
+
+  std::string          m_path;
+  int                  m_fd;
+  std::vector<uint8_t> m_memory;
+};
+
+///
+/// Edges written once and read back any number of times, for edge lists
+/// that construction passes over more than once.
+///
+/// push() encodes the zigzag delta of the source from the previous source
+/// and of the target from the source as varints, so sorted or clustered
+/// edges take a few bytes each.  The bytes go to a stage_sink under dir;
+/// after finish(), begin() and end() iterate the decoded edges.
+///
+class edge_stage {
+public:
+  typedef std::pair<uint64_t, uint64_t> edge_type;
+
+  class const_iterator : public std::iterator<std::input_iterator_tag,
+      edge_type, ptrdiff_t, const edge_type*, const edge_type&> {
+  public:
+    const_iterator(const uint8_t* pos, uint64_t count, uint64_t size)
+      : m_pos(pos), m_count(count), m_size(size), m_current(0, 0) {
+      decode();
+    }
+
+    const edge_type& operator*() const { return m_current; }
+    const edge_type* operator->() const { return &m_current; }
+
+    const_iterator& operator++() {
+      ++m_count;
+      decode();
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    friend bool operator==(const const_iterator& x, const const_iterator& y) {
+      return x.m_count == y.m_count;
+    }
+
+    friend bool operator!=(const const_iterator& x, const const_iterator& y) {
+      return x.m_count != y.m_count;
+    }
+
+  private:
+    void decode() {
+      if(m_count >= m_size) {
+        return;
+      }
+      uint64_t zz;
+      m_pos = varint_decode(m_pos, zz);
+      m_current.first = zigzag_decode(m_current.first, zz);
+      m_pos = varint_decode(m_pos, zz);
+      m_current.second = zigzag_decode(m_current.first, zz);
+    }
+
+    const uint8_t* m_pos;
+    uint64_t       m_count;
+    uint64_t       m_size;
+    edge_type      m_current;
+  };
+
+  explicit edge_stage(const std::string& dir)
+    : m_sink(new stage_sink(dir)), m_size(0), m_prev_source(0)
+    , m_begin(NULL), m_end(NULL) { }
+
+  void push(const edge_type& edge) {
+    size_t pos = m_buffer.size();
+    m_buffer.resize(pos + 2 * varint_max_bytes);
+    uint8_t* end = varint_encode(zigzag_encode(m_prev_source, edge.first),
+                                 &m_buffer[pos]);
+    end = varint_encode(zigzag_encode(edge.first, edge.second), end);
+    m_buffer.resize(end - m_buffer.data());
+    m_prev_source = edge.first;
+    ++m_size;
+    if(m_buffer.size() >= s_flush_bytes) {
+      m_sink->append(m_buffer);
+      m_buffer.clear();
+    }
+  }
+
+  /// Ends the pushes; the edges can be iterated from here on.
+  void finish() {
+    m_sink->append(m_buffer);
+    std::vector<uint8_t>().swap(m_buffer);
+    m_sink->finish(m_memory, m_file);
+    m_sink.reset();
+    if(m_file.good()) {
+      m_begin = reinterpret_cast<const uint8_t*>(m_file.data());
+      m_end = m_begin + m_file.size();
+    } else {
+      m_begin = m_memory.data();
+      m_end = m_begin + m_memory.size();
+    }
+  }
+
+  const_iterator begin() const { return const_iterator(m_begin, 0, m_size); }
+  const_iterator end() const { return const_iterator(m_end, m_size, m_size); }
+
+  uint64_t size() const { return m_size; }
+
+  /// Encoded size, in memory or in the scratch file
+  uint64_t bytes() const { return m_end - m_begin; }
+
+private:
+  static const size_t s_flush_bytes = size_t(1) << 20;
+
+  std::unique_ptr<stage_sink> m_sink;
+  std::vector<uint8_t>        m_buffer;
+  std::vector<uint8_t>        m_memory;
+  mapped_file                 m_file;
+  uint64_t                    m_size;
+  uint64_t                    m_prev_source;
+  const uint8_t*              m_begin;
+  const uint8_t*              m_end;
+};
+
+}} //end namespace havoqgt::detail
+
+#endif //HAVOQGT_DETAIL_EDGE_STAGE_HPP_INCLUDED
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC. 
+ * Produced at the Lawrence Livermore National Laboratory. 
+ * Written by Roger Pearce <rpearce@llnl.gov>. 
+ * LLNL-CODE-644630. 
+ * All rights reserved.
+ * 
+ * This file is part of HavoqGT, Version 0.1. 
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ * 
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ * 
+ * Our Preamble Notice
+ * 
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ * 
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ * 
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ * 
+ */
+
+#ifndef HAVOQGT_DETAIL_EXTERNAL_EDGE_SORT_HPP_INCLUDED
+#define HAVOQGT_DETAIL_EXTERNAL_EDGE_SORT_HPP_INCLUDED
+
+#include <havoqgt/detail/mapped_file.hpp>
+#include <havoqgt/detail/radix_sort.hpp>
+#include <vector>
+#include <queue>
+#include <string>
+#include <memory>
+#include <utility>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace havoqgt { namespace detail {
+
+///
+/// Sorts a stream of edges larger than memory.
+///
+/// push() fills a buffer of run_edges edges; a full buffer is sorted and
+/// written to a scratch file in dir as one run, which is mapped read-only
+/// and unlinked at once.  merge() k-way merges the runs and the unwritten
+/// tail of the buffer, so edges come out sorted while each run is read
+/// sequentially.
+///
+/// Runs are sorted with radix_sort_pairs() over first_bits and second_bits
+/// significant bits, using num_threads threads.
+///
+class external_edge_sort {
+public:
+  typedef std::pair<uint64_t, uint64_t> edge_type;
+
+  external_edge_sort(const std::string& dir, size_t run_edges,
+                     int first_bits = 64, int second_bits = 64,
+                     size_t num_threads = 1)
+    : m_dir(dir), m_run_edges(std::max(run_edges, size_t(1)))
+    , m_first_bits(first_bits), m_second_bits(second_bits)
+    , m_num_threads(num_threads) {
+    m_buffer.reserve(m_run_edges);
+  }
+
+  void push(const edge_type& edge) {
+    m_buffer.push_back(edge);
+    if (m_buffer.size() == m_run_edges) {
+      spill_run();
+    }
+  }
+
+  size_t num_runs() const { return m_runs.size(); }
+
+  /// Calls f(edge) for every pushed edge in sorted order; leaves the sorter
+  /// empty.
+  template <typename Function>
+  void merge(Function f) {
+    sort_buffer();
+    if (m_runs.empty()) {
+      for (size_t i = 0; i < m_buffer.size(); ++i) {
+        f(m_buffer[i]);
+      }
+      m_buffer.clear();
+      return;
+    }
+
+    // Cursor k < m_runs.size() is a run file, the last one is the buffer.
+    std::vector<const edge_type*> pos, end;
+    for (size_t k = 0; k < m_runs.size(); ++k) {
+      const edge_type* run = reinterpret_cast<const edge_type*>(m_runs[k]->data());
+      pos.push_back(run);
+      end.push_back(run + m_runs[k]->size() / sizeof(edge_type));
+    }
+    pos.push_back(m_buffer.data());
+    end.push_back(m_buffer.data() + m_buffer.size());
+
+    typedef std::pair<edge_type, size_t> head_type;
+    std::priority_queue<head_type, std::vector<head_type>,
+                        std::greater<head_type> > heads;
+    for (size_t k = 0; k < pos.size(); ++k) {
+      if (pos[k] != end[k]) {
+        heads.push(head_type(*pos[k]++, k));
+      }
+    }
+    while (!heads.empty()) {
+      head_type head = heads.top();
+      heads.pop();
+      f(head.first);
+      size_t k = head.second;
+      if (pos[k] != end[k]) {
+        heads.push(head_type(*pos[k]++, k));
+      }
+    }
+
+    m_runs.clear();
+    m_buffer.clear();
+  }
+
+private:
+  void sort_buffer() {
+    radix_sort_pairs(m_buffer, m_first_bits, m_second_bits, m_num_threads);
+  }
+
+  void spill_run() {
+    sort_buffer();
+    std::string path = m_dir + "/havoqgt_run_XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+      std::stringstream error;
+      error << "Error creating scratch file in: " << m_dir;
+      throw std::runtime_error(error.str());
+    }
+    const char* ptr = reinterpret_cast<const char*>(m_buffer.data());
+    size_t left = m_buffer.size() * sizeof(edge_type);
+    while (left > 0) {
+      ssize_t ret = write(fd, ptr, left);
+      if (ret < 0) {
+        close(fd);
+        unlink(path.c_str());
+        throw std::runtime_error("Error writing external sort run.");
+      }
+      ptr += ret;
+      left -= ret;
+    }
+    close(fd);
+    m_runs.emplace_back(new mapped_file(path));
+    unlink(path.c_str());
+    m_buffer.clear();
+  }
+
+  std::string            m_dir;
+  size_t                 m_run_edges;
+  int                    m_first_bits;
+  int                    m_second_bits;
+  size_t                 m_num_threads;
+  std::vector<edge_type> m_buffer;
+  std::vector< std::unique_ptr<mapped_file> > m_runs;
+};
+
+}} //end namespace havoqgt::detail
+
+#endif //HAVOQGT_DETAIL_EXTERNAL_EDGE_SORT_HPP_INCLUDED
@@ -140,6 +140,13 @@ inline uint64_t hash_nbits(uint64_t input, int n) {
   return input;
 }
 
+/// splitmix64 finalizer: mixes every input bit into all 64 output bits
+inline uint64_t mix64(uint64_t z) {
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
 
 }} // end namespace havoqgt::detail
 
@@ -72,6 +72,45 @@ bool global_iterator_range_empty(Iterator itr, Iterator itr_end, MPI_Comm comm)
   return ranks_unfinished == 0;
 }
 
+/**
+ * Weight of the edge at an edge container iterator: itr.weight() if the
+ * iterator has one, else 1.
+ */
+template <typename Iterator>
+auto iterator_edge_weight(const Iterator& itr, int)
+    -> decltype(uint64_t(itr.weight())) {
+  return itr.weight();
+}
+
+template <typename Iterator>
+uint64_t iterator_edge_weight(const Iterator&, long) {
+  return 1;
+}
+
+template <typename Iterator>
+uint64_t iterator_edge_weight(const Iterator& itr) {
+  return iterator_edge_weight(itr, 0);
+}
+
+/**
+ * True if an edge container has weighted() and it returns true
+ */
+template <typename Container>
+auto container_weighted(const Container& edges, int)
+    -> decltype(bool(edges.weighted())) {
+  return edges.weighted();
+}
+
+template <typename Container>
+bool container_weighted(const Container&, long) {
+  return false;
+}
+
+template <typename Container>
+bool container_weighted(const Container& edges) {
+  return container_weighted(edges, 0);
+}
+
 }}}
 
 #endif //HAVOQGT_MPI_DETAIL_ITERATOR_HPP_INCLUDED
\ No newline at end of file
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC. 
+ * Produced at the Lawrence Livermore National Laboratory. 
+ * Written by Roger Pearce <rpearce@llnl.gov>. 
+ * LLNL-CODE-644630. 
+ * All rights reserved.
+ * 
+ * This file is part of HavoqGT, Version 0.1. 
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ * 
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ * 
+ * Our Preamble Notice
+ * 
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ * 
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ * 
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ * 
+ */
+
+#ifndef HAVOQGT_DETAIL_MAPPED_FILE_HPP_INCLUDED
+#define HAVOQGT_DETAIL_MAPPED_FILE_HPP_INCLUDED
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string>
+
+namespace havoqgt { namespace detail {
+
+///
+/// Read-only, private mapping of a whole file.  An empty file or a file that
+/// cannot be opened yields an unmapped object with size() == 0; check good().
+///
+class mapped_file {
+public:
+  mapped_file() : m_data(NULL), m_size(0), m_good(false) { }
+
+  explicit mapped_file(const std::string& filename)
+    : m_data(NULL), m_size(0), m_good(false) {
+    open(filename);
+  }
+
+  ~mapped_file() { close(); }
+
+  bool open(const std::string& filename) {
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) == 0) {
+      m_size = st.st_size;
+      m_good = true;
+      if(m_size > 0) {
+        void* ptr = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(ptr == MAP_FAILED) {
+          m_size = 0;
+          m_good = false;
+        } else {
+          m_data = static_cast<const char*>(ptr);
+          madvise(ptr, m_size, MADV_SEQUENTIAL);
+        }
+      }
+    }
+    ::close(fd);
+    return m_good;
+  }
+
+  void close() {
+    if(m_data != NULL) {
+      munmap(const_cast<char*>(m_data), m_size);
+    }
+    m_data = NULL;
+    m_size = 0;
+    m_good = false;
+  }
+
+  bool        good() const { return m_good; }
+  const char* data() const { return m_data; }
+  uint64_t    size() const { return m_size; }
+
+private:
+  mapped_file(const mapped_file&);
+  mapped_file& operator=(const mapped_file&);
+
+  const char* m_data;
+  uint64_t    m_size;
+  bool        m_good;
+};
+
+}} //end namespace havoqgt::detail
+
+#endif //HAVOQGT_DETAIL_MAPPED_FILE_HPP_INCLUDED
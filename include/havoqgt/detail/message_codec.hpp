@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC. 
+ * Produced at the Lawrence Livermore National Laboratory. 
+ * Written by Roger Pearce <rpearce@llnl.gov>. 
+ * LLNL-CODE-644630. 
+ * All rights reserved.
+ * 
+ * This file is part of HavoqGT, Version 0.1. 
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ * 
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ * 
+ * Our Preamble Notice
+ * 
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ * 
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ * 
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ * 
+ */
+
+
+#ifndef HAVOQGT_DETAIL_MESSAGE_CODEC_HPP_INCLUDED
+#define HAVOQGT_DETAIL_MESSAGE_CODEC_HPP_INCLUDED
+
+#include <stdint.h>
+#include <string.h>
+#include <cassert>
+#include <algorithm>
+#include <vector>
+#include <type_traits>
+#include <utility>
+
+namespace havoqgt { namespace detail {
+
+///
+/// Byte-level helpers for compact messages
+///
+
+inline uint8_t* varint_encode(uint64_t val, uint8_t* out) {
+  while(val >= 0x80) {
+    *out++ = uint8_t(val) | 0x80;
+    val >>= 7;
+  }
+  *out++ = uint8_t(val);
+  return out;
+}
+
+inline const uint8_t* varint_decode(const uint8_t* in, uint64_t& val) {
+  val = 0;
+  for(int shift = 0; ; shift += 7) {
+    uint8_t byte = *in++;
+    val |= uint64_t(byte & 0x7F) << shift;
+    if(!(byte & 0x80)) break;
+  }
+  return in;
+}
+
+/// Worst case encoded size of a uint64_t
+static const size_t varint_max_bytes = 10;
+
+/// Maps a signed difference to an unsigned value that stays small when the
+/// difference is small in magnitude.
+inline uint64_t zigzag_encode(uint64_t from, uint64_t to) {
+  int64_t delta = int64_t(to - from);
+  return (uint64_t(delta) << 1) ^ uint64_t(delta >> 63);
+}
+
+inline uint64_t zigzag_decode(uint64_t from, uint64_t zz) {
+  return from + ((zz >> 1) ^ (~(zz & 1) + 1));
+}
+
+///
+/// Minimal LZ77 block codec (LZ4-like token stream, no entropy stage).
+///
+/// Token: high nibble literal count, low nibble match length - 4; a nibble of
+/// 15 continues with varint extension.  Each match is followed by a 2-byte
+/// offset.  The last sequence holds literals only.
+///
+class lz_block_codec {
+public:
+  static const size_t min_match = 4;
+
+  /// Returns the compressed size, or 0 if it would exceed out_capacity.
+  static size_t compress(const uint8_t* in, size_t size,
+                         uint8_t* out, size_t out_capacity) {
+    static const int hash_bits = 12;
+    uint32_t table[1 << hash_bits];
+    std::fill(table, table + (1 << hash_bits), uint32_t(-1));
+
+    const uint8_t* out_begin = out;
+    const uint8_t* out_end   = out + out_capacity;
+    size_t anchor = 0;
+    size_t pos = 0;
+    while(size >= min_match && pos + min_match <= size) {
+      uint32_t seq;
+      memcpy(&seq, in + pos, 4);
+      uint32_t h = (seq * 2654435761U) >> (32 - hash_bits);
+      uint32_t candidate = table[h];
+      table[h] = uint32_t(pos);
+      if(candidate == uint32_t(-1) || pos - candidate > 0xFFFF ||
+         memcmp(in + candidate, in + pos, 4) != 0) {
+        ++pos;
+        continue;
+      }
+      size_t len = min_match;
+      while(pos + len < size && in[candidate + len] == in[pos + len]) {
+        ++len;
+      }
+      out = emit(out, out_end, in + anchor, pos - anchor, len, pos - candidate);
+      if(out == NULL) return 0;
+      pos += len;
+      anchor = pos;
+    }
+    out = emit(out, out_end, in + anchor, size - anchor, 0, 0);
+    if(out == NULL) return 0;
+    return out - out_begin;
+  }
+
+  /// Returns the decompressed size.
+  static size_t decompress(const uint8_t* in, size_t size, uint8_t* out) {
+    const uint8_t* in_end = in + size;
+    uint8_t* out_begin = out;
+    while(in < in_end) {
+      uint8_t token = *in++;
+      uint64_t literals = token >> 4;
+      if(literals == 15) {
+        uint64_t extra;
+        in = varint_decode(in, extra);
+        literals += extra;
+      }
+      memcpy(out, in, literals);
+      in  += literals;
+      out += literals;
+      if(in >= in_end) break;
+      uint64_t len = token & 0x0F;
+      if(len == 15) {
+        uint64_t extra;
+        in = varint_decode(in, extra);
+        len += extra;
+      }
+      len += min_match;
+      uint16_t offset = uint16_t(in[0]) | (uint16_t(in[1]) << 8);
+      in += 2;
+      // byte-wise: matches may overlap their own output
+      for(uint64_t i=0; i<len; ++i, ++out) {
+        *out = *(out - offset);
+      }
+    }
+    return out - out_begin;
+  }
+
+private:
+  static uint8_t* emit(uint8_t* out, const uint8_t* out_end,
+                       const uint8_t* literals, size_t num_literals,
+                       size_t match_len, size_t offset) {
+    if(out + 1 + 2*varint_max_bytes + num_literals + 2 > out_end) {
+      return NULL;
+    }
+    uint8_t* token = out++;
+    *token = uint8_t(std::min(num_literals, size_t(15)) << 4);
+    if(num_literals >= 15) {
+      out = varint_encode(num_literals - 15, out);
+    }
+    memcpy(out, literals, num_literals);
+    out += num_literals;
+    if(match_len > 0) {
+      size_t len = match_len - min_match;
+      *token |= uint8_t(std::min(len, size_t(15)));
+      if(len >= 15) {
+        out = varint_encode(len - 15, out);
+      }
+      *out++ = uint8_t(offset);
+      *out++ = uint8_t(offset >> 8);
+    }
+    return out;
+  }
+};
+
+///
+/// Compact encoding of a buffer of routed messages.
+///
+/// Messages are sorted by their vertex_locator.  Each one is written as a
+/// flag byte, the owner/dest (only when it changes) and the local_id as a
+/// varint delta from the previous message with the same owner; the rest of
+/// the message is split in 64-bit words, each XOR-ed with the previous
+/// message's word and written as a varint.  Repeated fields such as BFS
+/// levels or a shared parent then take one byte.
+///
+/// TMsg must be trivially copyable and expose locator(), a vertex_locator
+/// with flags(), owner(), local_id() and from_parts().
+///
+template <typename TMsg>
+class locator_message_codec {
+public:
+  /// Upper bound of encode()'s output for count messages
+  static size_t max_encoded_size(size_t count) {
+    return varint_max_bytes + count * (1 + 2*varint_max_bytes +
+                                       num_words() * varint_max_bytes);
+  }
+
+  /// Sorts msgs in place and writes them to out.
+  static size_t encode(TMsg* msgs, size_t count, uint8_t* out) {
+    std::sort(msgs, msgs + count, locator_less());
+    uint8_t* out_begin = out;
+    out = varint_encode(count, out);
+    uint64_t prev_words[s_max_words] = {0};
+    uint64_t prev_local_id = 0;
+    uint32_t prev_owner = uint32_t(-1);
+    uint32_t prev_delegate = 0;
+    for(size_t i=0; i<count; ++i) {
+      const locator_type& loc = msgs[i].locator();
+      uint32_t flags = loc.flags();
+      bool same = loc.owner() == prev_owner &&
+                  (flags & 1) == prev_delegate;
+      *out++ = uint8_t(flags | (same ? s_same_owner : 0));
+      if(same) {
+        assert(loc.local_id() >= prev_local_id);
+        out = varint_encode(loc.local_id() - prev_local_id, out);
+      } else {
+        out = varint_encode(loc.owner(), out);
+        out = varint_encode(loc.local_id(), out);
+      }
+      prev_owner = loc.owner();
+      prev_delegate = flags & 1;
+      prev_local_id = loc.local_id();
+
+      uint64_t words[s_max_words];
+      to_words(msgs[i], words);
+      for(size_t w=0; w<num_words(); ++w) {
+        out = varint_encode(words[w] ^ prev_words[w], out);
+        prev_words[w] = words[w];
+      }
+    }
+    return out - out_begin;
+  }
+
+  /// Returns the number of messages written to out.
+  static size_t decode(const uint8_t* in, TMsg* out) {
+    uint64_t count;
+    in = varint_decode(in, count);
+    uint64_t prev_words[s_max_words] = {0};
+    uint64_t local_id = 0;
+    uint64_t owner = 0;
+    for(size_t i=0; i<count; ++i) {
+      uint8_t flags = *in++;
+      uint64_t val;
+      if(flags & s_same_owner) {
+        in = varint_decode(in, val);
+        local_id += val;
+      } else {
+        in = varint_decode(in, owner);
+        in = varint_decode(in, local_id);
+      }
+      uint64_t words[s_max_words];
+      for(size_t w=0; w<num_words(); ++w) {
+        in = varint_decode(in, val);
+        words[w] = val ^ prev_words[w];
+        prev_words[w] = words[w];
+      }
+      from_words(words, out[i]);
+      out[i].locator() = locator_type::from_parts(flags & ~s_same_owner,
+                                                  owner, local_id);
+    }
+    return count;
+  }
+
+private:
+  typedef typename std::remove_reference<
+      decltype(std::declval<TMsg&>().locator())>::type locator_type;
+
+  static const uint8_t s_same_owner = 0x80;
+  static const size_t  s_payload_bytes = sizeof(TMsg) - sizeof(locator_type);
+  static const size_t  s_max_words = (s_payload_bytes + 7) / 8 + 1;
+
+  static size_t num_words() { return (s_payload_bytes + 7) / 8; }
+
+  struct locator_less {
+    bool operator()(const TMsg& a, const TMsg& b) const {
+      return a.locator() < b.locator();
+    }
+  };
+
+  static size_t locator_offset(const TMsg& msg) {
+    return reinterpret_cast<const uint8_t*>(&msg.locator()) -
+           reinterpret_cast<const uint8_t*>(&msg);
+  }
+
+  /// Every byte of msg except its locator, zero padded to whole words
+  static void to_words(const TMsg& msg, uint64_t* words) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&msg);
+    uint8_t payload[s_max_words * 8] = {0};
+    size_t offset = locator_offset(msg);
+    memcpy(payload, bytes, offset);
+    memcpy(payload + offset, bytes + offset + sizeof(locator_type),
+           sizeof(TMsg) - offset - sizeof(locator_type));
+    memcpy(words, payload, num_words() * 8);
+  }
+
+  static void from_words(const uint64_t* words, TMsg& msg) {
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(&msg);
+    uint8_t payload[s_max_words * 8];
+    memcpy(payload, words, num_words() * 8);
+    size_t offset = locator_offset(msg);
+    memcpy(bytes, payload, offset);
+    memcpy(bytes + offset + sizeof(locator_type), payload + offset,
+           sizeof(TMsg) - offset - sizeof(locator_type));
+  }
+};
+
+}} //end namespace havoqgt::detail
+
+#endif //HAVOQGT_DETAIL_MESSAGE_CODEC_HPP_INCLUDED
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC. 
+ * Produced at the Lawrence Livermore National Laboratory. 
+ * Written by Roger Pearce <rpearce@llnl.gov>. 
+ * LLNL-CODE-644630. 
+ * All rights reserved.
+ * 
+ * This file is part of HavoqGT, Version 0.1. 
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ * 
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ * 
+ * Our Preamble Notice
+ * 
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ * 
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ * 
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ * 
+ */
+
+#ifndef HAVOQGT_DETAIL_RADIX_SORT_HPP_INCLUDED
+#define HAVOQGT_DETAIL_RADIX_SORT_HPP_INCLUDED
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+#include <algorithm>
+#include <stdint.h>
+
+namespace havoqgt { namespace detail {
+
+/// Number of significant bits of x (0 for 0)
+inline int significant_bits(uint64_t x) {
+  return x == 0 ? 0 : 64 - __builtin_clzll(x);
+}
+
+///
+/// Reusable barrier for a fixed group of threads.
+///
+class thread_barrier {
+public:
+  explicit thread_barrier(size_t count)
+    : m_count(count), m_waiting(0), m_generation(0) { }
+
+  void wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    size_t generation = m_generation;
+    if(++m_waiting == m_count) {
+      m_waiting = 0;
+      ++m_generation;
+      m_cond.notify_all();
+    } else {
+      m_cond.wait(lock, [&] { return generation != m_generation; });
+    }
+  }
+
+private:
+  std::mutex              m_mutex;
+  std::condition_variable m_cond;
+  size_t                  m_count;
+  size_t                  m_waiting;
+  size_t                  m_generation;
+};
+
+///
+/// Stable LSD radix sort core: pass d orders elements by digit_of(x, d),
+/// a value below 1 << digit_bits, keeping the order of earlier passes.
+///
+/// Large inputs are split into num_threads contiguous blocks: each thread
+/// histograms and scatters its own block, and per-(digit, thread) offsets
+/// keep every pass stable.  A pass whose digit is the same for every element
+/// is skipped.
+///
+template <typename T, typename DigitOf>
+void lsd_radix_sort(std::vector<T>& data, size_t num_passes, int digit_bits,
+                    DigitOf digit_of, size_t num_threads) {
+  static const size_t min_per_thread = size_t(1) << 15;
+  const size_t num_buckets = size_t(1) << digit_bits;
+  const size_t n = data.size();
+  num_threads = std::max(size_t(1), std::min(num_threads, n / min_per_thread));
+
+  std::vector<T> buffer(n);
+  std::vector<T>* src = &data;
+  std::vector<T>* dst = &buffer;
+  std::vector<size_t> counts(num_threads * num_buckets);
+  std::vector<char> skip(num_passes);
+  thread_barrier barrier(num_threads);
+
+  auto worker = [&](size_t tid) {
+    const size_t begin = n * tid / num_threads;
+    const size_t end   = n * (tid + 1) / num_threads;
+    size_t* my_counts = &counts[tid * num_buckets];
+    for(size_t d = 0; d < num_passes; ++d) {
+      std::fill(my_counts, my_counts + num_buckets, 0);
+      for(size_t i = begin; i < end; ++i) {
+        ++my_counts[digit_of((*src)[i], d)];
+      }
+      barrier.wait();
+
+      // Thread 0 turns counts into scatter offsets, bucket-major.
+      if(tid == 0) {
+        size_t offset = 0;
+        size_t nonempty = 0;
+        for(size_t b = 0; b < num_buckets; ++b) {
+          size_t bucket_total = 0;
+          for(size_t t = 0; t < num_threads; ++t) {
+            size_t c = counts[t * num_buckets + b];
+            counts[t * num_buckets + b] = offset;
+            offset += c;
+            bucket_total += c;
+          }
+          nonempty += (bucket_total > 0);
+        }
+        skip[d] = (nonempty <= 1);
+      }
+      barrier.wait();
+
+      if(!skip[d]) {
+        for(size_t i = begin; i < end; ++i) {
+          const T& x = (*src)[i];
+          (*dst)[my_counts[digit_of(x, d)]++] = x;
+        }
+      }
+      barrier.wait();
+      if(tid == 0 && !skip[d]) {
+        std::swap(src, dst);
+      }
+      barrier.wait();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for(size_t t = 1; t < num_threads; ++t) {
+    threads.emplace_back(worker, t);
+  }
+  worker(0);
+  for(size_t t = 0; t < threads.size(); ++t) {
+    threads[t].join();
+  }
+
+  if(src != &data) {
+    data.swap(buffer);
+  }
+}
+
+///
+/// Sorts (first, second) pairs into lexicographic order with an LSD radix
+/// sort over only the low first_bits of first and second_bits of second;
+/// higher bits must be zero.
+///
+/// When both fit in 64 bits the pairs are packed into single keys, halving
+/// the bytes moved per pass.  Digits are 11 bits.  Small inputs fall back to
+/// std::sort.
+///
+inline void radix_sort_pairs(std::vector< std::pair<uint64_t, uint64_t> >& data,
+                             int first_bits, int second_bits,
+                             size_t num_threads = 1) {
+  typedef std::pair<uint64_t, uint64_t> pair_type;
+  static const int    digit_bits = 11;
+  static const uint64_t digit_mask = (uint64_t(1) << digit_bits) - 1;
+  static const size_t min_radix  = 256;
+
+  if(data.size() < min_radix) {
+    std::sort(data.begin(), data.end());
+    return;
+  }
+  const size_t first_passes  = (first_bits + digit_bits - 1) / digit_bits;
+  const size_t second_passes = (second_bits + digit_bits - 1) / digit_bits;
+
+  if(first_bits + second_bits <= 64) {
+    const int total_bits = first_bits + second_bits;
+    std::vector<uint64_t> keys(data.size());
+    for(size_t i = 0; i < data.size(); ++i) {
+      keys[i] = (first_bits == 0 ? 0 : data[i].first << second_bits)
+              | data[i].second;
+    }
+    lsd_radix_sort(keys, (total_bits + digit_bits - 1) / digit_bits, digit_bits,
+        [](uint64_t key, size_t d) {
+          return (key >> (d * digit_bits)) & digit_mask;
+        }, num_threads);
+    const uint64_t second_mask = second_bits == 64 ? ~uint64_t(0)
+                               : (uint64_t(1) << second_bits) - 1;
+    for(size_t i = 0; i < data.size(); ++i) {
+      data[i].first  = second_bits == 64 ? 0 : keys[i] >> second_bits;
+      data[i].second = keys[i] & second_mask;
+    }
+    return;
+  }
+
+  lsd_radix_sort(data, second_passes + first_passes, digit_bits,
+      [second_passes](const pair_type& p, size_t d) {
+        return d < second_passes
+             ? (p.second >> (d * digit_bits)) & digit_mask
+             : (p.first >> ((d - second_passes) * digit_bits)) & digit_mask;
+      }, num_threads);
+}
+
+///
+/// Sorts records derived from std::pair<uint64_t, uint64_t> by that pair,
+/// as radix_sort_pairs does, moving the rest of each record along.
+///
+template <typename Record>
+void radix_sort_pairs(std::vector<Record>& data, int first_bits,
+                      int second_bits, size_t num_threads = 1) {
+  typedef std::pair<uint64_t, uint64_t> pair_type;
+  static const int    digit_bits = 11;
+  static const uint64_t digit_mask = (uint64_t(1) << digit_bits) - 1;
+  static const size_t min_radix  = 256;
+
+  if(data.size() < min_radix) {
+    std::sort(data.begin(), data.end(), [](const Record& a, const Record& b) {
+      return static_cast<const pair_type&>(a) < static_cast<const pair_type&>(b);
+    });
+    return;
+  }
+  const size_t first_passes  = (first_bits + digit_bits - 1) / digit_bits;
+  const size_t second_passes = (second_bits + digit_bits - 1) / digit_bits;
+  lsd_radix_sort(data, second_passes + first_passes, digit_bits,
+      [second_passes](const Record& p, size_t d) {
+        return d < second_passes
+             ? (p.second >> (d * digit_bits)) & digit_mask
+             : (p.first >> ((d - second_passes) * digit_bits)) & digit_mask;
+      }, num_threads);
+}
+
+}} //end namespace havoqgt::detail
+
+#endif //HAVOQGT_DETAIL_RADIX_SORT_HPP_INCLUDED
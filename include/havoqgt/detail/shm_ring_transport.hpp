@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC. 
+ * Produced at the Lawrence Livermore National Laboratory. 
+ * Written by Roger Pearce <rpearce@llnl.gov>. 
+ * LLNL-CODE-644630. 
+ * All rights reserved.
+ * 
+ * This file is part of HavoqGT, Version 0.1. 
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ * 
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ * 
+ * Our Preamble Notice
+ * 
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ * 
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ * 
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ * 
+ */
+
+
+#ifndef HAVOQGT_DETAIL_SHM_RING_TRANSPORT_HPP_INCLUDED
+#define HAVOQGT_DETAIL_SHM_RING_TRANSPORT_HPP_INCLUDED
+
+#include <havoqgt/mpi.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+#include <cassert>
+#include <sstream>
+#include <vector>
+
+namespace havoqgt { namespace detail {
+
+///
+/// Node-local transport of whole message buffers through a POSIX
+/// shared-memory segment.
+///
+/// The segment holds one single-producer/single-consumer ring per ordered
+/// pair of node-local ranks; ring (p, c) is written only by p and read only
+/// by c, so head and tail need no locks, only acquire/release ordering.  A
+/// ring has a fixed number of slots, each large enough for one mailbox
+/// buffer; when it is full, try_send() fails and the caller uses MPI.
+///
+class shm_ring_transport {
+public:
+  shm_ring_transport()
+    : m_base(NULL), m_segment_bytes(0), m_local_rank(0), m_local_size(0)
+    , m_slot_bytes(0), m_num_slots(0), m_ring_bytes(0), m_next_poll(0)
+    , m_peek_ring(NULL) { }
+
+  ~shm_ring_transport() {
+    if(m_base != NULL) {
+      munmap(m_base, m_segment_bytes);
+    }
+  }
+
+  /// Collective over comm.  node_local_comm must group the ranks of comm
+  /// that share a node.  Leaves the transport disabled if the segment cannot
+  /// be created on some rank of the node.
+  void init(MPI_Comm comm, MPI_Comm node_local_comm, size_t max_buffer_bytes,
+            size_t num_slots) {
+    int rank, size;
+    CHK_MPI( MPI_Comm_rank(comm, &rank) );
+    CHK_MPI( MPI_Comm_size(comm, &size) );
+    CHK_MPI( MPI_Comm_rank(node_local_comm, &m_local_rank) );
+    CHK_MPI( MPI_Comm_size(node_local_comm, &m_local_size) );
+
+    std::vector<int> local_to_rank(m_local_size);
+    CHK_MPI( MPI_Allgather(&rank, 1, MPI_INT, &(local_to_rank[0]), 1, MPI_INT,
+                           node_local_comm) );
+    m_rank_to_local.assign(size, -1);
+    for(int i=0; i<m_local_size; ++i) {
+      m_rank_to_local[local_to_rank[i]] = i;
+    }
+
+    // Unique per job, node and transport instance.
+    static uint32_t instance = 0;
+    int job_id = getpid();
+    CHK_MPI( MPI_Bcast(&job_id, 1, MPI_INT, 0, comm) );
+    std::stringstream name;
+    name << "/havoqgt_shm_" << job_id << "_" << local_to_rank[0] << "_"
+         << instance++;
+
+    m_num_slots = num_slots;
+    m_slot_bytes = round_up(sizeof(uint64_t) + max_buffer_bytes);
+    m_ring_bytes = round_up(sizeof(ring_header)) + m_num_slots * m_slot_bytes;
+    m_segment_bytes = m_ring_bytes * m_local_size * m_local_size;
+
+    int ok = 1;
+    if(m_local_rank == 0) {
+      int fd = shm_open(name.str().c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+      ok = fd >= 0 && ftruncate(fd, m_segment_bytes) == 0;
+      if(fd >= 0) close(fd);
+    }
+    CHK_MPI( MPI_Bcast(&ok, 1, MPI_INT, 0, node_local_comm) );
+    if(ok) {
+      int fd = shm_open(name.str().c_str(), O_RDWR, 0600);
+      if(fd >= 0) {
+        void* ptr = mmap(NULL, m_segment_bytes, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd, 0);
+        close(fd);
+        if(ptr != MAP_FAILED) {
+          m_base = static_cast<uint8_t*>(ptr);
+        }
+      }
+    }
+    // The segment was zero filled by ftruncate, so rings start empty.
+    int all_ok = (m_base != NULL);
+    CHK_MPI( MPI_Allreduce(MPI_IN_PLACE, &all_ok, 1, MPI_INT, MPI_MIN,
+                           node_local_comm) );
+    if(m_local_rank == 0 && ok) {
+      shm_unlink(name.str().c_str());
+    }
+    if(!all_ok && m_base != NULL) {
+      munmap(m_base, m_segment_bytes);
+      m_base = NULL;
+    }
+  }
+
+  bool enabled() const { return m_base != NULL; }
+
+  bool is_node_local(int rank) const {
+    return enabled() && m_rank_to_local[rank] >= 0;
+  }
+
+  /// Copies a buffer into the ring to node-local rank; false if it is full.
+  bool try_send(int rank, const void* data, size_t bytes) {
+    assert(is_node_local(rank));
+    assert(sizeof(uint64_t) + bytes <= m_slot_bytes);
+    ring_header* ring = get_ring(m_local_rank, m_rank_to_local[rank]);
+    uint64_t tail = ring->tail;  // only written by this rank
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if(tail - head >= m_num_slots) {
+      return false;
+    }
+    uint8_t* slot = get_slot(ring, tail);
+    uint64_t size = bytes;
+    memcpy(slot, &size, sizeof(size));
+    memcpy(slot + sizeof(size), data, bytes);
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  /// Oldest unread buffer from some node-local rank, polled round-robin, or
+  /// NULL.  The buffer stays valid until release().
+  const void* peek(size_t& bytes) {
+    assert(m_peek_ring == NULL);
+    for(int i=0; i<m_local_size; ++i) {
+      int producer = (m_next_poll + i) % m_local_size;
+      ring_header* ring = get_ring(producer, m_local_rank);
+      uint64_t head = ring->head;  // only written by this rank
+      if(head != __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+        m_next_poll = producer + 1;
+        m_peek_ring = ring;
+        uint8_t* slot = get_slot(ring, head);
+        uint64_t size;
+        memcpy(&size, slot, sizeof(size));
+        bytes = size;
+        return slot + sizeof(size);
+      }
+    }
+    return NULL;
+  }
+
+  void release() {
+    assert(m_peek_ring != NULL);
+    __atomic_store_n(&m_peek_ring->head, m_peek_ring->head + 1,
+                     __ATOMIC_RELEASE);
+    m_peek_ring = NULL;
+  }
+
+private:
+  struct ring_header {
+    uint64_t head;          // next slot to read, written by the consumer
+    uint8_t  pad[56];
+    uint64_t tail;          // next slot to write, written by the producer
+  };
+
+  static size_t round_up(size_t bytes) { return (bytes + 63) & ~size_t(63); }
+
+  ring_header* get_ring(int producer, int consumer) const {
+    size_t index = size_t(producer) * m_local_size + consumer;
+    return reinterpret_cast<ring_header*>(m_base + index * m_ring_bytes);
+  }
+
+  uint8_t* get_slot(ring_header* ring, uint64_t pos) const {
+    return reinterpret_cast<uint8_t*>(ring) + round_up(sizeof(ring_header))
+           + (pos % m_num_slots) * m_slot_bytes;
+  }
+
+  uint8_t*         m_base;
+  size_t           m_segment_bytes;
+  int              m_local_rank;
+  int              m_local_size;
+  size_t           m_slot_bytes;
+  size_t           m_num_slots;
+  size_t           m_ring_bytes;
+  int              m_next_poll;
+  ring_header*     m_peek_ring;
+  std::vector<int> m_rank_to_local;
+};
+
+}} //end namespace havoqgt::detail
+
+#endif //HAVOQGT_DETAIL_SHM_RING_TRANSPORT_HPP_INCLUDED
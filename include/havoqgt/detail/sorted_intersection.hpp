@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC. 
+ * Produced at the Lawrence Livermore National Laboratory. 
+ * Written by Roger Pearce <rpearce@llnl.gov>. 
+ * LLNL-CODE-644630. 
+ * All rights reserved.
+ * 
+ * This file is part of HavoqGT, Version 0.1. 
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ * 
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ * 
+ * Our Preamble Notice
+ * 
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ * 
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ * 
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ * 
+ */
+
+
+#ifndef HAVOQGT_DETAIL_SORTED_INTERSECTION_HPP_INCLUDED
+#define HAVOQGT_DETAIL_SORTED_INTERSECTION_HPP_INCLUDED
+
+#include <stdint.h>
+#include <algorithm>
+#include <iterator>
+
+namespace havoqgt { namespace detail {
+
+///
+/// Intersection of sorted ranges.  The first range must be free of
+/// duplicates; matches are counted once per element of the first range.
+///
+
+/// Linear merge, best when both ranges have similar lengths
+template <typename Iter1, typename Iter2>
+uint64_t merge_intersection_count(Iter1 first1, Iter1 last1,
+                                  Iter2 first2, Iter2 last2) {
+  uint64_t count = 0;
+  while(first1 != last1 && first2 != last2) {
+    if(*first1 < *first2) {
+      ++first1;
+    } else if(*first2 < *first1) {
+      ++first2;
+    } else {
+      ++count;
+      ++first1;
+      ++first2;
+    }
+  }
+  return count;
+}
+
+/// First position in [first, last) not less than value, found by doubling
+/// the step from first and then binary searching the last step.
+template <typename Iter, typename T>
+Iter gallop_lower_bound(Iter first, Iter last, const T& value) {
+  typedef typename std::iterator_traits<Iter>::difference_type diff_type;
+  if(first == last || !(*first < value)) {
+    return first;
+  }
+  const diff_type len = last - first;
+  diff_type lo = 0;
+  diff_type step = 1;
+  while(lo + step < len && first[lo + step] < value) {
+    lo += step;
+    step *= 2;
+  }
+  return std::lower_bound(first + lo + 1,
+                          first + std::min(lo + step + 1, len), value);
+}
+
+/// Galloping search of each element of a short range in a long one
+template <typename Iter1, typename Iter2>
+uint64_t gallop_intersection_count(Iter1 first1, Iter1 last1,
+                                   Iter2 first2, Iter2 last2) {
+  uint64_t count = 0;
+  for(; first1 != last1; ++first1) {
+    first2 = gallop_lower_bound(first2, last2, *first1);
+    if(first2 == last2) {
+      break;
+    }
+    if(!(*first1 < *first2)) {
+      ++count;
+      ++first2;
+    }
+  }
+  return count;
+}
+
+/// Picks galloping when the second range is much longer than the first
+template <typename Iter1, typename Iter2>
+uint64_t sorted_intersection_count(Iter1 first1, Iter1 last1,
+                                   Iter2 first2, Iter2 last2) {
+  const uint64_t len1 = std::distance(first1, last1);
+  const uint64_t len2 = std::distance(first2, last2);
+  if(len2 > 16 * len1) {
+    return gallop_intersection_count(first1, last1, first2, last2);
+  }
+  return merge_intersection_count(first1, last1, first2, last2);
+}
+
+}} //end namespace havoqgt::detail
+
+#endif //HAVOQGT_DETAIL_SORTED_INTERSECTION_HPP_INCLUDED
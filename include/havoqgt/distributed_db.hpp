@@ -63,6 +63,7 @@
 
 #include <string>
 #include <sstream>
+#include <fstream>
 #include <stdlib.h>
 
 #include <sys/types.h>
@@ -79,6 +80,7 @@ namespace havoqgt {
  */
 class db_create {};
 class db_open {};
+class db_resume {};
 
 /**
  *
@@ -146,10 +148,56 @@ public:
     phead->clean_close = false;
   }
 
+  /**
+   * Opens an existing db; grow_bytes > 0 first extends each rank's file,
+   * e.g. to make room for edges added to a stored graph.
+   */
+  distributed_db(db_open, const char* base_fname, uint64_t grow_bytes = 0)
+  {
+    open_existing(base_fname, true, grow_bytes);
+  }
+
+  /**
+   * Opens a db that was not closed cleanly, e.g. to resume an interrupted
+   * graph construction from its last completed phase.
+   */
+  distributed_db(db_resume, const char* base_fname)
+  {
+    open_existing(base_fname, false, 0);
+  }
+
+  /**
+   *
+   */
+  ~distributed_db()
+  {
+    //
+    // Mark clean close
+    std::pair<header*, std::size_t> ret = m_pm->find<header>(boost::interprocess::unique_instance);
+    if(ret.second == 0) {
+      std::stringstream error;
+      error << "ERROR: " << __FILE__ << ":" << __LINE__ << ": header now found.";
+      throw std::runtime_error(error.str());
+    }
+    ret.first->clean_close = true;
+
+    delete m_pm;
+    m_pm = nullptr;
+    bool shrink_ret = mapped_type::shrink_to_fit(m_rank_filename.c_str());
+  }
+
+  segment_manager_type* get_segment_manager()
+  {
+    return m_pm->get_segment_manager();
+  }
+
+private:
+
   /**
    *
    */
-  distributed_db(db_open, const char* base_fname)
+  void open_existing(const char* base_fname, bool require_clean_close,
+                     uint64_t grow_bytes)
   {
     int mpi_rank = havoqgt_env()->world_comm().rank();
     int mpi_size = havoqgt_env()->world_comm().size();
@@ -161,6 +209,13 @@ public:
       error << "ERROR: " << __FILE__ << ":" << __LINE__ << ": file not found.";
       throw std::runtime_error(error.str());
     }
+
+    if(grow_bytes > 0 &&
+       !mapped_type::grow(m_rank_filename.c_str(), grow_bytes)) {
+      std::stringstream error;
+      error << "ERROR: " << __FILE__ << ":" << __LINE__ << ": grow failed.";
+      throw std::runtime_error(error.str());
+    }
      
     m_pm = new mapped_type(boost::interprocess::open_only, m_rank_filename.c_str()); 
 
@@ -189,40 +244,13 @@ public:
     //std::cout << "Rank = " << mpi_rank << ", UUID = " << ret.first->uuid << std::endl;
     if(ret.first->comm_rank != mpi_rank ||
        ret.first->comm_size != mpi_size ||
-       !ret.first->clean_close) {
+       (require_clean_close && !ret.first->clean_close)) {
       std::stringstream error;
       error << "ERROR: " << __FILE__ << ":" << __LINE__ << ": DB corrupt.";
       throw std::runtime_error(error.str());
     }
   }
 
-  /**
-   *
-   */
-  ~distributed_db()
-  {
-    //
-    // Mark clean close
-    std::pair<header*, std::size_t> ret = m_pm->find<header>(boost::interprocess::unique_instance);
-    if(ret.second == 0) {
-      std::stringstream error;
-      error << "ERROR: " << __FILE__ << ":" << __LINE__ << ": header now found.";
-      throw std::runtime_error(error.str());
-    }
-    ret.first->clean_close = true;
-
-    delete m_pm;
-    m_pm = nullptr;
-    bool shrink_ret = mapped_type::shrink_to_fit(m_rank_filename.c_str());
-  }
-
-  segment_manager_type* get_segment_manager()
-  {
-    return m_pm->get_segment_manager();
-  }
-
-private:
-
   /**
    *
    */
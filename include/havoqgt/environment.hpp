@@ -55,7 +55,10 @@
 #include <iostream>
 #include <stdexcept>
 #include <sstream>
+#include <string>
 #include <cstdlib>
+#include <thread>
+#include <algorithm>
 #include <boost/lexical_cast.hpp>
 
 #include <havoqgt/error.hpp>
@@ -74,6 +77,19 @@ public:
     m_mailbox_aggregation = get_env_var<uint32_t>("HAVOQGT_MAILBOX_AGGREGATION", 1024);
     m_mailbox_tree_aggregation = get_env_var<uint32_t>("HAVOQGT_MAILBOX_TREE_AGGREGATION", 64);
     m_mailbox_print_stats = get_env_var<bool>    ("HAVOQGT_MAILBOX_PRINT_STATS", false);
+    m_mailbox_compression = get_env_var<uint32_t>("HAVOQGT_MAILBOX_COMPRESSION", 0);
+    m_mailbox_shm         = get_env_var<bool>    ("HAVOQGT_MAILBOX_SHM", false);
+    m_mailbox_shm_slots   = get_env_var<uint32_t>("HAVOQGT_MAILBOX_SHM_SLOTS", 4);
+    m_visitor_threads     = get_env_var<uint32_t>("HAVOQGT_VISITOR_THREADS", 1);
+    m_ingest_threads      = get_env_var<uint32_t>("HAVOQGT_INGEST_THREADS", 0);
+    m_ingest_stage        = get_env_var<bool>    ("HAVOQGT_INGEST_STAGE", true);
+    m_ingest_scratch      = get_env_var<std::string>("HAVOQGT_INGEST_SCRATCH", "");
+    m_hub_sketch          = get_env_var<bool>    ("HAVOQGT_HUB_SKETCH", false);
+    m_external_sort_mb    = get_env_var<uint64_t>("HAVOQGT_EXTERNAL_SORT_MB", 0);
+    m_range_partition     = get_env_var<bool>    ("HAVOQGT_RANGE_PARTITION", false);
+    m_delta_compact_percent = get_env_var<uint32_t>("HAVOQGT_DELTA_COMPACT_PERCENT", 10);
+    m_delegate_imbalance_percent = get_env_var<uint32_t>("HAVOQGT_DELEGATE_IMBALANCE_PERCENT", 10);
+    m_delegate_max        = get_env_var<uint64_t>("HAVOQGT_DELEGATE_MAX", 1048576);
   }
 
   uint32_t mailbox_num_irecv()   const { return m_mailbox_num_irecv; }
@@ -81,6 +97,34 @@ public:
   uint32_t mailbox_aggregation() const { return m_mailbox_aggregation; }
   uint32_t mailbox_tree_aggregation() const { return m_mailbox_tree_aggregation; }
   bool     mailbox_print_stats() const { return m_mailbox_print_stats; }
+  /// 0: raw messages, 1: delta/varint encoded, 2: varint + LZ block codec
+  uint32_t mailbox_compression() const { return m_mailbox_compression; }
+  /// Send node-local buffers through shared-memory rings instead of MPI
+  bool     mailbox_shm()         const { return m_mailbox_shm; }
+  /// Buffers per shared-memory ring
+  uint32_t mailbox_shm_slots()   const { return m_mailbox_shm_slots; }
+  uint32_t visitor_threads()     const { return m_visitor_threads; }
+  /// Edge list parsing threads per rank; 0 divides the node's cores evenly
+  uint32_t ingest_threads()      const { return m_ingest_threads; }
+  /// Keep parsed edges from the first pass instead of re-parsing the input
+  bool     ingest_stage()        const { return m_ingest_stage; }
+  /// Directory for the staged edges; empty keeps them in memory
+  const std::string& ingest_scratch() const { return m_ingest_scratch; }
+  /// Find delegates with a Count-Min sketch instead of exact degree maps
+  bool     hub_sketch()          const { return m_hub_sketch; }
+  /// Run size for the external sort of low edges; 0 scatters in memory
+  uint64_t external_sort_mb()    const { return m_external_sort_mb; }
+  /// Own contiguous label ranges balanced by edges instead of label % ranks
+  bool     range_partition()     const { return m_range_partition; }
+  /// Delta size, in percent of the graph's edges, that triggers compact();
+  /// 0 leaves compaction to the caller
+  uint32_t delta_compact_percent() const { return m_delta_compact_percent; }
+  /// With an automatic delegate threshold (0), the largest predicted edge
+  /// imbalance over the mean, in percent, that the threshold may leave
+  uint32_t delegate_imbalance_percent() const { return m_delegate_imbalance_percent; }
+  /// With an automatic delegate threshold (0), the most delegates it may
+  /// pick, even if the imbalance is then larger
+  uint64_t delegate_max()        const { return m_delegate_max; }
 
   template <typename T>
   inline T get_env_var(const char* key, T default_val) const;
@@ -93,15 +137,41 @@ private:
   uint32_t  m_mailbox_aggregation;
   uint32_t  m_mailbox_tree_aggregation;
   bool      m_mailbox_print_stats;
+  uint32_t  m_mailbox_compression;
+  bool      m_mailbox_shm;
+  uint32_t  m_mailbox_shm_slots;
+  uint32_t  m_visitor_threads;
+  uint32_t  m_ingest_threads;
+  bool      m_ingest_stage;
+  std::string m_ingest_scratch;
+  bool      m_hub_sketch;
+  uint64_t  m_external_sort_mb;
+  bool      m_range_partition;
+  uint32_t  m_delta_compact_percent;
+  uint32_t  m_delegate_imbalance_percent;
+  uint64_t  m_delegate_max;
 };
 
 inline void
 old_environment::print() const {
-  std::cout << "HAVOQGT_MAILBOX_NUM_IRECV        "<< " = " << m_mailbox_num_irecv << std::endl;
-  std::cout << "HAVOQGT_MAILBOX_NUM_ISEND        "<< " = " << m_mailbox_num_isend << std::endl;
-  std::cout << "HAVOQGT_MAILBOX_AGGREGATION      "<< " = " << m_mailbox_aggregation << std::endl;
-  std::cout << "HAVOQGT_MAILBOX_TREE_AGGREGATION "<< " = " << m_mailbox_tree_aggregation << std::endl;
-  std::cout << "HAVOQGT_MAILBOX_PRINT_STATS      "<< " = " << m_mailbox_print_stats << std::endl;
+  std::cout << "HAVOQGT_MAILBOX_NUM_IRECV         "<< " = " << m_mailbox_num_irecv << std::endl;
+  std::cout << "HAVOQGT_MAILBOX_NUM_ISEND         "<< " = " << m_mailbox_num_isend << std::endl;
+  std::cout << "HAVOQGT_MAILBOX_AGGREGATION       "<< " = " << m_mailbox_aggregation << std::endl;
+  std::cout << "HAVOQGT_MAILBOX_TREE_AGGREGATION  "<< " = " << m_mailbox_tree_aggregation << std::endl;
+  std::cout << "HAVOQGT_MAILBOX_PRINT_STATS       "<< " = " << m_mailbox_print_stats << std::endl;
+  std::cout << "HAVOQGT_MAILBOX_COMPRESSION       "<< " = " << m_mailbox_compression << std::endl;
+  std::cout << "HAVOQGT_MAILBOX_SHM               "<< " = " << m_mailbox_shm << std::endl;
+  std::cout << "HAVOQGT_MAILBOX_SHM_SLOTS         "<< " = " << m_mailbox_shm_slots << std::endl;
+  std::cout << "HAVOQGT_VISITOR_THREADS           "<< " = " << m_visitor_threads << std::endl;
+  std::cout << "HAVOQGT_INGEST_THREADS            "<< " = " << m_ingest_threads << std::endl;
+  std::cout << "HAVOQGT_INGEST_STAGE              "<< " = " << m_ingest_stage << std::endl;
+  std::cout << "HAVOQGT_INGEST_SCRATCH            "<< " = " << m_ingest_scratch << std::endl;
+  std::cout << "HAVOQGT_HUB_SKETCH                "<< " = " << m_hub_sketch << std::endl;
+  std::cout << "HAVOQGT_EXTERNAL_SORT_MB          "<< " = " << m_external_sort_mb << std::endl;
+  std::cout << "HAVOQGT_RANGE_PARTITION           "<< " = " << m_range_partition << std::endl;
+  std::cout << "HAVOQGT_DELTA_COMPACT_PERCENT     "<< " = " << m_delta_compact_percent << std::endl;
+  std::cout << "HAVOQGT_DELEGATE_IMBALANCE_PERCENT"<< " = " << m_delegate_imbalance_percent << std::endl;
+  std::cout << "HAVOQGT_DELEGATE_MAX              "<< " = " << m_delegate_max << std::endl;
 }
 
 template <typename T>
@@ -252,6 +322,17 @@ inline void havoqgt_finalize() {
   delete detail::priv_havoqgt_env();
 }
 
+/// Threads per rank for ingest and graph construction:
+/// HAVOQGT_INGEST_THREADS, or the node's cores divided among its ranks.
+inline uint32_t ingest_thread_count() {
+  uint32_t threads = get_environment().ingest_threads();
+  if(threads == 0) {
+    threads = std::thread::hardware_concurrency()
+            / havoqgt_env()->node_local_comm().size();
+  }
+  return std::max(threads, uint32_t(1));
+}
+
 
 
 
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC. 
+ * Produced at the Lawrence Livermore National Laboratory. 
+ * Written by Roger Pearce <rpearce@llnl.gov>. 
+ * LLNL-CODE-644630. 
+ * All rights reserved.
+ * 
+ * This file is part of HavoqGT, Version 0.1. 
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ * 
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ * 
+ * Our Preamble Notice
+ * 
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ * 
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ * 
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ * 
+ */
+
+#ifndef HAVOQGT_MPI_IMPL_ATOMIC_VERTEX_DATA_HPP_
+#define HAVOQGT_MPI_IMPL_ATOMIC_VERTEX_DATA_HPP_
+
+#include <havoqgt/delegate_partitioned_graph.hpp>
+#include <type_traits>
+
+namespace havoqgt {
+namespace mpi {
+
+/**
+ * vertex_data whose elements, owned and delegate alike, can be updated
+ * concurrently by several threads of a rank.
+ *
+ * operator[] is still a plain reference and is only safe while no other
+ * thread updates the element, e.g., for reset() or after a traversal.
+ * All other accessors are atomic.  fetch_min and fetch_add return the value
+ * held before the update, like std::atomic::fetch_add.
+ */
+template <typename SegementManager>
+template <typename T, typename Allocator >
+class delegate_partitioned_graph<SegementManager>::atomic_vertex_data
+    : public delegate_partitioned_graph<SegementManager>::template vertex_data<T, Allocator> {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "atomic_vertex_data requires a trivially copyable type");
+  typedef typename delegate_partitioned_graph<SegementManager>::template
+      vertex_data<T, Allocator> base_type;
+ public:
+  atomic_vertex_data() {}
+
+  atomic_vertex_data(const delegate_partitioned_graph& dpg,
+                     Allocator allocate = Allocator())
+    : base_type(dpg, allocate) { }
+
+  T load(const vertex_locator& locator) const {
+    T to_return;
+    __atomic_load(&(*this)[locator], &to_return, __ATOMIC_ACQUIRE);
+    return to_return;
+  }
+
+  void store(const vertex_locator& locator, T val) {
+    __atomic_store(&(*this)[locator], &val, __ATOMIC_RELEASE);
+  }
+
+  /// On failure, expected is updated to the current value.
+  bool compare_exchange(const vertex_locator& locator, T& expected,
+                        T desired) {
+    return __atomic_compare_exchange(&(*this)[locator], &expected, &desired,
+                                     false, __ATOMIC_ACQ_REL,
+                                     __ATOMIC_ACQUIRE);
+  }
+
+  /// Stores min(current, val); the update happened iff the result > val.
+  T fetch_min(const vertex_locator& locator, T val) {
+    T* ptr = &(*this)[locator];
+    T expected;
+    __atomic_load(ptr, &expected, __ATOMIC_RELAXED);
+    while(val < expected &&
+          !__atomic_compare_exchange(ptr, &expected, &val, true,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) { }
+    return expected;
+  }
+
+  T fetch_add(const vertex_locator& locator, T val) {
+    T* ptr = &(*this)[locator];
+    T expected;
+    __atomic_load(ptr, &expected, __ATOMIC_RELAXED);
+    T desired = expected + val;
+    while(!__atomic_compare_exchange(ptr, &expected, &desired, true,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+      desired = expected + val;
+    }
+    return expected;
+  }
+};
+
+}  // mpi
+}  // namespace havoqgt
+#endif  // HAVOQGT_MPI_IMPL_ATOMIC_VERTEX_DATA_HPP_
@@ -57,6 +57,13 @@
 
 namespace havoqgt {
 namespace mpi {
+
+// Definitions for the odr-used constants, needed before C++17
+template <typename SegmentManager>
+constexpr uint64_t delegate_partitioned_graph<SegmentManager>::sparse_delegate_bit;
+template <typename SegmentManager>
+constexpr uint64_t delegate_partitioned_graph<SegmentManager>::sparse_empty_slot;
+
 /**
  * Builds a delegate_partitioned_graph with from and unsorted sequence of edges.
  *
@@ -77,6 +84,7 @@ delegate_partitioned_graph(const SegmentAllocator<void>& seg_allocator,
       m_global_edge_count(edges.size()),
       m_local_outgoing_count(seg_allocator),
       m_local_incoming_count(seg_allocator),
+      m_owner_bounds(seg_allocator),
       m_owned_info(seg_allocator),
       m_owned_info_tracker(seg_allocator),
       // m_owned_targets(seg_allocator),
@@ -87,8 +95,22 @@ delegate_partitioned_graph(const SegmentAllocator<void>& seg_allocator,
       // m_delegate_targets(seg_allocator),
       //m_map_delegate_locator(100, boost::hash<uint64_t>(),
       //    std::equal_to<uint64_t>(), seg_allocator),
+      m_owned_target_stream(seg_allocator),
+      m_owned_stream_offsets(seg_allocator),
+      m_delegate_target_stream(seg_allocator),
+      m_delegate_stream_offsets(seg_allocator),
+      m_owned_delta(seg_allocator),
+      m_delegate_delta(seg_allocator),
       m_map_delegate_locator(seg_allocator),
-      m_controller_locators(seg_allocator) {
+      m_controller_locators(seg_allocator),
+      m_checkpoint_delegate_info(seg_allocator),
+      m_checkpoint_transfer_info(seg_allocator),
+      m_relabel_offsets(seg_allocator),
+      m_relabel_forward(seg_allocator),
+      m_relabel_backward(seg_allocator),
+      m_sparse_labels(seg_allocator),
+      m_sparse_delegate_labels(seg_allocator),
+      m_sparse_label_index(seg_allocator) {
 
   CHK_MPI( MPI_Comm_size(m_mpi_comm, &m_mpi_size) );
   CHK_MPI( MPI_Comm_rank(m_mpi_comm, &m_mpi_rank) );
@@ -98,7 +120,17 @@ delegate_partitioned_graph(const SegmentAllocator<void>& seg_allocator,
   edge_chunk_size = 1024*8; ///< @todo marke env var
 
   m_global_max_vertex = max_vertex;
-  m_max_vertex = (std::ceil(double(max_vertex) / double(m_mpi_size)));
+  if (get_environment().range_partition()) {
+    LogStep logstep("compute_owner_bounds", m_mpi_comm, m_mpi_rank);
+    compute_owner_bounds(edges);
+    m_max_vertex = m_owner_bounds[m_mpi_rank + 1] - m_owner_bounds[m_mpi_rank];
+  } else {
+    m_max_vertex = (std::ceil(double(max_vertex) / double(m_mpi_size)));
+  }
+
+  // With the hub sketch, incoming degrees are never counted and outgoing
+  // degrees of low vertices are counted with the hub edges.
+  const bool hub_sketch = get_environment().hub_sketch();
 
   LogStep logstep_main("Delegate Partitioning", m_mpi_comm, m_mpi_rank);
 
@@ -112,7 +144,9 @@ delegate_partitioned_graph(const SegmentAllocator<void>& seg_allocator,
     m_owned_info.resize(m_max_vertex+2, vert_info(false, 0, 0));
     m_owned_info_tracker.resize(m_max_vertex+2, 0);
     m_local_outgoing_count.resize(m_max_vertex+1, 0);
-    m_local_incoming_count.resize(m_max_vertex+1, 0);
+    if (!hub_sketch) {
+      m_local_incoming_count.resize(m_max_vertex+1, 0);
+    }
     MPI_Barrier(m_mpi_comm);
 
   }
@@ -121,14 +155,21 @@ delegate_partitioned_graph(const SegmentAllocator<void>& seg_allocator,
 
   {
     LogStep logstep("count_edge_degree", m_mpi_comm, m_mpi_rank);
-    count_edge_degrees(edges.begin(), edges.end(), global_hubs,
-      delegate_degree_threshold);
+    if (hub_sketch) {
+      if (delegate_degree_threshold == 0) {
+        HAVOQGT_ERROR_MSG("An automatic delegate threshold needs exact degrees, not HAVOQGT_HUB_SKETCH.");
+      }
+      find_hubs_with_sketch(edges, global_hubs, delegate_degree_threshold);
+    } else {
+      count_edge_degrees(edges.begin(), edges.end(), global_hubs,
+        delegate_degree_threshold);
+    }
     if (m_mpi_rank == 0)
       std::cout << "\tNumber of Delegates: " << global_hubs.size() << std::endl;
     MPI_Barrier(m_mpi_comm);
   }
 
-  {
+  if (!hub_sketch) {
       LogStep logstep("initialize_low_meta_data", m_mpi_comm, m_mpi_rank);
       initialize_low_meta_data(global_hubs);
         MPI_Barrier(m_mpi_comm);
@@ -142,10 +183,18 @@ delegate_partitioned_graph(const SegmentAllocator<void>& seg_allocator,
 
   {
     LogStep logstep("count_high_degree_edges", m_mpi_comm, m_mpi_rank);
-    count_high_degree_edges(edges.begin(), edges.end(), global_hubs);
+    count_high_degree_edges(edges.begin(), edges.end(), global_hubs,
+      hub_sketch);
     MPI_Barrier(m_mpi_comm);
   }
 
+  if (hub_sketch) {
+      LogStep logstep("initialize_low_meta_data", m_mpi_comm, m_mpi_rank);
+      initialize_low_meta_data(global_hubs);
+        MPI_Barrier(m_mpi_comm);
+  }
+
+  flush_graph();
   m_graph_state = MetaDataGenerated;
   if (m_graph_state != stop_after) {
     complete_construction(seg_allocator, mpi_comm, edges);
@@ -168,21 +217,61 @@ complete_construction(const SegmentAllocator<void>& seg_allocator,
   assert(temp_mpi_rank == m_mpi_rank);
   assert(temp_mpi_size == temp_mpi_size);
 
+  // A crash can leave ranks one phase apart; all redo the earliest.
+  m_graph_state = ConstructionState(mpi_all_reduce(int(m_graph_state),
+      std::less<int>(), m_mpi_comm));
+  if (m_graph_state == New) {
+    HAVOQGT_ERROR_MSG("Graph meta data was not generated; nothing to resume.");
+  }
+
   std::map< uint64_t, std::deque<OverflowSendInfo> > transfer_info;
+  if (m_graph_state == EdgeStorageAllocated ||
+      m_graph_state == LowEdgesPartitioned) {
+    load_transfer_info(transfer_info);
+  }
+
   switch (m_graph_state) {
     case MetaDataGenerated:
+      // The next two steps overwrite the delegate edge counts, so a redo
+      // starts from the saved ones and frees the storage it allocated.
+      if (m_checkpoint_delegate_info.empty()) {
+        m_checkpoint_delegate_info.assign(m_delegate_info.begin(),
+                                          m_delegate_info.end());
+        m_checkpoint_edges_high_count = m_edges_high_count;
+      } else {
+        m_delegate_info.assign(m_checkpoint_delegate_info.begin(),
+                               m_checkpoint_delegate_info.end());
+        m_edges_high_count = m_checkpoint_edges_high_count;
+        SegmentManager *segment_manager = seg_allocator.get_segment_manager();
+        if (m_owned_targets) {
+          segment_manager->deallocate(m_owned_targets.get());
+          m_owned_targets = nullptr;
+        }
+        if (m_delegate_targets) {
+          segment_manager->deallocate(m_delegate_targets.get());
+          m_delegate_targets = nullptr;
+        }
+        if (m_edge_weights) {
+          segment_manager->destroy_ptr(m_edge_weights.get());
+          m_edge_weights = nullptr;
+        }
+      }
+
       {
         LogStep logstep("calculate_overflow", m_mpi_comm, m_mpi_rank);
         calculate_overflow(transfer_info);
+        store_transfer_info(transfer_info);
             MPI_Barrier(m_mpi_comm);
       }
 
       {
         LogStep logstep("initialize_edge_storage", m_mpi_comm, m_mpi_rank);
-        initialize_edge_storage(seg_allocator);
+        initialize_edge_storage(seg_allocator,
+                                detail::container_weighted(edges));
             MPI_Barrier(m_mpi_comm);
       }
 
+      flush_graph();
       m_graph_state = EdgeStorageAllocated;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -191,16 +280,28 @@ complete_construction(const SegmentAllocator<void>& seg_allocator,
   case EdgeStorageAllocated:
     {
       LogStep logstep("partition_low_degree", m_mpi_comm, m_mpi_rank);
-      partition_low_degree(edges);
+      if (has_edge_weights()) {
+        partition_low_degree<weighted_edge>(edges);
+      } else {
+        partition_low_degree<std::pair<uint64_t, uint64_t> >(edges);
+      }
         MPI_Barrier(m_mpi_comm);
     }
+    flush_graph();
     m_graph_state = LowEdgesPartitioned;
 
+  case LowEdgesPartitioned:
     {
       LogStep logstep("partition_high_degree", m_mpi_comm, m_mpi_rank);
-      partition_high_degree(edges, transfer_info);
+      if (has_edge_weights()) {
+        partition_high_degree<weighted_edge>(edges, transfer_info);
+      } else {
+        partition_high_degree<std::pair<uint64_t, uint64_t> >(edges,
+                                                               transfer_info);
+      }
         MPI_Barrier(m_mpi_comm);
     }
+    flush_graph();
     m_graph_state = HighEdgesPartitioned;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -210,6 +311,10 @@ complete_construction(const SegmentAllocator<void>& seg_allocator,
   case HighEdgesPartitioned:
     {
       LogStep logstep("all-reduce hub degree", m_mpi_comm, m_mpi_rank);
+      // Start from the local slice sizes, so a redo reduces them again.
+      for (size_t i = 0; i < m_delegate_degree.size(); ++i) {
+        m_delegate_degree[i] = m_delegate_info[i+1] - m_delegate_info[i];
+      }
       if(m_delegate_degree.size() > 0) {
         mpi_all_reduce_inplace(m_delegate_degree, std::plus<uint64_t>(), m_mpi_comm);
       }
@@ -217,11 +322,18 @@ complete_construction(const SegmentAllocator<void>& seg_allocator,
     }
     assert(m_delegate_degree.size() == m_delegate_label.size());
 
+    {
+      LogStep logstep("sort_adjacency", m_mpi_comm, m_mpi_rank);
+      sort_adjacency();
+        MPI_Barrier(m_mpi_comm);
+    }
+
     //
     // Build controller lists
     {
       LogStep logstep("Build controller lists", m_mpi_comm, m_mpi_rank);
       const int controllers = (m_delegate_degree.size() / m_mpi_size) + 1;
+      m_controller_locators.clear();
       m_controller_locators.reserve(controllers);
       for (size_t i=0; i < m_delegate_degree.size(); ++i) {
         if (int(i % m_mpi_size) == m_mpi_rank) {
@@ -240,22 +352,780 @@ complete_construction(const SegmentAllocator<void>& seg_allocator,
         uint64_t label = itr->first;
         vertex_locator locator = itr->second;
 
-        uint64_t local_id = label / uint64_t(m_mpi_size);
-        if (label % uint64_t(m_mpi_size) == uint64_t(m_mpi_rank)) {
+        uint64_t local_id = ownership().local_id(label);
+        if (ownership().owner(label) == m_mpi_rank) {
           assert(m_owned_info[local_id].is_delegate == 1);
           assert(m_owned_info[local_id].delegate_id == locator.local_id());
         }
       }
         MPI_Barrier(m_mpi_comm);
     }
+    m_checkpoint_delegate_info.clear();
+    m_checkpoint_delegate_info.shrink_to_fit();
+    m_checkpoint_transfer_info.clear();
+    m_checkpoint_transfer_info.shrink_to_fit();
+    {
+      const uint64_t local_edges = m_owned_targets_size +
+                                   m_delegate_targets_size;
+      const uint64_t max_edges = mpi_all_reduce(local_edges,
+          std::greater<uint64_t>(), m_mpi_comm);
+      const uint64_t sum_edges = mpi_all_reduce(local_edges,
+          std::plus<uint64_t>(), m_mpi_comm);
+      if (m_mpi_rank == 0) {
+        std::cout << "\tEdges per rank: max " << max_edges << ", mean "
+                  << sum_edges / m_mpi_size << ", imbalance "
+                  << double(max_edges) * m_mpi_size / std::max(sum_edges,
+                         uint64_t(1))
+                  << (ownership().is_range() ? " (label ranges)" : "")
+                  << std::endl;
+      }
+    }
     m_graph_state = GraphReady;
+    flush_graph();
 
+  case GraphReady:
+    break;
+
+  case New:
+    assert(false);
+    break;
   }  // switch
 ////////////////////////////////////////////////////////////////////////////////
 /// End of graph construction
 ////////////////////////////////////////////////////////////////////////////////
 };
 
+template <typename SegmentManager>
+void
+delegate_partitioned_graph<SegmentManager>::
+store_transfer_info(
+    const std::map< uint64_t, std::deque<OverflowSendInfo> >& transfer_info) {
+  m_checkpoint_transfer_info.clear();
+  for (auto itr = transfer_info.begin(); itr != transfer_info.end(); ++itr) {
+    for (size_t j = 0; j < itr->second.size(); ++j) {
+      m_checkpoint_transfer_info.push_back(itr->first);
+      m_checkpoint_transfer_info.push_back(itr->second[j].to_send_id);
+      m_checkpoint_transfer_info.push_back(itr->second[j].to_send_count);
+    }
+  }
+}
+
+template <typename SegmentManager>
+void
+delegate_partitioned_graph<SegmentManager>::
+load_transfer_info(
+    std::map< uint64_t, std::deque<OverflowSendInfo> >& transfer_info) const {
+  transfer_info.clear();
+  for (size_t i = 0; i + 2 < m_checkpoint_transfer_info.size(); i += 3) {
+    transfer_info[m_checkpoint_transfer_info[i]].push_back(OverflowSendInfo(
+        m_checkpoint_transfer_info[i+1], m_checkpoint_transfer_info[i+2]));
+  }
+}
+
+/**
+ * Writes the graph's dirty pages back to its file.  The segment manager is
+ * at the start of the mapping, so this syncs the whole segment.  Segments
+ * that are not file mappings are left alone.
+ */
+template <typename SegmentManager>
+void
+delegate_partitioned_graph<SegmentManager>::
+flush_graph() {
+  SegmentManager *segment_manager =
+      m_owned_info.get_allocator().get_segment_manager();
+  const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(segment_manager);
+  const uintptr_t aligned = begin & ~(page_size - 1);
+  msync(reinterpret_cast<void*>(aligned),
+        begin - aligned + segment_manager->get_size(), MS_SYNC);
+}
+
+template <typename SegmentManager>
+void
+delegate_partitioned_graph<SegmentManager>::
+store_edge_weight(const weighted_edge& record, bool delegate,
+                  uint64_t position) {
+  if (delegate) {
+    m_edge_weights->delegate_begin()[position] = record.weight;
+  } else {
+    m_edge_weights->owned_begin()[position] = record.weight;
+  }
+}
+
+/**
+ * Sorts the targets of every owned vertex, and of every delegate's local
+ * slice, by vertex_locator so algorithms can intersect adjacency lists.
+ * Edge weights move with their targets.
+ */
+template <typename SegmentManager>
+void
+delegate_partitioned_graph<SegmentManager>::
+sort_adjacency() {
+  if (!m_edge_weights) {
+    for (size_t i = 0; i + 1 < m_owned_info.size(); ++i) {
+      std::sort(m_owned_targets.get() + m_owned_info[i].low_csr_idx,
+                m_owned_targets.get() + m_owned_info[i+1].low_csr_idx);
+    }
+    for (size_t i = 0; i + 1 < m_delegate_info.size(); ++i) {
+      std::sort(m_delegate_targets.get() + m_delegate_info[i],
+                m_delegate_targets.get() + m_delegate_info[i+1]);
+    }
+    return;
+  }
+
+  std::vector< std::pair<vertex_locator, uint64_t> > row;
+  auto sort_row = [&row](vertex_locator* targets,
+                         typename edge_weight_data::iterator weights,
+                         uint64_t begin, uint64_t end) {
+    row.clear();
+    for (uint64_t j = begin; j < end; ++j) {
+      row.push_back(std::make_pair(targets[j], weights[j]));
+    }
+    std::sort(row.begin(), row.end());
+    for (uint64_t j = begin; j < end; ++j) {
+      targets[j] = row[j - begin].first;
+      weights[j] = row[j - begin].second;
+    }
+  };
+  for (size_t i = 0; i + 1 < m_owned_info.size(); ++i) {
+    sort_row(m_owned_targets.get(), m_edge_weights->owned_begin(),
+             m_owned_info[i].low_csr_idx, m_owned_info[i+1].low_csr_idx);
+  }
+  for (size_t i = 0; i + 1 < m_delegate_info.size(); ++i) {
+    sort_row(m_delegate_targets.get(), m_edge_weights->delegate_begin(),
+             m_delegate_info[i], m_delegate_info[i+1]);
+  }
+}  // sort_adjacency
+
+/**
+ * Encodes the sorted targets of every owned vertex and delegate slice as the
+ * sort_key() of the first target followed by the gaps to the next ones, each
+ * a varint, and frees the uncompressed arrays.  Edge offsets, and with them
+ * edge_data, are unchanged; edge_iterator decodes the targets as it goes.
+ *
+ * The streams are built in memory and copied into the segment after the
+ * arrays are freed, so they reuse that space instead of growing the file.
+ */
+template <typename SegmentManager>
+void
+delegate_partitioned_graph<SegmentManager>::
+compress_targets(const SegmentAllocator<void>& seg_allocator) {
+  assert(m_graph_state == GraphReady);
+  if (m_targets_compressed) {
+    return;
+  }
+
+  std::vector<uint8_t> owned_stream, delegate_stream;
+  std::vector<uint64_t> owned_offsets, delegate_offsets;
+  encode_targets(m_owned_targets.get(), m_owned_info.size(),
+    [this](size_t i) { return m_owned_info[i].low_csr_idx; },
+    owned_stream, owned_offsets);
+  encode_targets(m_delegate_targets.get(), m_delegate_info.size(),
+    [this](size_t i) { return m_delegate_info[i]; },
+    delegate_stream, delegate_offsets);
+
+  SegmentManager *segment_manager = seg_allocator.get_segment_manager();
+  segment_manager->deallocate(m_owned_targets.get());
+  segment_manager->deallocate(m_delegate_targets.get());
+  m_owned_targets = nullptr;
+  m_delegate_targets = nullptr;
+
+  m_owned_target_stream.assign(owned_stream.begin(), owned_stream.end());
+  m_owned_stream_offsets.assign(owned_offsets.begin(), owned_offsets.end());
+  m_delegate_target_stream.assign(delegate_stream.begin(),
+                                  delegate_stream.end());
+  m_delegate_stream_offsets.assign(delegate_offsets.begin(),
+                                   delegate_offsets.end());
+  m_targets_compressed = true;
+}  // compress_targets
+
+template <typename SegmentManager>
+template <typename CsrIndex>
+void
+delegate_partitioned_graph<SegmentManager>::
+encode_targets(const vertex_locator* targets, size_t num_index,
+    CsrIndex csr_index, std::vector<uint8_t>& stream,
+    std::vector<uint64_t>& offsets) {
+  uint8_t buf[havoqgt::detail::varint_max_bytes];
+  offsets.assign(num_index, 0);
+  for (size_t i = 0; i + 1 < num_index; ++i) {
+    offsets[i] = stream.size();
+    uint64_t prev_key = 0;
+    for (uint64_t j = csr_index(i); j < csr_index(i+1); ++j) {
+      const uint64_t key = targets[j].sort_key();
+      assert(key >= prev_key);
+      uint8_t* end = havoqgt::detail::varint_encode(key - prev_key, buf);
+      stream.insert(stream.end(), buf, end);
+      prev_key = key;
+    }
+  }
+  if (num_index > 0) {
+    offsets[num_index - 1] = stream.size();
+  }
+}  // encode_targets
+
+/**
+ * Adds edges to a finished graph without rebuilding it.  Edges are routed
+ * to the owner of their source, as in partition_low_degree; a delegate
+ * source's edges go to its master, and the delegate's global degree is
+ * all-reduced.  Each rank keeps its edges in m_owned_delta and
+ * m_delegate_delta, which edge_iterator visits after the CSR edges.
+ *
+ * Once the global delta exceeds HAVOQGT_DELTA_COMPACT_PERCENT of the edges,
+ * every rank runs compact().
+ *
+ * @param seg_allocator allocator of the graph's segment
+ * @param mpi_comm      MPI communicator
+ * @param edges         label pairs, each label <= max_global_vertex_id()
+ */
+template <typename SegmentManager>
+template <typename Container>
+void
+delegate_partitioned_graph<SegmentManager>::
+add_edges(const SegmentAllocator<void>& seg_allocator, MPI_Comm mpi_comm,
+          Container& edges) {
+  assert(m_graph_state == GraphReady);
+  if (has_edge_weights()) {
+    HAVOQGT_ERROR_MSG("add_edges cannot extend the edge weights of a weighted graph.");
+  }
+  m_mpi_comm = mpi_comm;
+
+  const size_t owned_old = m_owned_delta.size();
+  const size_t delegate_old = m_delegate_delta.size();
+  std::vector<uint64_t> delegate_added(m_delegate_degree.size(), 0);
+
+  {
+    LogStep logstep("add_edges", m_mpi_comm, m_mpi_rank);
+    edge_source_partitioner paritioner(ownership());
+    auto itr = edges.begin();
+    auto itr_end = edges.end();
+    while (!detail::global_iterator_range_empty(itr, itr_end, m_mpi_comm)) {
+      std::vector<std::pair<uint64_t, uint64_t> > to_recv_edges;
+      {
+        std::vector<std::pair<uint64_t, uint64_t> > to_send_edges;
+        to_send_edges.reserve(edge_chunk_size);
+        for (size_t i = 0; itr != itr_end && i < edge_chunk_size; ++itr, ++i) {
+          if (itr->first > m_global_max_vertex ||
+              itr->second > m_global_max_vertex) {
+            std::stringstream error;
+            error << "add_edges: edge (" << itr->first << "," << itr->second
+                  << ") is beyond max vertex " << m_global_max_vertex;
+            throw std::runtime_error(error.str());
+          }
+          to_send_edges.push_back(*itr);
+        }
+        mpi_all_to_all_better(to_send_edges, to_recv_edges, paritioner,
+            m_mpi_comm);
+      }
+
+      for (size_t i = 0; i < to_recv_edges.size(); ++i) {
+        vertex_locator source = label_to_locator(to_recv_edges[i].first);
+        vertex_locator target = label_to_locator(to_recv_edges[i].second);
+        if (source.is_delegate()) {
+          m_delegate_delta.push_back(delta_edge(source.local_id(), target));
+          ++delegate_added[source.local_id()];
+        } else {
+          m_owned_delta.push_back(delta_edge(source.local_id(), target));
+        }
+      }
+    }
+
+    // Keep the deltas sorted by source, then target, so each vertex's
+    // added targets are sorted like its CSR targets.
+    std::sort(m_owned_delta.begin() + owned_old, m_owned_delta.end());
+    std::inplace_merge(m_owned_delta.begin(),
+        m_owned_delta.begin() + owned_old, m_owned_delta.end());
+    std::sort(m_delegate_delta.begin() + delegate_old, m_delegate_delta.end());
+    std::inplace_merge(m_delegate_delta.begin(),
+        m_delegate_delta.begin() + delegate_old, m_delegate_delta.end());
+
+    if (delegate_added.size() > 0) {
+      mpi_all_reduce_inplace(delegate_added, std::plus<uint64_t>(), m_mpi_comm);
+      for (size_t i = 0; i < delegate_added.size(); ++i) {
+        m_delegate_degree[i] += delegate_added[i];
+      }
+    }
+  }
+
+  const uint64_t compact_percent = get_environment().delta_compact_percent();
+  const uint64_t global_delta = mpi_all_reduce(uint64_t(delta_size()),
+      std::plus<uint64_t>(), m_mpi_comm);
+  const uint64_t global_csr = mpi_all_reduce(
+      uint64_t(m_owned_targets_size + m_delegate_targets_size),
+      std::plus<uint64_t>(), m_mpi_comm);
+  if (m_mpi_rank == 0) {
+    std::cout << "\tDelta edges: " << global_delta << ", CSR edges: "
+              << global_csr << "." << std::endl;
+  }
+  if (compact_percent > 0 &&
+      global_delta * 100 > global_csr * compact_percent) {
+    LogStep logstep("compact", m_mpi_comm, m_mpi_rank);
+    compact(seg_allocator);
+  }
+}  // add_edges
+
+/**
+ * Rebuilds this rank's CSR with the edges added by add_edges(): every
+ * vertex's merged targets are collected through edge_iterator and sorted,
+ * then replace the target arrays, or are re-encoded if the targets are
+ * compressed.  Purely local; delegate degrees were updated by add_edges().
+ */
+template <typename SegmentManager>
+void
+delegate_partitioned_graph<SegmentManager>::
+compact(const SegmentAllocator<void>& seg_allocator) {
+  assert(m_graph_state == GraphReady);
+  if (m_owned_delta.empty() && m_delegate_delta.empty()) {
+    return;
+  }
+
+  auto collect = [this](size_t num_index, bool delegates,
+                        std::vector<vertex_locator>& targets,
+                        std::vector<uint64_t>& csr_index) {
+    csr_index.assign(num_index, 0);
+    for (size_t i = 0; i + 1 < num_index; ++i) {
+      csr_index[i] = targets.size();
+      vertex_locator v = delegates ? delegate_locator(i)
+                                   : vertex_locator(false, i, m_mpi_rank);
+      for (edge_iterator eitr = edges_begin(v); eitr != edges_end(v); ++eitr) {
+        targets.push_back(eitr.target());
+      }
+      std::sort(targets.begin() + csr_index[i], targets.end());
+    }
+    if (num_index > 0) {
+      csr_index[num_index - 1] = targets.size();
+    }
+  };
+
+  std::vector<vertex_locator> owned_targets, delegate_targets;
+  std::vector<uint64_t> owned_index, delegate_index;
+  collect(m_owned_info.size(), false, owned_targets, owned_index);
+  collect(m_delegate_info.size(), true, delegate_targets, delegate_index);
+
+  m_owned_delta.clear();
+  m_owned_delta.shrink_to_fit();
+  m_delegate_delta.clear();
+  m_delegate_delta.shrink_to_fit();
+  for (size_t i = 0; i < m_owned_info.size(); ++i) {
+    m_owned_info[i].low_csr_idx = owned_index[i];
+  }
+  for (size_t i = 0; i < m_delegate_info.size(); ++i) {
+    m_delegate_info[i] = delegate_index[i];
+  }
+  m_owned_targets_size = owned_targets.size();
+  m_delegate_targets_size = delegate_targets.size();
+
+  if (m_targets_compressed) {
+    std::vector<uint8_t> owned_stream, delegate_stream;
+    std::vector<uint64_t> owned_offsets, delegate_offsets;
+    encode_targets(owned_targets.data(), owned_index.size(),
+      [&owned_index](size_t i) { return owned_index[i]; },
+      owned_stream, owned_offsets);
+    encode_targets(delegate_targets.data(), delegate_index.size(),
+      [&delegate_index](size_t i) { return delegate_index[i]; },
+      delegate_stream, delegate_offsets);
+    m_owned_target_stream.assign(owned_stream.begin(), owned_stream.end());
+    m_owned_stream_offsets.assign(owned_offsets.begin(), owned_offsets.end());
+    m_delegate_target_stream.assign(delegate_stream.begin(),
+                                    delegate_stream.end());
+    m_delegate_stream_offsets.assign(delegate_offsets.begin(),
+                                     delegate_offsets.end());
+    return;
+  }
+
+  SegmentManager *segment_manager = seg_allocator.get_segment_manager();
+  segment_manager->deallocate(m_owned_targets.get());
+  segment_manager->deallocate(m_delegate_targets.get());
+  m_owned_targets = (vertex_locator*) segment_manager->allocate(
+      m_owned_targets_size * sizeof(vertex_locator));
+  m_delegate_targets = (vertex_locator*) segment_manager->allocate(
+      m_delegate_targets_size * sizeof(vertex_locator));
+  std::copy(owned_targets.begin(), owned_targets.end(), m_owned_targets.get());
+  std::copy(delegate_targets.begin(), delegate_targets.end(),
+            m_delegate_targets.get());
+}  // compact
+
+/**
+ * Renumbers the max_vertices highest degree owned vertices of every rank to
+ * local ids 0, 1, ... in decreasing degree order.  The vertices they
+ * displace take over the freed ids and all others keep theirs, so only the
+ * moved ids are recorded.  The owned CSR rows are permuted, every target is
+ * rewritten with its new id, and the moves of all ranks are gathered so
+ * label_to_locator() and locator_to_label() still translate every label.
+ *
+ * Vertex and edge data created before relabeling index the old ids.
+ */
+template <typename SegmentManager>
+void
+delegate_partitioned_graph<SegmentManager>::
+relabel_vertices(MPI_Comm mpi_comm, uint64_t max_vertices) {
+  assert(m_graph_state == GraphReady);
+  m_mpi_comm = mpi_comm;
+  if (m_targets_compressed || !m_owned_delta.empty() ||
+      !m_delegate_delta.empty()) {
+    HAVOQGT_ERROR_MSG("relabel_vertices before compress_targets and add_edges");
+  }
+  if (!m_relabel_offsets.empty()) {
+    return;
+  }
+  LogStep logstep("relabel_vertices", m_mpi_comm, m_mpi_rank);
+
+  const uint64_t num_rows = m_owned_info.size() - 1;
+  auto row_degree = [this](uint64_t i) {
+    return m_owned_info[i+1].low_csr_idx - m_owned_info[i].low_csr_idx;
+  };
+
+  std::vector<uint64_t> hot;
+  for (uint64_t i = 0; i < num_rows; ++i) {
+    if (!m_owned_info[i].is_delegate && row_degree(i) > 0) {
+      hot.push_back(i);
+    }
+  }
+  const uint64_t num_hot = std::min(max_vertices, uint64_t(hot.size()));
+  std::partial_sort(hot.begin(), hot.begin() + num_hot, hot.end(),
+      [&row_degree](uint64_t a, uint64_t b) {
+        const uint64_t da = row_degree(a), db = row_degree(b);
+        return da != db ? da > db : a < b;
+      });
+  hot.resize(num_hot);
+
+  // Hot vertex i moves to id i; ids below num_hot that are not hot move, in
+  // order, to the ids the hot vertices left.
+  std::vector<relabel_entry> moves;
+  std::vector<bool> is_hot(num_rows, false);
+  std::vector<uint64_t> freed;
+  for (uint64_t i = 0; i < num_hot; ++i) {
+    is_hot[hot[i]] = true;
+    if (hot[i] != i) {
+      moves.push_back(relabel_entry(hot[i], i));
+    }
+    if (hot[i] >= num_hot) {
+      freed.push_back(hot[i]);
+    }
+  }
+  std::sort(freed.begin(), freed.end());
+  for (uint64_t i = 0, next = 0; i < num_hot; ++i) {
+    if (!is_hot[i]) {
+      moves.push_back(relabel_entry(i, freed[next++]));
+    }
+  }
+
+  {
+    // The pairs are gathered flattened, as first, second, first, ...
+    std::vector<relabel_entry> forward(moves), backward;
+    std::sort(forward.begin(), forward.end());
+    for (size_t i = 0; i < moves.size(); ++i) {
+      backward.push_back(relabel_entry(moves[i].second, moves[i].first));
+    }
+    std::sort(backward.begin(), backward.end());
+    std::vector<uint64_t> send, all_forward, all_backward;
+    for (size_t i = 0; i < forward.size(); ++i) {
+      send.push_back(forward[i].first);
+      send.push_back(forward[i].second);
+    }
+    mpi_all_gather(send, all_forward, m_mpi_comm);
+    send.clear();
+    for (size_t i = 0; i < backward.size(); ++i) {
+      send.push_back(backward[i].first);
+      send.push_back(backward[i].second);
+    }
+    mpi_all_gather(send, all_backward, m_mpi_comm);
+    std::vector<uint64_t> counts;
+    mpi_all_gather(uint64_t(moves.size()), counts, m_mpi_comm);
+
+    m_relabel_offsets.assign(m_mpi_size + 1, 0);
+    for (uint32_t i = 0; i < m_mpi_size; ++i) {
+      m_relabel_offsets[i+1] = m_relabel_offsets[i] + counts[i];
+    }
+    m_relabel_forward.clear();
+    m_relabel_backward.clear();
+    for (size_t i = 0; i + 1 < all_forward.size(); i += 2) {
+      m_relabel_forward.push_back(
+          relabel_entry(all_forward[i], all_forward[i+1]));
+      m_relabel_backward.push_back(
+          relabel_entry(all_backward[i], all_backward[i+1]));
+    }
+  }
+
+  // Permute the owned rows.
+  std::vector<uint64_t> old_of(num_rows);
+  for (uint64_t i = 0; i < num_rows; ++i) {
+    old_of[i] = i;
+  }
+  for (size_t i = 0; i < moves.size(); ++i) {
+    old_of[moves[i].second] = moves[i].first;
+  }
+  std::vector<vertex_locator> owned_targets;
+  owned_targets.reserve(m_owned_targets_size);
+  std::vector<uint64_t> owned_weights;
+  std::vector<vert_info> owned_info;
+  owned_info.reserve(m_owned_info.size());
+  for (uint64_t i = 0; i < num_rows; ++i) {
+    const vert_info& row = m_owned_info[old_of[i]];
+    const uint64_t row_end = m_owned_info[old_of[i] + 1].low_csr_idx;
+    owned_info.push_back(vert_info(row.is_delegate, row.delegate_id,
+                                   owned_targets.size()));
+    owned_targets.insert(owned_targets.end(),
+        m_owned_targets.get() + row.low_csr_idx,
+        m_owned_targets.get() + row_end);
+    if (m_edge_weights) {
+      owned_weights.insert(owned_weights.end(),
+          m_edge_weights->owned_begin() + row.low_csr_idx,
+          m_edge_weights->owned_begin() + row_end);
+    }
+  }
+  std::copy(owned_info.begin(), owned_info.end(), m_owned_info.begin());
+  std::copy(owned_targets.begin(), owned_targets.end(), m_owned_targets.get());
+  if (m_edge_weights) {
+    std::copy(owned_weights.begin(), owned_weights.end(),
+              m_edge_weights->owned_begin());
+  }
+
+  auto permute_counts = [&old_of, num_rows](
+      bip::vector<uint32_t, SegmentAllocator<uint32_t> >& counts) {
+    if (counts.size() != num_rows) {
+      return;
+    }
+    std::vector<uint32_t> old_counts(counts.begin(), counts.end());
+    for (uint64_t i = 0; i < num_rows; ++i) {
+      counts[i] = old_counts[old_of[i]];
+    }
+  };
+  permute_counts(m_local_outgoing_count);
+  permute_counts(m_local_incoming_count);
+
+  auto relabel_targets = [this](vertex_locator* begin, vertex_locator* end) {
+    for (vertex_locator* t = begin; t != end; ++t) {
+      if (!t->is_delegate()) {
+        t->m_local_id = relabel_lookup(m_relabel_forward, t->owner(),
+                                       t->local_id());
+      }
+    }
+  };
+  relabel_targets(m_owned_targets.get(),
+                  m_owned_targets.get() + m_owned_targets_size);
+  relabel_targets(m_delegate_targets.get(),
+                  m_delegate_targets.get() + m_delegate_targets_size);
+  sort_adjacency();
+
+  if (!m_sparse_labels.empty()) {
+    std::vector<uint64_t> sparse_labels(m_sparse_labels.begin(),
+                                        m_sparse_labels.end());
+    for (size_t i = 0; i < moves.size(); ++i) {
+      m_sparse_labels[moves[i].second] = sparse_labels[moves[i].first];
+    }
+    build_sparse_label_index();
+  }
+
+  const uint64_t global_moved = m_relabel_offsets[m_mpi_size];
+  if (m_mpi_rank == 0) {
+    std::cout << "\tRelabeled vertices: " << global_moved << "." << std::endl;
+  }
+}  // relabel_vertices
+
+/**
+ * Takes the sparse labels of this rank's vertices, in the dense numbering
+ * sparse_label_edge_list produced, and moves them to the relabeled local ids
+ * if relabel_vertices() ran.  Each delegate's sparse label comes from the
+ * rank owning its dense label.
+ */
+template <typename SegmentManager>
+void
+delegate_partitioned_graph<SegmentManager>::
+set_sparse_labels(MPI_Comm mpi_comm,
+                  const std::vector<uint64_t>& owned_labels) {
+  assert(m_graph_state == GraphReady);
+  m_mpi_comm = mpi_comm;
+  if (ownership().is_range()) {
+    HAVOQGT_ERROR_MSG("Sparse labels need label % mpi_size ownership.");
+  }
+
+  m_sparse_labels.assign(owned_labels.size(), 0);
+  for (uint64_t i = 0; i < owned_labels.size(); ++i) {
+    const uint64_t local_id = m_relabel_forward.empty() ? i
+        : relabel_lookup(m_relabel_forward, m_mpi_rank, i);
+    m_sparse_labels[local_id] = owned_labels[i];
+  }
+
+  std::vector<uint64_t> delegate_labels(m_delegate_label.size(), 0);
+  for (size_t i = 0; i < m_delegate_label.size(); ++i) {
+    if (m_delegate_label[i] % m_mpi_size == m_mpi_rank) {
+      delegate_labels[i] = owned_labels[m_delegate_label[i] / m_mpi_size];
+    }
+  }
+  if (delegate_labels.size() > 0) {
+    mpi_all_reduce_inplace(delegate_labels, std::plus<uint64_t>(), m_mpi_comm);
+  }
+  m_sparse_delegate_labels.assign(delegate_labels.begin(),
+                                  delegate_labels.end());
+  build_sparse_label_index();
+}  // set_sparse_labels
+
+template <typename SegmentManager>
+void
+delegate_partitioned_graph<SegmentManager>::
+build_sparse_label_index() {
+  const uint64_t entries = m_sparse_labels.size() +
+                           m_sparse_delegate_labels.size();
+  uint64_t capacity = 16;
+  while (capacity < 2 * entries) {
+    capacity *= 2;
+  }
+  const uint64_t mask = capacity - 1;
+  m_sparse_label_index.assign(capacity, relabel_entry(0, sparse_empty_slot));
+
+  auto insert = [this, mask](uint64_t label, uint64_t value) {
+    uint64_t slot = havoqgt::detail::mix64(label) & mask;
+    while (m_sparse_label_index[slot].second != sparse_empty_slot &&
+           m_sparse_label_index[slot].first != label) {
+      slot = (slot + 1) & mask;
+    }
+    m_sparse_label_index[slot] = relabel_entry(label, value);
+  };
+  for (uint64_t i = 0; i < m_sparse_labels.size(); ++i) {
+    if (!m_owned_info[i].is_delegate) {
+      insert(m_sparse_labels[i], i);
+    }
+  }
+  for (uint64_t i = 0; i < m_sparse_delegate_labels.size(); ++i) {
+    insert(m_sparse_delegate_labels[i], i | sparse_delegate_bit);
+  }
+}  // build_sparse_label_index
+
+/**
+ * @param  label sparse label to convert
+ * @return locator of the owned vertex or delegate with that label, or an
+ *         invalid locator
+ */
+template <typename SegmentManager>
+inline
+typename delegate_partitioned_graph<SegmentManager>::vertex_locator
+delegate_partitioned_graph<SegmentManager>::
+sparse_label_to_locator(uint64_t label) const {
+  assert(has_sparse_labels());
+  const uint64_t mask = m_sparse_label_index.size() - 1;
+  uint64_t slot = havoqgt::detail::mix64(label) & mask;
+  while (m_sparse_label_index[slot].second != sparse_empty_slot) {
+    if (m_sparse_label_index[slot].first == label) {
+      const uint64_t value = m_sparse_label_index[slot].second;
+      if (value & sparse_delegate_bit) {
+        return delegate_locator(value & ~sparse_delegate_bit);
+      }
+      return vertex_locator(false, value, m_mpi_rank);
+    }
+    slot = (slot + 1) & mask;
+  }
+  return vertex_locator();
+}
+
+/**
+ * The owner of the label finds it locally and the others learn its locator
+ * from a min all-reduce of vertex_locator::sort_key().
+ *
+ * @param  label    sparse label to convert
+ * @param  mpi_comm MPI communicator
+ * @return locator for the label, or an invalid locator if it is not in the
+ *         graph
+ */
+template <typename SegmentManager>
+typename delegate_partitioned_graph<SegmentManager>::vertex_locator
+delegate_partitioned_graph<SegmentManager>::
+sparse_label_to_locator(uint64_t label, MPI_Comm mpi_comm) const {
+  vertex_locator locator = sparse_label_to_locator(label);
+  if (locator.is_delegate()) {
+    return locator;
+  }
+  // Below the sign bit, as some MPI_MIN reductions of unsigned types
+  // compare signed
+  const uint64_t not_found = uint64_t(std::numeric_limits<int64_t>::max());
+  const uint64_t key = mpi_all_reduce(
+      locator.is_valid() ? locator.sort_key() : not_found,
+      std::less<uint64_t>(), mpi_comm);
+  if (key == not_found) {
+    return vertex_locator();
+  }
+  return vertex_locator::from_sort_key(key);
+}
+
+/**
+ * @param  locator owned vertex or delegate
+ * @return its sparse label
+ */
+template <typename SegmentManager>
+inline
+uint64_t
+delegate_partitioned_graph<SegmentManager>::
+locator_to_sparse_label(vertex_locator locator) const {
+  if (locator.is_delegate()) {
+    return m_sparse_delegate_labels[locator.local_id()];
+  }
+  assert(locator.owner() == m_mpi_rank);
+  return m_sparse_labels[locator.local_id()];
+}
+
+/**
+ * @param  map      m_relabel_forward or m_relabel_backward
+ * @param  owner    rank owning the vertex
+ * @param  local_id vertex id to translate
+ * @return the id local_id maps to, or local_id if it did not move
+ */
+template <typename SegmentManager>
+inline
+uint64_t
+delegate_partitioned_graph<SegmentManager>::
+relabel_lookup(const relabel_map& map, uint32_t owner,
+               uint64_t local_id) const {
+  auto begin = map.begin() + m_relabel_offsets[owner];
+  auto end = map.begin() + m_relabel_offsets[owner + 1];
+  auto itr = std::lower_bound(begin, end, local_id,
+      [](const relabel_entry& e, uint64_t id) { return e.first < id; });
+  if (itr != end && itr->first == local_id) {
+    return itr->second;
+  }
+  return local_id;
+}  // relabel_lookup
+
+/**
+ * Chooses contiguous label ranges, one per rank, that hold about equal
+ * numbers of edges by source.  Sources are counted into label buckets, the
+ * counts are summed across ranks, and rank r starts after the bucket where
+ * the running total reaches r/mpi_size of all edges.  At least 1024
+ * buckets per rank keep the ranges within about 1/1024 of the mean, unless
+ * a single bucket is heavier.
+ *
+ * @param edges: input edges
+ */
+template <typename SegmentManager>
+template <typename Container>
+void
+delegate_partitioned_graph<SegmentManager>::
+compute_owner_bounds(Container& edges) {
+  const uint64_t num_labels = m_global_max_vertex + 1;
+  const uint64_t num_buckets = std::min(num_labels,
+                                        uint64_t(m_mpi_size) * 1024);
+  const uint64_t bucket_width = (num_labels + num_buckets - 1) / num_buckets;
+
+  std::vector<uint64_t> histogram(num_buckets, 0);
+  for (auto itr = edges.begin(); itr != edges.end(); ++itr) {
+    ++histogram[(*itr).first / bucket_width];
+  }
+  mpi_all_reduce_inplace(histogram, std::plus<uint64_t>(), m_mpi_comm);
+  const uint64_t total = std::accumulate(histogram.begin(), histogram.end(),
+                                         uint64_t(0));
+
+  m_owner_bounds.assign(m_mpi_size + 1, num_labels);
+  m_owner_bounds[0] = 0;
+  uint64_t prefix = 0;
+  int rank = 1;
+  for (uint64_t b = 0; b < num_buckets && rank < m_mpi_size; ++b) {
+    prefix += histogram[b];
+    while (rank < m_mpi_size &&
+           double(prefix) >= double(total) * rank / m_mpi_size) {
+      m_owner_bounds[rank++] = std::min(num_labels, (b + 1) * bucket_width);
+    }
+  }
+}  // compute_owner_bounds
+
 /**
  * This function iterates (1) through the edges and calculates the following:
  *
@@ -320,30 +1190,35 @@ count_edge_degrees(InputIterator unsorted_itr, InputIterator unsorted_itr_end,
       edge_counter++;
 
       // Update this vertex's outgoing edge count (first member of the pair)
-      uint64_t local_id = local_source_id(m_mpi_size)(*unsorted_itr);
-      int owner    = owner_source_id(m_mpi_size)(*unsorted_itr);
+      uint64_t local_id = local_source_id(ownership())(*unsorted_itr);
+      int owner    = owner_source_id(ownership())(*unsorted_itr);
       if (owner == m_mpi_rank) {
         m_local_outgoing_count[local_id]++;
         if (m_local_outgoing_count[local_id] == delegate_degree_threshold) {
           high_vertex_count++;
         }
       } else {
-        maps_to_send.at(owner)[local_id].first++;
+        std::pair<uint64_t, uint64_t>& counts = maps_to_send.at(owner)[local_id];
+        if (counts.first == 0 && counts.second == 0) {
+          maps_to_send_element_count++;
+        }
+        counts.first++;
       }
 
       // Update the vertex's incoming edge count (second member of the pair)
-      local_id = local_dest_id(m_mpi_size)(*unsorted_itr);
-      owner    = owner_dest_id(m_mpi_size)(*unsorted_itr);
+      local_id = local_dest_id(ownership())(*unsorted_itr);
+      owner    = owner_dest_id(ownership())(*unsorted_itr);
       if (owner == m_mpi_rank) {
         m_local_incoming_count[local_id]++;
         // if (m_local_incoming_count[local_id] == delegate_degree_threshold) {
         //   high_vertex_count++;
         // }
       } else {
-        int c = maps_to_send.at(owner)[local_id].second++;
-        if (c == 0) {
+        std::pair<uint64_t, uint64_t>& counts = maps_to_send.at(owner)[local_id];
+        if (counts.first == 0 && counts.second == 0) {
           maps_to_send_element_count++;
         }
+        counts.second++;
       }
 
       unsorted_itr++;
@@ -369,6 +1244,14 @@ count_edge_degrees(InputIterator unsorted_itr, InputIterator unsorted_itr_end,
   }
   mpi_yield_barrier(m_mpi_comm);
 
+  if (delegate_degree_threshold == 0) {
+    delegate_degree_threshold = choose_delegate_threshold();
+    m_delegate_degree_threshold = delegate_degree_threshold;
+    high_vertex_count = std::count_if(m_local_outgoing_count.begin(),
+        m_local_outgoing_count.end(), [delegate_degree_threshold](uint32_t d) {
+          return d >= delegate_degree_threshold;
+        });
+  }
 
   // Now, the m_local_incoming_count contains the total incoming and outgoing
   // edges for each vertex owned by this node.
@@ -380,7 +1263,7 @@ count_edge_degrees(InputIterator unsorted_itr, InputIterator unsorted_itr_end,
     // const uint64_t incoming = m_local_incoming_count[i];
 
     if (outgoing >= delegate_degree_threshold) {
-      const uint64_t global_id = (i * m_mpi_size) + m_mpi_rank;
+      const uint64_t global_id = ownership().label(m_mpi_rank, i);
       assert(global_id != 0);
       temp_hubs.push_back(global_id);
     } else {
@@ -408,6 +1291,164 @@ count_edge_degrees(InputIterator unsorted_itr, InputIterator unsorted_itr_end,
 
 }  // count_edge_degrees
 
+/**
+ * Picks the delegate threshold from the degrees counted by
+ * count_edge_degrees, for a construction given a threshold of 0.
+ *
+ * For candidate thresholds t, four per power of two, rank r keeps low(r, t),
+ * the edges of its vertices with degree < t.  The delegates' edges are
+ * spread to even out the ranks, so the largest rank is predicted to hold
+ * max(max_r low(r, t), mean) edges.  The largest t predicted within
+ * HAVOQGT_DELEGATE_IMBALANCE_PERCENT of the mean is chosen, then raised
+ * until there are at most HAVOQGT_DELEGATE_MAX delegates.
+ */
+template <typename SegmentManager>
+uint64_t
+delegate_partitioned_graph<SegmentManager>::
+choose_delegate_threshold() {
+  std::vector<uint64_t> candidates;
+  for (int k = 0; k <= 4 * 40; ++k) {
+    const uint64_t t = uint64_t(std::pow(2.0, k / 4.0));
+    if (candidates.empty() || t > candidates.back()) {
+      candidates.push_back(t);
+    }
+  }
+  const size_t n = candidates.size();
+
+  // Edges and vertices of this rank with candidates[j] <= degree < candidates[j+1]
+  std::vector<uint64_t> bucket_edges(n, 0);
+  std::vector<uint64_t> bucket_vertices(n, 0);
+  for (size_t i = 0; i < m_local_outgoing_count.size(); ++i) {
+    const uint64_t degree = m_local_outgoing_count[i];
+    if (degree > 0) {
+      const size_t j = std::upper_bound(candidates.begin(), candidates.end(),
+                                        degree) - candidates.begin() - 1;
+      bucket_edges[j] += degree;
+      ++bucket_vertices[j];
+    }
+  }
+
+  // max_low_edges[k]: largest low(r, candidates[k]); delegates[k]: number of
+  // vertices with degree >= candidates[k]
+  std::vector<uint64_t> max_low_edges(n, 0);
+  std::vector<uint64_t> delegates(n, 0);
+  for (size_t k = 1; k < n; ++k) {
+    max_low_edges[k] = max_low_edges[k - 1] + bucket_edges[k - 1];
+  }
+  delegates[n - 1] = bucket_vertices[n - 1];
+  for (size_t k = n - 1; k > 0; --k) {
+    delegates[k - 1] = delegates[k] + bucket_vertices[k - 1];
+  }
+  const uint64_t local_edges = max_low_edges[n - 1] + bucket_edges[n - 1];
+  mpi_all_reduce_inplace(max_low_edges, std::greater<uint64_t>(), m_mpi_comm);
+  mpi_all_reduce_inplace(delegates, std::plus<uint64_t>(), m_mpi_comm);
+  const uint64_t global_edges = mpi_all_reduce(local_edges,
+      std::plus<uint64_t>(), m_mpi_comm);
+
+  const double mean = std::max(double(global_edges) / m_mpi_size, 1.0);
+  auto imbalance = [&](size_t k) {
+    return std::max(double(max_low_edges[k]), mean) / mean;
+  };
+  const double max_imbalance =
+      1.0 + get_environment().delegate_imbalance_percent() / 100.0;
+  size_t chosen = 0;
+  while (chosen + 1 < n && imbalance(chosen + 1) <= max_imbalance) {
+    ++chosen;
+  }
+  while (chosen + 1 < n && delegates[chosen] > get_environment().delegate_max()) {
+    ++chosen;
+  }
+
+  if (m_mpi_rank == 0) {
+    std::cout << "\tAutomatic delegate threshold: " << candidates[chosen]
+              << ", " << delegates[chosen] << " delegates, predicted edge "
+              << "imbalance " << imbalance(chosen) << std::endl;
+  }
+  return candidates[chosen];
+}  // choose_delegate_threshold
+
+/**
+ * Streaming alternative to count_edge_degrees that only identifies the hubs.
+ *
+ * A Count-Min sketch of source degrees is built over the local edges and
+ * summed across ranks.  Sources whose estimate reaches the threshold become
+ * candidates; since the sketch never undercounts, no hub is missed.  A second
+ * local pass counts the candidates' degrees exactly and their owners keep the
+ * ones that really are hubs.  Only the candidates are ever exchanged, and
+ * low degree counts are left to count_high_degree_edges.
+ *
+ * @param edges: input edges, iterated twice
+ * @param global_hubs: filled with the hubs of all ranks
+ * @param delegate_degree_threshold: The mininum number of edges a high degree
+ *  vertex has outgoing.
+ */
+template <typename SegmentManager>
+template <typename Container>
+void
+delegate_partitioned_graph<SegmentManager>::
+find_hubs_with_sketch(Container& edges,
+                      boost::unordered_set<uint64_t>& global_hubs,
+                      uint64_t delegate_degree_threshold) {
+  const uint64_t global_edges = mpi_all_reduce(uint64_t(edges.size()),
+      std::plus<uint64_t>(), m_mpi_comm);
+
+  // A row overcounts by global_edges / width on average; keep that around
+  // an eighth of the threshold so few low vertices become candidates.
+  size_t width = 1024;
+  while (width < (size_t(1) << 20) &&
+         width * delegate_degree_threshold < 8 * global_edges) {
+    width <<= 1;
+  }
+  havoqgt::detail::count_min_sketch sketch(width);
+  for (auto itr = edges.begin(); itr != edges.end(); ++itr) {
+    sketch.add((*itr).first);
+  }
+  sketch.all_reduce(m_mpi_comm);
+
+  boost::unordered_map<uint64_t, uint64_t> candidate_degree;
+  for (auto itr = edges.begin(); itr != edges.end(); ++itr) {
+    const uint64_t source = (*itr).first;
+    if (sketch.estimate(source) >= delegate_degree_threshold) {
+      candidate_degree[source]++;
+    }
+  }
+
+  // Sum the candidates' partial degrees at their owners
+  std::vector< std::vector<uint64_t> > to_send(m_mpi_size), to_recv;
+  for (auto itr = candidate_degree.begin(); itr != candidate_degree.end(); ++itr) {
+    const int owner = ownership().owner(itr->first);
+    to_send[owner].push_back(itr->first);
+    to_send[owner].push_back(itr->second);
+  }
+  const uint64_t global_candidates = mpi_all_reduce(
+      uint64_t(candidate_degree.size()), std::plus<uint64_t>(), m_mpi_comm);
+  mpi_all_to_all(to_send, to_recv, m_mpi_comm);
+  candidate_degree.clear();
+  for (size_t r = 0; r < to_recv.size(); r++) {
+    for (size_t k = 0; k < to_recv[r].size(); k += 2) {
+      candidate_degree[to_recv[r][k]] += to_recv[r][k+1];
+    }
+  }
+
+  std::vector<uint64_t> temp_hubs;
+  for (auto itr = candidate_degree.begin(); itr != candidate_degree.end(); ++itr) {
+    if (itr->second >= delegate_degree_threshold) {
+      temp_hubs.push_back(itr->first);
+    }
+  }
+  std::sort(temp_hubs.begin(), temp_hubs.end());
+
+  std::vector<uint64_t> vec_global_hubs;
+  mpi_yield_barrier(m_mpi_comm);
+  mpi_all_gather(temp_hubs, vec_global_hubs, m_mpi_comm);
+  global_hubs.insert(vec_global_hubs.begin(), vec_global_hubs.end());
+
+  if (m_mpi_rank == 0) {
+    std::cout << "\tHub sketch: " << sketch.bytes() << " bytes, "
+      << global_candidates << " candidate entries." << std::endl;
+  }
+}  // find_hubs_with_sketch
+
 /**
  * This function is used to send/recv information about vertexes during the
  * count_edge_degrees function.
@@ -465,7 +1506,7 @@ send_vertex_info(uint64_t& high_vertex_count, uint64_t delegate_degree_threshold
     //   high_vertex_count++;
     // }
     if (m_local_outgoing_count[local_id] < delegate_degree_threshold
-      && m_local_outgoing_count[local_id] + dest_count >=
+      && m_local_outgoing_count[local_id] + source_count >=
       delegate_degree_threshold) {
 
       high_vertex_count++;
@@ -503,18 +1544,20 @@ initialize_low_meta_data(boost::unordered_set<uint64_t>& global_hubs) {
   // Initilize the m_owned_info, by iterating through owned vertexes and
   //  if it is not a hub, then it incremenets the edge count by the number of
   //  outgoing edges.
+  //  Delegate tags already set by initialize_high_meta_data are kept.
   uint64_t edge_count = 0;
   for (uint64_t vert_id = 0; vert_id < m_owned_info.size(); vert_id++) {
-    const uint64_t outgoing = m_local_outgoing_count[vert_id];
-    const uint64_t incoming = m_local_incoming_count[vert_id];
+    // The last entry only closes the CSR and has no degree count.
+    const uint64_t outgoing = vert_id < m_local_outgoing_count.size()
+                              ? m_local_outgoing_count[vert_id] : 0;
 
-    m_owned_info[vert_id] = vert_info(false, 0, edge_count);
+    m_owned_info[vert_id].low_csr_idx = edge_count;
 
     if (outgoing < m_delegate_degree_threshold) {
       edge_count += outgoing;
     } else {
       #ifdef DEBUG_DPG
-        const uint64_t global_id = (vert_id * m_mpi_size) + m_mpi_rank;
+        const uint64_t global_id = ownership().label(m_mpi_rank, vert_id);
         assert(global_id != 0);
         if (global_id < m_max_vertex) {
           // IF vert_id == size-1 then the above will be true
@@ -593,8 +1636,8 @@ initialize_high_meta_data(boost::unordered_set<uint64_t>& global_hubs) {
       // Loop over the hub vertexes:
       //  initilizing the delegate_degree tracking structures
       for(size_t i=0; i<vec_sorted_hubs.size(); ++i) {
-        uint64_t t_local_id = vec_sorted_hubs[i] / uint64_t(m_mpi_size);
-        int t_owner = uint32_t(vec_sorted_hubs[i] % uint32_t(m_mpi_size));
+        uint64_t t_local_id = ownership().local_id(vec_sorted_hubs[i]);
+        int t_owner = ownership().owner(vec_sorted_hubs[i]);
         vertex_locator new_ver_loc(true, i, t_owner);
 
         m_map_delegate_locator[vec_sorted_hubs[i]] = new_ver_loc;
@@ -617,7 +1660,8 @@ initialize_high_meta_data(boost::unordered_set<uint64_t>& global_hubs) {
 template <typename SegmentManager>
 void
 delegate_partitioned_graph<SegmentManager>::
-initialize_edge_storage(const SegmentAllocator<void>& seg_allocator) {
+initialize_edge_storage(const SegmentAllocator<void>& seg_allocator,
+                        bool weighted) {
   // Allocate the low edge csr to accommdate the number of edges
   // This will be filled by the partion_low_edge function
   for (int i = 0; i < processes_per_node; i++) {
@@ -648,6 +1692,12 @@ initialize_edge_storage(const SegmentAllocator<void>& seg_allocator) {
         m_owned_targets = (vertex_locator*) segment_manager->allocate(m_owned_targets_size * sizeof(vertex_locator));
       }
 
+      if (weighted) {
+        m_edge_weights = segment_manager->template construct<edge_weight_data>(
+            bip::anonymous_instance)(m_owned_targets_size,
+            m_delegate_targets_size, segment_manager);
+      }
+
       // Currently, m_delegate_info holds the count of high degree edges
       // assigned to this node for each vertex.
       // Below converts it into an index into the m_delegate_targets array
@@ -668,6 +1718,39 @@ initialize_edge_storage(const SegmentAllocator<void>& seg_allocator) {
 
 
 
+/**
+ * Appends an edge to its source's slot in the low CSR, and its weight to the
+ * same position if it is a weighted_edge.
+ */
+template <typename SegmentManager>
+template <typename Record>
+void
+delegate_partitioned_graph<SegmentManager>::
+append_low_edge(const Record& edge) {
+  uint64_t new_vertex_id = local_source_id(ownership())(edge);
+  assert(m_mpi_rank == ownership().owner(edge.first));
+
+  uint64_t temp_offset = (m_owned_info_tracker[new_vertex_id])++;
+  uint64_t loc = temp_offset + m_owned_info[new_vertex_id].low_csr_idx;
+
+
+  if (!(loc <  m_owned_info[new_vertex_id+1].low_csr_idx)) {
+    std::cout << "Error rank: " << m_mpi_rank << " -- " <<
+             loc << " < " <<  m_owned_info[new_vertex_id+1].low_csr_idx
+             << ", new_vertex_id = " << new_vertex_id
+             << ", temp_offset = " << temp_offset
+             << ", edge = (" << edge.first << "," << edge.second << ")"
+    << std::endl << std::flush;
+    assert(false);
+    exit(-1);
+  }
+  /// @todo this was tripping, is this old?   Could be left over from before when targets was vector based.
+  //assert(!m_owned_targets[loc].is_valid());
+
+  m_owned_targets[loc] = label_to_locator(edge.second);
+  store_edge_weight(edge, false, loc);
+}
+
 /**
  * This function iterates (2) through the edges and sends the low degree edges
  * to the nodes that own them.
@@ -675,12 +1758,21 @@ initialize_edge_storage(const SegmentAllocator<void>& seg_allocator) {
  * At the same time it tracks the number of outgoing edges for each delegate
  * vertex and exchanges that information with the other nodes.
  *
+ * With HAVOQGT_EXTERNAL_SORT_MB set, received edges are instead written to
+ * sorted runs of that size on scratch (HAVOQGT_INGEST_SCRATCH, else /tmp)
+ * in a single pass, then k-way merged so the CSR is written sequentially.
+ * The runs hold plain edges, so weighted edges are always sorted in memory.
+ *
+ * Record is the exchanged edge type; a weighted_edge's weight is stored at
+ * its target's position.
  */
 template <typename SegmentManager>
-template <typename Container>
+template <typename Record, typename Container>
 void
 delegate_partitioned_graph<SegmentManager>::
 partition_low_degree(Container& unsorted_edges) {
+  // Fill positions restart at zero, also when a resumed phase is redone.
+  std::fill(m_owned_info_tracker.begin(), m_owned_info_tracker.end(), 0);
 
   uint64_t loop_counter = 0;
   uint64_t edge_counter = 0;
@@ -688,8 +1780,29 @@ partition_low_degree(Container& unsorted_edges) {
   double start_time, last_loop_time, last_part_time;
   start_time = last_loop_time = last_part_time = MPI_Wtime();
 
+  // Received edges are label pairs, so only the label bits need sorting.
+  const int label_bits = havoqgt::detail::significant_bits(m_global_max_vertex);
+  const size_t sort_threads = ingest_thread_count();
 
-  for (size_t node_turn = 0; node_turn < node_partitions; node_turn++) {
+  // Sequential CSR writes need no node turns to limit page cache pressure.
+  std::unique_ptr<havoqgt::detail::external_edge_sort> sorter;
+  size_t low_partitions = node_partitions;
+  const uint64_t external_sort_mb = get_environment().external_sort_mb();
+  if (external_sort_mb > 0 && has_edge_weights()) {
+    if (m_mpi_rank == 0) {
+      std::cout << "\tHAVOQGT_EXTERNAL_SORT_MB is ignored for weighted edges."
+                << std::endl;
+    }
+  } else if (external_sort_mb > 0) {
+    std::string scratch = get_environment().ingest_scratch();
+    sorter.reset(new havoqgt::detail::external_edge_sort(
+        scratch.empty() ? std::string("/tmp") : scratch,
+        (external_sort_mb << 20) / sizeof(std::pair<uint64_t, uint64_t>),
+        label_bits, label_bits, sort_threads));
+    low_partitions = 1;
+  }
+
+  for (size_t node_turn = 0; node_turn < low_partitions; node_turn++) {
 
     auto unsorted_itr     = unsorted_edges.begin();
     auto unsorted_itr_end = unsorted_edges.end();
@@ -697,7 +1810,7 @@ partition_low_degree(Container& unsorted_edges) {
       double curr_time = MPI_Wtime();
 
       std::cout << "\t***[LP]["
-        << "Partition Number: " << node_turn << "/" << node_partitions << ", "
+        << "Partition Number: " << node_turn << "/" << low_partitions << ", "
         << "Total Loops: " << loop_counter << ", "
         << "Total Edges: " << edge_counter
         <<  "] Time " << (curr_time - last_part_time) << " second, "
@@ -715,7 +1828,7 @@ partition_low_degree(Container& unsorted_edges) {
         double curr_time = MPI_Wtime();
 
         std::cout << "\t[LP]["
-          << "Partition Number: " << node_turn << "/" << node_partitions << ", "
+          << "Partition Number: " << node_turn << "/" << low_partitions << ", "
           << "Total Loops: " << loop_counter << ", "
           << "Total Edges: " << edge_counter
           <<  "] Time " << (curr_time - last_loop_time) << " second, "
@@ -729,10 +1842,10 @@ partition_low_degree(Container& unsorted_edges) {
       loop_counter++;
 
       // Generate Edges to Send
-      std::vector<std::pair<uint64_t, uint64_t> > to_recv_edges_low;
+      std::vector<Record> to_recv_edges_low;
 
       {
-        std::vector<std::pair<uint64_t, uint64_t> > to_send_edges_low;
+        std::vector<Record> to_send_edges_low;
         to_send_edges_low.reserve(edge_chunk_size);
 
         for (size_t i = 0;
@@ -742,15 +1855,17 @@ partition_low_degree(Container& unsorted_edges) {
           const auto edge = *unsorted_itr;
 
           {
-            const int owner = unsorted_itr->first %m_mpi_size;
-            if ( (owner % processes_per_node) % node_partitions != node_turn ) {
+            const int owner = ownership().owner(unsorted_itr->first);
+            if ( (owner % processes_per_node) % low_partitions != node_turn ) {
               continue;
             }
           }
           edge_counter++;
 
           if (m_map_delegate_locator.count(unsorted_itr->first) == 0) {
-            to_send_edges_low.push_back(*unsorted_itr);
+            Record record;
+            read_edge_record(unsorted_itr, record);
+            to_send_edges_low.push_back(record);
             ++i;
           } else {
             continue;
@@ -758,20 +1873,28 @@ partition_low_degree(Container& unsorted_edges) {
         }  // for
 
         // Exchange Edges/Recieve edges
-        edge_source_partitioner paritioner(m_mpi_size);
+        edge_source_partitioner paritioner(ownership());
         mpi_yield_barrier(m_mpi_comm);
         mpi_all_to_all_better(to_send_edges_low, to_recv_edges_low, paritioner,
             m_mpi_comm);
       }
 
-      std::sort(to_recv_edges_low.begin(), to_recv_edges_low.end());
+      if (sorter) {
+        for (size_t i = 0; i < to_recv_edges_low.size(); ++i) {
+          sorter->push(to_recv_edges_low[i]);
+        }
+        continue;
+      }
+
+      havoqgt::detail::radix_sort_pairs(to_recv_edges_low, label_bits,
+                                        label_bits, sort_threads);
 
 
   #ifdef DEBUG_DPG
       // Sanity Check to make sure we recieve the correct edges
       for (size_t i = 0; i<to_recv_edges_low.size(); ++i) {
         auto edge =  to_recv_edges_low[i];
-        assert(int(edge.first) % m_mpi_size ==m_mpi_rank);
+        assert(ownership().owner(edge.first) == m_mpi_rank);
         assert(m_map_delegate_locator.count(edge.first) == 0);
       }
   #endif
@@ -779,33 +1902,22 @@ partition_low_degree(Container& unsorted_edges) {
       // Loop over recieved edges, appending them to the low CSR
       auto itr_end = to_recv_edges_low.end();
       for (auto itr = to_recv_edges_low.begin(); itr != itr_end; itr++) {
-
-        auto edge = *itr;
-        uint64_t new_vertex_id = local_source_id(m_mpi_size)(edge);
-        assert(m_mpi_rank == int(edge.first % m_mpi_size));
-
-        uint64_t temp_offset = (m_owned_info_tracker[new_vertex_id])++;
-        uint64_t loc = temp_offset + m_owned_info[new_vertex_id].low_csr_idx;
-
-
-        if (!(loc <  m_owned_info[new_vertex_id+1].low_csr_idx)) {
-          std::cout << "Error rank: " << m_mpi_rank << " -- " <<
-                   loc << " < " <<  m_owned_info[new_vertex_id+1].low_csr_idx
-                   << ", new_vertex_id = " << new_vertex_id
-                   << ", temp_offset = " << temp_offset
-                   << ", edge = (" << edge.first << "," << edge.second << ")"
-          << std::endl << std::flush;
-          assert(false);
-          exit(-1);
-        }
-        /// @todo this was tripping, is this old?   Could be left over from before when targets was vector based.
-        //assert(!m_owned_targets[loc].is_valid());
-
-        m_owned_targets[loc] = label_to_locator(edge.second);
+        append_low_edge(*itr);
       }  // for over recieved egdes
     }  // while global iterator range not empty
   }  // for node partition
 
+  if (sorter) {
+    uint64_t runs = mpi_all_reduce(uint64_t(sorter->num_runs()),
+        std::plus<uint64_t>(), m_mpi_comm);
+    if (m_mpi_rank == 0) {
+      std::cout << "\t[LP] Merging " << runs << " sorted runs." << std::endl;
+    }
+    sorter->merge([this](const std::pair<uint64_t, uint64_t>& edge) {
+      append_low_edge(edge);
+    });
+  }
+
   mpi_yield_barrier(m_mpi_comm);
   if (m_mpi_rank == 0) {
     double curr_time = MPI_Wtime();
@@ -835,7 +1947,8 @@ void
 delegate_partitioned_graph<SegmentManager>::
 count_high_degree_edges(InputIterator unsorted_itr,
                  InputIterator unsorted_itr_end,
-                 boost::unordered_set<uint64_t>& global_hub_set) {
+                 boost::unordered_set<uint64_t>& global_hub_set,
+                 bool count_low_edges) {
   // Temp Vector for storing offsets
   // Used to store high_edge count
   #if DEBUG_DPG
@@ -873,6 +1986,10 @@ count_high_degree_edges(InputIterator unsorted_itr,
     std::vector<
       boost::container::map<uint64_t, uint64_t> > maps_to_send(m_mpi_size);
     int maps_to_send_element_count = 0;
+    // Outgoing edge counts of low vertices, keyed by local id
+    std::vector<
+      boost::container::map<uint64_t, uint64_t> > low_maps_to_send(m_mpi_size);
+    int low_maps_to_send_element_count = 0;
     {
       for (size_t i=0; unsorted_itr != unsorted_itr_end && i < edge_chunk_size;
            ++unsorted_itr) {
@@ -883,16 +2000,27 @@ count_high_degree_edges(InputIterator unsorted_itr,
 
 
         if (global_hub_set.count(unsorted_itr->first) == 0) {
+          if (count_low_edges) {
+            const uint64_t local_id = local_source_id(ownership())(edge);
+            const int owner = owner_source_id(ownership())(edge);
+            if (owner == m_mpi_rank) {
+              m_local_outgoing_count[local_id]++;
+              m_edges_low_count++;
+            } else if (low_maps_to_send.at(owner)[local_id]++ == 0) {
+              low_maps_to_send_element_count++;
+              i++;
+            }
+          }
           continue;
         } else if(global_hub_set.count(unsorted_itr->first)) {
           #if DEBUG_DPG
             // This edge's source is a hub
             // 1) Increment the high edge count for the owner of the edge's dest
-            tmp_high_count_per_rank[unsorted_itr->second %m_mpi_size]++;
+            tmp_high_count_per_rank[ownership().owner(unsorted_itr->second)]++;
           #endif
 
           // 2) Increment the owner's count of edges for this hub.
-          const int owner = unsorted_itr->second %m_mpi_size;
+          const int owner = ownership().owner(unsorted_itr->second);
           if (owner == m_mpi_rank) {
             const uint64_t ver_id = unsorted_itr->first;
 
@@ -913,6 +2041,9 @@ count_high_degree_edges(InputIterator unsorted_itr,
       }  // for
       // Send the hub edge count to the relevent nodes.
       send_high_info(maps_to_send, maps_to_send_element_count);
+      if (count_low_edges) {
+        send_low_info(low_maps_to_send, low_maps_to_send_element_count);
+      }
     }
 
   }  // while global iterator range not empty
@@ -993,6 +2124,47 @@ send_high_info(std::vector< boost::container::map< uint64_t, uint64_t> >&
     m_edges_high_count += delegate_dest_count;
   }
 }  // send_high_info
+
+/**
+ * Like send_high_info, but for the outgoing edge counts of low degree
+ * vertices, which are added to m_local_outgoing_count at their owner.
+ *
+ * @param maps_to_send: a vector of maps that map local vertex id to edge count.
+ */
+template <typename SegmentManager>
+void
+delegate_partitioned_graph<SegmentManager>::
+send_low_info(std::vector< boost::container::map< uint64_t, uint64_t> >&
+  maps_to_send, int maps_to_send_element_count) {
+
+  int to_send_pos = 0;
+  std::vector<uint64_t> to_send(maps_to_send_element_count*2, 0);
+  std::vector<int> to_send_count(m_mpi_size, 0);
+
+  assert(maps_to_send.size() == m_mpi_size);
+  for (size_t i = 0; i < maps_to_send.size(); i++) {
+    for (auto itr = maps_to_send[i].begin(); itr != maps_to_send[i].end(); itr++) {
+      assert(to_send_pos < to_send.size());
+      to_send[to_send_pos++] = itr->first;
+      to_send[to_send_pos++] = itr->second;
+    }
+    to_send_count[i] = maps_to_send[i].size()*2;
+  }
+
+  std::vector<uint64_t> to_recv;
+  std::vector<int> out_recvcnts;
+
+  mpi_yield_barrier(m_mpi_comm);
+  mpi_all_to_all(to_send, to_send_count,to_recv, out_recvcnts, m_mpi_comm);
+
+  for (size_t i = 0; i < to_recv.size(); i++) {
+    const uint64_t local_id = to_recv[i++];
+    const uint64_t source_count = to_recv[i];
+    assert(local_id < m_local_outgoing_count.size());
+    m_local_outgoing_count[local_id] += source_count;
+    m_edges_low_count += source_count;
+  }
+}  // send_low_info
    //
 
 /**
@@ -1251,14 +2423,23 @@ generate_send_list(std::vector<uint64_t> &send_list, uint64_t num_send,
  * used to determine where overflowed edges go.
  */
 template <typename SegmentManager>
-template <typename Container>
+template <typename Record, typename Container>
 void
 delegate_partitioned_graph<SegmentManager>::
 partition_high_degree(Container& unsorted_edges,
     std::map< uint64_t, std::deque<OverflowSendInfo> > &transfer_info) {
 
   // Initates the paritioner, which determines where overflowed edges go
-  high_edge_partitioner paritioner(m_mpi_size, m_mpi_rank, &transfer_info);
+  high_edge_partitioner paritioner(ownership(), m_mpi_rank, &transfer_info);
+
+  // m_delegate_degree counts the edges placed in each local slice.
+  std::fill(m_delegate_degree.begin(), m_delegate_degree.end(), 0);
+
+  // Received edges pair a delegate local id with a target label.
+  const int delegate_bits =
+      havoqgt::detail::significant_bits(m_delegate_info.size());
+  const int label_bits = havoqgt::detail::significant_bits(m_global_max_vertex);
+  const size_t sort_threads = ingest_thread_count();
 
   uint64_t loop_counter = 0;
   uint64_t edge_counter = 0;
@@ -1267,7 +2448,7 @@ partition_high_degree(Container& unsorted_edges,
   uint64_t gave_edge_counter = 0;
 
   // Scratch vector use for storing edges to send
-  std::vector<std::pair<uint64_t, uint64_t> > to_send_edges_high;
+  std::vector<Record> to_send_edges_high;
   to_send_edges_high.reserve(edge_chunk_size);
 
   for (size_t node_turn = 0; node_turn < node_partitions; node_turn++) {
@@ -1314,11 +2495,12 @@ partition_high_degree(Container& unsorted_edges,
       while (unsorted_itr != unsorted_itr_end &&
              to_send_edges_high.size() < edge_chunk_size) {
         // Get next edge
-        const auto edge = *unsorted_itr;
+        Record edge;
+        read_edge_record(unsorted_itr, edge);
         ++unsorted_itr;
 
         {
-            const int owner = unsorted_itr->second %m_mpi_size;
+            const int owner = ownership().owner(unsorted_itr->second);
             if (owner % processes_per_node % node_partitions != node_turn) {
               continue;
             }
@@ -1334,7 +2516,8 @@ partition_high_degree(Container& unsorted_edges,
           assert(new_source_id >=0 && new_source_id < m_delegate_info.size()-1);
 
           // Send the edge if we don't own it or if we own it but have no room.
-          to_send_edges_high.push_back(std::make_pair(new_source_id, edge.second));
+          edge.first = new_source_id;
+          to_send_edges_high.push_back(edge);
         }  // end if is a hub
         else {
           // assert(global_hub_set.count(edge.first) == 0);
@@ -1345,20 +2528,21 @@ partition_high_degree(Container& unsorted_edges,
       // Exchange edges we generated that we don't need with the other nodes and
       // recieve edges we may need
       // // Scratch vector use for storing recieved edges.
-      std::vector< std::pair<uint64_t, uint64_t> > to_recv_edges_high;
+      std::vector<Record> to_recv_edges_high;
       mpi_yield_barrier(m_mpi_comm);
       mpi_all_to_all_better(to_send_edges_high, to_recv_edges_high, paritioner,
          m_mpi_comm);
 
       // Empty the vector
       {
-        std::vector<std::pair<uint64_t, uint64_t> > temp;
+        std::vector<Record> temp;
         to_send_edges_high.swap(temp);
       }
       to_send_edges_high.reserve(edge_chunk_size);
 
       assert(to_send_edges_high.size() == 0);
-      std::sort(to_recv_edges_high.begin(), to_recv_edges_high.end());
+      havoqgt::detail::radix_sort_pairs(to_recv_edges_high, delegate_bits,
+                                        label_bits, sort_threads);
 
       for (size_t i = 0; i < to_recv_edges_high.size(); ++i) {
         // Iterate over recieved edges, addiing them using similar logic from
@@ -1384,10 +2568,11 @@ partition_high_degree(Container& unsorted_edges,
 
           uint64_t new_target_label = edge.second;
           m_delegate_targets[place_pos] = label_to_locator(new_target_label);
+          store_edge_weight(edge, true, place_pos);
           assert(m_delegate_targets[place_pos].m_owner_dest < m_mpi_size);
           m_delegate_degree[new_source_id]++;
 
-          if (owner_dest_id(m_mpi_size)(edge) != m_mpi_rank) {
+          if (owner_dest_id(ownership())(edge) != m_mpi_rank) {
             assert(transfer_info.size() == 0);
           }
 
@@ -1412,18 +2597,19 @@ partition_high_degree(Container& unsorted_edges,
   {//
   // Exchange edges we generated  with the other nodes and recieve edges we may need
     // // Scratch vector use for storing recieved edges.
-    std::vector< std::pair<uint64_t, uint64_t> > to_recv_edges_high;
+    std::vector<Record> to_recv_edges_high;
     mpi_yield_barrier(m_mpi_comm);
     mpi_all_to_all_better(to_send_edges_high, to_recv_edges_high, paritioner,
        m_mpi_comm);
 
     // Empty the vector
     {
-      std::vector<std::pair<uint64_t, uint64_t> > temp;
+      std::vector<Record> temp;
       to_send_edges_high.swap(temp);
     }
 
-    std::sort(to_recv_edges_high.begin(), to_recv_edges_high.end());
+    havoqgt::detail::radix_sort_pairs(to_recv_edges_high, delegate_bits,
+                                      label_bits, sort_threads);
     for (size_t i=0; i<to_recv_edges_high.size(); ++i) {
       // Iterate over recieved edges, addiing them using similar logic from
       // above
@@ -1445,10 +2631,11 @@ partition_high_degree(Container& unsorted_edges,
 
         uint64_t new_target_label = edge.second;
         m_delegate_targets[place_pos] = label_to_locator(new_target_label);
+        store_edge_weight(edge, true, place_pos);
         assert(m_delegate_targets[place_pos].m_owner_dest < m_mpi_size);
         m_delegate_degree[new_source_id]++;
 
-        if (owner_dest_id(m_mpi_size)(edge) != m_mpi_rank) {
+        if (owner_dest_id(ownership())(edge) != m_mpi_rank) {
           assert(transfer_info.size() == 0);
         }
 
@@ -1494,8 +2681,11 @@ locator_to_label(delegate_partitioned_graph<SegmentManager>::vertex_locator
   if(locator.is_delegate()) {
     res = m_delegate_label[locator.local_id()];
   } else {
-    res = uint64_t(locator.local_id()) * uint64_t(m_mpi_size) +
-         uint64_t(locator.owner());
+    uint64_t local_id = locator.local_id();
+    if(!m_relabel_backward.empty()) {
+      local_id = relabel_lookup(m_relabel_backward, locator.owner(), local_id);
+    }
+    res = ownership().label(locator.owner(), local_id);
   }
   return res;
 }  // locator_to_label
@@ -1516,8 +2706,12 @@ label_to_locator(uint64_t label) const {
  auto itr = m_map_delegate_locator.find(label);
 
   if(itr == m_map_delegate_locator.end()) {
-    uint32_t owner    = label % uint64_t(m_mpi_size);
-    uint64_t local_id = label / uint64_t(m_mpi_size);
+    const label_partition partition = ownership();
+    uint32_t owner    = partition.owner(label);
+    uint64_t local_id = partition.local_id(label);
+    if(!m_relabel_forward.empty()) {
+      local_id = relabel_lookup(m_relabel_forward, owner, local_id);
+    }
     return vertex_locator(false, local_id, owner);
   }
   return itr->second;
@@ -1559,14 +2753,32 @@ typename delegate_partitioned_graph<SegmentManager>::edge_iterator
 delegate_partitioned_graph<SegmentManager>::
 edges_begin(delegate_partitioned_graph<SegmentManager>::vertex_locator
              locator) const {
+  uint64_t csr_begin, csr_end, stream_offset, delta_offset;
   if(locator.is_delegate()) {
     assert(locator.local_id() < m_delegate_info.size()-1);
-    return edge_iterator(locator, m_delegate_info[locator.local_id()], this);
+    csr_begin = m_delegate_info[locator.local_id()];
+    csr_end = m_delegate_info[locator.local_id() + 1];
+    stream_offset = m_targets_compressed
+        ? m_delegate_stream_offsets[locator.local_id()] : 0;
+    delta_offset = m_delegate_targets_size;
+  } else {
+    assert(locator.owner() == m_mpi_rank);
+    assert(locator.local_id() < m_owned_info.size());
+    csr_begin = m_owned_info[locator.local_id()].low_csr_idx;
+    csr_end = m_owned_info[locator.local_id() + 1].low_csr_idx;
+    stream_offset = m_targets_compressed
+        ? m_owned_stream_offsets[locator.local_id()] : 0;
+    delta_offset = m_owned_targets_size;
   }
-  assert(locator.owner() == m_mpi_rank);
-  assert(locator.local_id() < m_owned_info.size());
-  return edge_iterator(locator, m_owned_info[locator.local_id()].low_csr_idx,
-                       this);
+
+  std::pair<uint64_t, uint64_t> delta = delta_range(locator);
+  if(delta.first == delta.second) {
+    return edge_iterator(locator, csr_begin, this, stream_offset, csr_end,
+                         csr_end);
+  }
+  const uint64_t delta_begin = delta_offset + delta.first;
+  return edge_iterator(locator, csr_begin == csr_end ? delta_begin : csr_begin,
+                       this, stream_offset, csr_end, delta_begin);
 }
 
 /**
@@ -1579,15 +2791,86 @@ typename delegate_partitioned_graph<SegmentManager>::edge_iterator
 delegate_partitioned_graph<SegmentManager>::
 edges_end(delegate_partitioned_graph<SegmentManager>::vertex_locator
             locator) const {
+  std::pair<uint64_t, uint64_t> delta = delta_range(locator);
   if(locator.is_delegate()) {
     assert(locator.local_id()+1 < m_delegate_info.size());
+    if(delta.first != delta.second) {
+      return edge_iterator(locator, m_delegate_targets_size + delta.second, this);
+    }
     return edge_iterator(locator, m_delegate_info[locator.local_id() + 1], this);
   }
   assert(locator.owner() == m_mpi_rank);
   assert(locator.local_id()+1 < m_owned_info.size());
+  if(delta.first != delta.second) {
+    return edge_iterator(locator, m_owned_targets_size + delta.second, this);
+  }
   return edge_iterator(locator, m_owned_info[locator.local_id() + 1].low_csr_idx, this);
 }
 
+/**
+ * @param  locator Vertex locator
+ * @return Index range of the vertex's added edges in its delta vector
+ */
+template <typename SegmentManager>
+inline
+std::pair<uint64_t, uint64_t>
+delegate_partitioned_graph<SegmentManager>::
+delta_range(delegate_partitioned_graph<SegmentManager>::vertex_locator
+            locator) const {
+  const auto& delta = locator.is_delegate() ? m_delegate_delta : m_owned_delta;
+  if(delta.empty()) {
+    return std::make_pair(uint64_t(0), uint64_t(0));
+  }
+  const uint64_t id = locator.local_id();
+  auto first = std::lower_bound(delta.begin(), delta.end(), id,
+      [](const delta_edge& e, uint64_t id) { return e.first < id; });
+  auto last = std::upper_bound(first, delta.end(), id,
+      [](uint64_t id, const delta_edge& e) { return id < e.first; });
+  return std::make_pair(uint64_t(first - delta.begin()),
+                        uint64_t(last - delta.begin()));
+}
+
+/**
+ * @param  locator Vertex locator
+ * @return Pointer to the first sorted target
+ */
+template <typename SegmentManager>
+inline
+const typename delegate_partitioned_graph<SegmentManager>::vertex_locator*
+delegate_partitioned_graph<SegmentManager>::
+targets_begin(delegate_partitioned_graph<SegmentManager>::vertex_locator
+              locator) const {
+  assert(!m_targets_compressed);
+  if(locator.is_delegate()) {
+    assert(locator.local_id() < m_delegate_info.size()-1);
+    return m_delegate_targets.get() + m_delegate_info[locator.local_id()];
+  }
+  assert(locator.owner() == m_mpi_rank);
+  assert(locator.local_id() < m_owned_info.size());
+  return m_owned_targets.get() + m_owned_info[locator.local_id()].low_csr_idx;
+}
+
+/**
+ * @param  locator Vertex locator
+ * @return Pointer one past the last sorted target
+ */
+template <typename SegmentManager>
+inline
+const typename delegate_partitioned_graph<SegmentManager>::vertex_locator*
+delegate_partitioned_graph<SegmentManager>::
+targets_end(delegate_partitioned_graph<SegmentManager>::vertex_locator
+            locator) const {
+  assert(!m_targets_compressed);
+  if(locator.is_delegate()) {
+    assert(locator.local_id()+1 < m_delegate_info.size());
+    return m_delegate_targets.get() + m_delegate_info[locator.local_id() + 1];
+  }
+  assert(locator.owner() == m_mpi_rank);
+  assert(locator.local_id()+1 < m_owned_info.size());
+  return m_owned_targets.get() +
+         m_owned_info[locator.local_id() + 1].low_csr_idx;
+}
+
 /**
  * @param  locator Vertex locator
  * @return Vertex degree
@@ -1604,8 +2887,9 @@ degree(delegate_partitioned_graph<SegmentManager>::vertex_locator
     return m_delegate_degree[local_id];
   }
   assert(local_id + 1 < m_owned_info.size());
+  std::pair<uint64_t, uint64_t> delta = delta_range(locator);
   return m_owned_info[local_id+1].low_csr_idx -
-         m_owned_info[local_id].low_csr_idx;
+         m_owned_info[local_id].low_csr_idx + (delta.second - delta.first);
 }
 
 /**
@@ -1619,13 +2903,15 @@ delegate_partitioned_graph<SegmentManager>::
 local_degree(delegate_partitioned_graph<SegmentManager>::vertex_locator
               locator) const {
   uint64_t local_id = locator.local_id();
+  std::pair<uint64_t, uint64_t> delta = delta_range(locator);
   if(locator.is_delegate()) {
     assert(local_id + 1 < m_delegate_info.size());
-    return m_delegate_info[local_id + 1] - m_delegate_info[local_id];
+    return m_delegate_info[local_id + 1] - m_delegate_info[local_id]
+         + (delta.second - delta.first);
   }
   assert(local_id + 1 < m_owned_info.size());
   return m_owned_info[local_id+1].low_csr_idx -
-         m_owned_info[local_id].low_csr_idx;
+         m_owned_info[local_id].low_csr_idx + (delta.second - delta.first);
 }
 
 
@@ -1667,11 +2953,13 @@ create_edge_data(SegManagerOther* segment_manager_o,
 
   if (obj_name == nullptr) {
     return segment_manager_o->template construct<mytype>(bip::anonymous_instance)
-            (m_owned_targets_size, m_delegate_targets_size,
+            (m_owned_targets_size + m_owned_delta.size(),
+              m_delegate_targets_size + m_delegate_delta.size(),
               segment_manager_o);
   } else {
     return segment_manager_o->template construct<mytype>(obj_name)
-            (m_owned_targets_size, m_delegate_targets_size,
+            (m_owned_targets_size + m_owned_delta.size(),
+              m_delegate_targets_size + m_delegate_delta.size(),
               segment_manager_o);
   }
 }
@@ -1692,11 +2980,13 @@ create_edge_data(const T& init, SegManagerOther * segment_manager_o,
 
   if (obj_name == nullptr) {
     return segment_manager_o->template construct<mytype>(bip::anonymous_instance)
-            (m_owned_targets_size, m_delegate_targets_size, init,
+            (m_owned_targets_size + m_owned_delta.size(),
+              m_delegate_targets_size + m_delegate_delta.size(), init,
               segment_manager_o);
   } else {
     return segment_manager_o->template construct<mytype>(obj_name)
-            (m_owned_targets_size, m_delegate_targets_size, init,
+            (m_owned_targets_size + m_owned_delta.size(),
+              m_delegate_targets_size + m_delegate_delta.size(), init,
               segment_manager_o);
   }
 }
@@ -1738,11 +3028,16 @@ print_graph_statistics() {
     std::cout << "counting..(" << m_owned_targets_size << ")" << std::endl;
   }
   uint64_t local_count_del_target = 0;
-  for (uint64_t i = 0; i < m_owned_targets_size; ++i) {
-    if (m_owned_targets[i].is_delegate())
-      ++local_count_del_target;
-    if (m_mpi_rank == 0 && i % 10000000 == 0) {
-      std::cout <<  i << "..." << std::flush;
+  uint64_t edge_count = 0;
+  for (uint64_t i = 0; i + 1 < m_owned_info.size(); ++i) {
+    vertex_locator vertex(false, i, m_mpi_rank);
+    for (edge_iterator eitr = edges_begin(vertex); eitr != edges_end(vertex);
+         ++eitr, ++edge_count) {
+      if (eitr.target().is_delegate())
+        ++local_count_del_target;
+      if (m_mpi_rank == 0 && edge_count % 10000000 == 0) {
+        std::cout <<  edge_count << "..." << std::flush;
+      }
     }
   }
 
@@ -1753,6 +3048,12 @@ print_graph_statistics() {
   uint64_t total_count_del_target = mpi_all_reduce(local_count_del_target,
     std::plus<uint64_t>(), m_mpi_comm);
 
+  uint64_t local_target_bytes = m_targets_compressed
+      ? m_owned_target_stream.size() + m_delegate_target_stream.size()
+      : total_local_size * sizeof(vertex_locator);
+  uint64_t total_target_bytes = mpi_all_reduce(local_target_bytes,
+    std::plus<uint64_t>(), m_mpi_comm);
+
   if (m_mpi_rank == 0) {
     std::cout
       << "========================================================" << std::endl
@@ -1769,6 +3070,8 @@ print_graph_statistics() {
       << "\tGlobal number of edges = " << total_sum_size << std::endl
       << "\tNumber of small degree = " << low_sum_size << std::endl
       << "\tNumber of hubs = " << high_sum_size << std::endl
+      << "\tTarget bytes = " << total_target_bytes
+      << (m_targets_compressed ? " (compressed)" : "") << std::endl
       << "\toned imbalance = "
       << double(low_max_size) / double(low_sum_size/m_mpi_size) << std::endl
       << "\thubs imbalance = "
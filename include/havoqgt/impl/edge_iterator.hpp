@@ -62,7 +62,11 @@ template <typename SegementManager>
 class delegate_partitioned_graph<SegementManager>::edge_iterator {
  public:
   edge_iterator()
-    : m_ptr_graph(NULL) {};
+    : m_ptr_graph(NULL)
+    , m_stream_offset(0)
+    , m_prev_key(0)
+    , m_csr_end(0)
+    , m_delta_begin(0) {};
 
   edge_iterator& operator++();
   edge_iterator operator++(int);
@@ -82,11 +86,22 @@ class delegate_partitioned_graph<SegementManager>::edge_iterator {
   friend class delegate_partitioned_graph;
   template <typename T1, typename T2> friend class edge_data;
   edge_iterator(vertex_locator source, uint64_t edge_offset,
-                const delegate_partitioned_graph* const pgraph);
+                const delegate_partitioned_graph* const pgraph,
+                uint64_t stream_offset = 0, uint64_t csr_end = 0,
+                uint64_t delta_begin = 0);
+
+  const uint8_t* target_stream() const;
 
   vertex_locator                          m_source;
   uint64_t                                m_edge_offset;
   const delegate_partitioned_graph* const m_ptr_graph;
+  // Position in the compressed target stream and the previous target's key
+  uint64_t                                m_stream_offset;
+  uint64_t                                m_prev_key;
+  // End of the source's CSR edges, where iteration jumps to the first of
+  // its added edges (see delegate_partitioned_graph::add_edges)
+  uint64_t                                m_csr_end;
+  uint64_t                                m_delta_begin;
 };
 
 
@@ -105,16 +120,32 @@ inline
 delegate_partitioned_graph<SegmentManager>::edge_iterator::
 edge_iterator(vertex_locator source,
               uint64_t edge_offset,
-              const delegate_partitioned_graph* const pgraph)
+              const delegate_partitioned_graph* const pgraph,
+              uint64_t stream_offset,
+              uint64_t csr_end,
+              uint64_t delta_begin)
   : m_source(source)
   , m_edge_offset(edge_offset)
-  , m_ptr_graph(pgraph) { }
+  , m_ptr_graph(pgraph)
+  , m_stream_offset(stream_offset)
+  , m_prev_key(0)
+  , m_csr_end(csr_end)
+  , m_delta_begin(delta_begin) { }
 
 template <typename SegmentManager>
 inline
 typename delegate_partitioned_graph<SegmentManager>::edge_iterator&
 delegate_partitioned_graph<SegmentManager>::edge_iterator::operator++() {
+  if(m_ptr_graph->m_targets_compressed && m_edge_offset < m_csr_end) {
+    uint64_t gap;
+    const uint8_t* pos = target_stream() + m_stream_offset;
+    m_stream_offset += havoqgt::detail::varint_decode(pos, gap) - pos;
+    m_prev_key += gap;
+  }
   ++m_edge_offset;
+  if(m_edge_offset == m_csr_end) {
+    m_edge_offset = m_delta_begin;
+  }
   return *this;
 }
 
@@ -123,10 +154,21 @@ inline
 typename delegate_partitioned_graph<SegmentManager>::edge_iterator
 delegate_partitioned_graph<SegmentManager>::edge_iterator::operator++(int) {
   edge_iterator to_return = *this;
-  ++m_edge_offset;
+  ++(*this);
   return to_return;
 }
 
+template <typename SegmentManager>
+inline
+const uint8_t*
+delegate_partitioned_graph<SegmentManager>::edge_iterator::
+target_stream() const {
+  if(m_source.is_delegate()) {
+    return m_ptr_graph->m_delegate_target_stream.data();
+  }
+  return m_ptr_graph->m_owned_target_stream.data();
+}
+
 template <typename SegmentManager>
 inline bool
 delegate_partitioned_graph<SegmentManager>::edge_iterator::
@@ -155,6 +197,23 @@ template <typename SegmentManager>
 inline
 typename delegate_partitioned_graph<SegmentManager>::vertex_locator
 delegate_partitioned_graph<SegmentManager>::edge_iterator::target() const {
+  if(m_edge_offset >= m_csr_end) {
+    if(m_source.is_delegate()) {
+      assert(m_edge_offset - m_ptr_graph->m_delegate_targets_size <
+             m_ptr_graph->m_delegate_delta.size());
+      return m_ptr_graph->m_delegate_delta[
+          m_edge_offset - m_ptr_graph->m_delegate_targets_size].second;
+    }
+    assert(m_edge_offset - m_ptr_graph->m_owned_targets_size <
+           m_ptr_graph->m_owned_delta.size());
+    return m_ptr_graph->m_owned_delta[
+        m_edge_offset - m_ptr_graph->m_owned_targets_size].second;
+  }
+  if(m_ptr_graph->m_targets_compressed) {
+    uint64_t gap;
+    havoqgt::detail::varint_decode(target_stream() + m_stream_offset, gap);
+    return vertex_locator::from_sort_key(m_prev_key + gap);
+  }
   if(m_source.is_delegate()) {
     assert(m_edge_offset < m_ptr_graph->m_delegate_targets_size);
     assert(m_ptr_graph->m_delegate_targets[m_edge_offset].m_owner_dest <
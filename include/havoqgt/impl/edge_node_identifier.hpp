@@ -53,61 +53,148 @@
 #ifndef __HAVOQGT_IMP_EDGE_NODE_IDENTIFIER_HPP__
 #define __HAVOQGT_IMP_EDGE_NODE_IDENTIFIER_HPP__
 
+#include <algorithm>
+#include <utility>
+#include <stdint.h>
+
 namespace havoqgt {
 namespace mpi {
 
+/// Maps vertex labels to their owning rank and local id: label % p, or,
+/// given bounds, the contiguous label ranges [bounds[r], bounds[r+1]).
+/// Labels past the last bound belong to the last rank.
+class label_partition {
+ public:
+  explicit label_partition(int p, const uint64_t* bounds = nullptr)
+    : m_mpi_size(p), m_bounds(bounds) {}
+
+  int owner(uint64_t label) const {
+    if (m_bounds == nullptr) {
+      return label % m_mpi_size;
+    }
+    return std::upper_bound(m_bounds + 1, m_bounds + m_mpi_size, label)
+           - (m_bounds + 1);
+  }
+
+  uint64_t local_id(uint64_t label) const {
+    if (m_bounds == nullptr) {
+      return label / m_mpi_size;
+    }
+    return label - m_bounds[owner(label)];
+  }
+
+  /// Inverse of owner() and local_id()
+  uint64_t label(int owner, uint64_t local_id) const {
+    if (m_bounds == nullptr) {
+      return local_id * m_mpi_size + owner;
+    }
+    return m_bounds[owner] + local_id;
+  }
+
+  bool is_range() const { return m_bounds != nullptr; }
+
+ private:
+  uint64_t m_mpi_size;
+  const uint64_t* m_bounds;
+};
+
+/// Arranges p ranks as a rows() x cols() grid, rank r at row r / cols(),
+/// column r % cols(), with rows() the largest divisor of p <= sqrt(p).
+/// A vertex's master is label % p; it belongs to its master's row and
+/// column, and edge (u, v) is stored at row of u, column of v.
+class grid_partition {
+ public:
+  explicit grid_partition(int p) : m_mpi_size(p), m_rows(1) {
+    for (uint64_t r = 1; r * r <= m_mpi_size; ++r) {
+      if (m_mpi_size % r == 0) {
+        m_rows = r;
+      }
+    }
+    m_cols = m_mpi_size / m_rows;
+  }
+
+  uint64_t rows() const { return m_rows; }
+  uint64_t cols() const { return m_cols; }
+
+  int master(uint64_t label) const { return label % m_mpi_size; }
+  uint64_t row(uint64_t label) const { return master(label) / m_cols; }
+  uint64_t col(uint64_t label) const { return master(label) % m_cols; }
+
+  int edge_owner(uint64_t source, uint64_t target) const {
+    return row(source) * m_cols + col(target);
+  }
+
+  /// Index of a label among the labels of its row, and of its column
+  uint64_t row_slot(uint64_t label) const {
+    return (label / m_mpi_size) * m_cols + col(label);
+  }
+  uint64_t col_slot(uint64_t label) const {
+    return (label / m_mpi_size) * m_rows + row(label);
+  }
+
+  /// Inverse of row_slot() for the labels of row r
+  uint64_t row_label(uint64_t r, uint64_t slot) const {
+    return (slot / m_cols) * m_mpi_size + r * m_cols + slot % m_cols;
+  }
+
+ private:
+  uint64_t m_mpi_size;
+  uint64_t m_rows;
+  uint64_t m_cols;
+};
+
 class local_source_id {
  public:
-  explicit local_source_id(int p):m_mpi_size(p) {}
+  explicit local_source_id(const label_partition& p):m_partition(p) {}
   template<typename T>
-  T operator()(std::pair<T, T> i) const { return i.first / m_mpi_size; }
+  T operator()(std::pair<T, T> i) const { return m_partition.local_id(i.first); }
  private:
-  uint64_t m_mpi_size;
+  label_partition m_partition;
 };
 
 class local_dest_id {
  public:
-  explicit local_dest_id(int p):m_mpi_size(p) {}
+  explicit local_dest_id(const label_partition& p):m_partition(p) {}
   template<typename T>
-  T operator()(std::pair<T, T> i) const { return i.second / m_mpi_size; }
+  T operator()(std::pair<T, T> i) const { return m_partition.local_id(i.second); }
  private:
-  uint64_t m_mpi_size;
+  label_partition m_partition;
 };
 
 class get_local_id {
  public:
-  explicit get_local_id(int p):m_mpi_size(p) {}
+  explicit get_local_id(const label_partition& p):m_partition(p) {}
   template<typename T>
-  T operator()(T i) const { return i / m_mpi_size; }
+  T operator()(T i) const { return m_partition.local_id(i); }
  private:
-  uint64_t m_mpi_size;
+  label_partition m_partition;
 };
 
 class owner_source_id {
  public:
-  explicit owner_source_id(int p):m_mpi_size(p) {}
+  explicit owner_source_id(const label_partition& p):m_partition(p) {}
   template<typename T>
-  int operator()(std::pair<T, T> i) const { return i.first % m_mpi_size; }
+  int operator()(std::pair<T, T> i) const { return m_partition.owner(i.first); }
  private:
-  uint64_t m_mpi_size;
+  label_partition m_partition;
 };
 
 class owner_dest_id {
  public:
-  explicit owner_dest_id(int p):m_mpi_size(p) {}
+  explicit owner_dest_id(const label_partition& p):m_partition(p) {}
   template<typename T>
-  int operator()(std::pair<T, T> i) const { return i.second % m_mpi_size; }
+  int operator()(std::pair<T, T> i) const { return m_partition.owner(i.second); }
  private:
-  uint64_t m_mpi_size;
+  label_partition m_partition;
 };
 
 class get_owner_id {
  public:
-  explicit get_owner_id(int p):m_mpi_size(p) {}
+  explicit get_owner_id(const label_partition& p):m_partition(p) {}
   template<typename T>
-  int operator()(T i) const { return i % m_mpi_size; }
+  int operator()(T i) const { return m_partition.owner(i); }
  private:
-  uint64_t m_mpi_size;
+  label_partition m_partition;
 };
 
 }  // namespace mpi
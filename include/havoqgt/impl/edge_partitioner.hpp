@@ -55,9 +55,21 @@
 #include <map>
 #include <deque>
 
+#include <havoqgt/impl/edge_node_identifier.hpp>
+
 namespace havoqgt {
 namespace mpi {
 
+/// An edge with its weight.  It converts to the plain edge pair, so the
+/// partitioners below route weighted edges exactly like unweighted ones.
+struct weighted_edge : public std::pair<uint64_t, uint64_t> {
+  weighted_edge() : weight(1) {}
+  weighted_edge(const std::pair<uint64_t, uint64_t>& edge, uint64_t w)
+    : std::pair<uint64_t, uint64_t>(edge), weight(w) {}
+
+  uint64_t weight;
+};
+
 /**
  * @class delegate_partitioned_graph
  * @details Put details here for class
@@ -65,33 +77,44 @@ namespace mpi {
 
 class source_partitioner {
  public:
-  explicit source_partitioner(int p):m_mpi_size(p) { }
-  int operator()(uint64_t i) const { return i % m_mpi_size; }
+  explicit source_partitioner(const label_partition& p):m_partition(p) { }
+  int operator()(uint64_t i) const { return m_partition.owner(i); }
 
  private:
-  int m_mpi_size;
+  label_partition m_partition;
 };
 
 class edge_source_partitioner {
  public:
-  explicit edge_source_partitioner(int p):m_mpi_size(p) { }
+  explicit edge_source_partitioner(const label_partition& p):m_partition(p) { }
   int operator()(std::pair<uint64_t, uint64_t> i, bool is_counting) const {
-    return i.first % m_mpi_size;
+    return m_partition.owner(i.first);
   }
 
  private:
-  int m_mpi_size;
+  label_partition m_partition;
 };
 
 class edge_target_partitioner {
  public:
-  explicit edge_target_partitioner(int p):m_mpi_size(p) { }
+  explicit edge_target_partitioner(const label_partition& p):m_partition(p) { }
   int operator()(std::pair<uint64_t, uint64_t> i) const {
-    return i.second % m_mpi_size;
+    return m_partition.owner(i.second);
+  }
+
+ private:
+  label_partition m_partition;
+};
+
+class grid_edge_partitioner {
+ public:
+  explicit grid_edge_partitioner(const grid_partition& g):m_grid(g) { }
+  int operator()(std::pair<uint64_t, uint64_t> i, bool is_counting) const {
+    return m_grid.edge_owner(i.first, i.second);
   }
 
  private:
-  int m_mpi_size;
+  grid_partition m_grid;
 };
 
 /**
@@ -118,9 +141,9 @@ class edge_target_partitioner {
 
 class high_edge_partitioner {
  public:
-  explicit high_edge_partitioner(int s, int r,
+  explicit high_edge_partitioner(const label_partition& p, int r,
     std::map<uint64_t, std::deque<OverflowSendInfo>> *transfer_info)
-    : m_mpi_size(s)
+    : m_partition(p)
     , m_mpi_rank(r)
     , m_transfer_info(transfer_info)
     /*, m_dof(dof)*/ { }
@@ -136,7 +159,7 @@ class high_edge_partitioner {
   int operator()(std::pair<uint64_t, uint64_t> i, bool is_counting = true) {
 
 
-    int dest = int(i.second % m_mpi_size);
+    int dest = m_partition.owner(i.second);
     if (dest == m_mpi_rank) {
       // If the current node is the destination, then determine the destination
       // by examing the transfer_info object
@@ -193,7 +216,7 @@ class high_edge_partitioner {
   }  // operator()
 
  private:
-  const int m_mpi_size;
+  const label_partition m_partition;
   const int m_mpi_rank;
   std::map<uint64_t, std::deque<OverflowSendInfo>> * m_transfer_info;
 };  // class high_edge_partitioner
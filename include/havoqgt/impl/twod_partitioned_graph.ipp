@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Roger Pearce <rpearce@llnl.gov>.
+ * LLNL-CODE-644630.
+ * All rights reserved.
+ *
+ * This file is part of HavoqGT, Version 0.1.
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ *
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ *
+ * Our Preamble Notice
+ *
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ *
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ *
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ *
+ * \file
+ * Implementation of twod_partitioned_graph and internal classes.
+ */
+
+#ifndef HAVOQGT_MPI_IMPL_TWOD_PARTITIONED_GRAPH_IPP_INCLUDED
+#define HAVOQGT_MPI_IMPL_TWOD_PARTITIONED_GRAPH_IPP_INCLUDED
+
+#include <algorithm>
+#include <numeric>
+
+namespace havoqgt {
+namespace mpi {
+
+////////////////////////////////////////////////////////////////////////////////
+//                               Vertex Locator                               //
+////////////////////////////////////////////////////////////////////////////////
+/**
+ * Same layout and interface as delegate_partitioned_graph::vertex_locator,
+ * so visitors and the mailbox codecs work on either graph.  Every valid
+ * locator is a delegate; local_id() is the label and owner() the master,
+ * until the mailbox overwrites it with a destination.
+ */
+template <typename SegementManager>
+class twod_partitioned_graph<SegementManager>::vertex_locator {
+ public:
+  vertex_locator() {
+    m_is_delegate  = 0;
+    m_is_bcast     = 0;
+    m_is_intercept = 0;
+    m_owner_dest   = std::numeric_limits<uint32_t>::max();
+    m_local_id     = std::numeric_limits<uint64_t>::max();
+  }
+
+  bool is_valid() const { return m_is_delegate == 1; }
+
+  bool is_delegate() const { return m_is_delegate == 1;}
+  uint32_t owner() const { return m_owner_dest; }
+  void set_dest(uint32_t dest) { m_owner_dest = dest; assert(m_owner_dest == dest);}
+  uint64_t local_id() const { return m_local_id;}
+  uint32_t get_bcast() const { return m_is_bcast ; }
+  void set_bcast(uint32_t bcast) { m_is_bcast = bcast; }
+  bool is_intercept() const { return m_is_intercept == 1;}
+  void set_intercept(bool intercept) { m_is_intercept = intercept; }
+
+  /// Delegate, bcast and intercept bits, for compact message encodings.
+  uint32_t flags() const {
+    return m_is_delegate | (m_is_bcast << 1) | (m_is_intercept << 2);
+  }
+  /// Inverse of flags(), owner() and local_id().
+  static vertex_locator from_parts(uint32_t flags, uint32_t owner_dest,
+                                   uint64_t local_id) {
+    vertex_locator to_return(local_id, owner_dest);
+    to_return.m_is_delegate  = flags & 1;
+    to_return.m_is_bcast     = (flags >> 1) & 1;
+    to_return.m_is_intercept = (flags >> 2) & 1;
+    return to_return;
+  }
+
+  friend bool operator==(const vertex_locator& x, const vertex_locator& y) {
+    return x.m_is_delegate  == y.m_is_delegate
+        && x.m_is_bcast     == y.m_is_bcast
+        && x.m_is_intercept == y.m_is_intercept
+        && x.m_owner_dest   == y.m_owner_dest
+        && x.m_local_id     == y.m_local_id;
+  }
+
+  friend bool operator!=(const vertex_locator& x, const vertex_locator& y) {
+    return !(x == y);
+  }
+
+  friend bool operator<(const vertex_locator& x, const vertex_locator& y) {
+    if (x.m_is_delegate != y.m_is_delegate) {
+      return x.m_is_delegate < y.m_is_delegate;
+    }
+    if (x.m_owner_dest != y.m_owner_dest) {
+      return x.m_owner_dest < y.m_owner_dest;
+    }
+    return x.m_local_id < y.m_local_id;
+  }
+
+ private:
+  friend class twod_partitioned_graph;
+  vertex_locator(uint64_t label, uint32_t master) {
+    m_is_delegate  = 1;
+    m_is_bcast     = 0;
+    m_is_intercept = 0;
+    m_owner_dest   = master;
+    m_local_id     = label;
+    if (m_local_id != label || m_owner_dest != master) {
+      std::cerr << "ERROR:  vertex_locator()" << std::endl; exit(-1);
+    }
+  }
+
+  unsigned int m_is_delegate  : 1;
+  unsigned int m_is_bcast     : 1;
+  unsigned int m_is_intercept : 1;
+  unsigned int m_owner_dest   : 20;
+  uint64_t     m_local_id     : 39;
+} __attribute__ ((packed));
+
+////////////////////////////////////////////////////////////////////////////////
+//                               Edge Iterator                                //
+////////////////////////////////////////////////////////////////////////////////
+template <typename SegementManager>
+class twod_partitioned_graph<SegementManager>::edge_iterator {
+ public:
+  edge_iterator() : m_edge_offset(0), m_ptr_graph(NULL) {}
+
+  edge_iterator& operator++() { ++m_edge_offset; return *this; }
+  edge_iterator operator++(int) {
+    edge_iterator to_return = *this;
+    ++m_edge_offset;
+    return to_return;
+  }
+
+  friend bool operator==(const edge_iterator& x, const edge_iterator& y) {
+    assert(x.m_ptr_graph == y.m_ptr_graph);
+    return x.m_edge_offset == y.m_edge_offset;
+  }
+
+  friend bool operator!=(const edge_iterator& x, const edge_iterator& y) {
+    return !(x == y);
+  }
+
+  vertex_locator source() const { return m_source; }
+  vertex_locator target() const {
+    return m_ptr_graph->m_targets[m_edge_offset];
+  }
+
+ private:
+  friend class twod_partitioned_graph;
+  edge_iterator(vertex_locator source, uint64_t edge_offset,
+                const twod_partitioned_graph* pgraph)
+    : m_source(source), m_edge_offset(edge_offset), m_ptr_graph(pgraph) {}
+
+  vertex_locator                m_source;
+  uint64_t                      m_edge_offset;
+  const twod_partitioned_graph* m_ptr_graph;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//                                Vertex Data                                 //
+////////////////////////////////////////////////////////////////////////////////
+/**
+ * One value per label of the rank's grid row, indexed by row_slot(), and per
+ * label of its grid column, indexed by col_slot().  The master's value is
+ * the row copy.
+ */
+template <typename SegementManager>
+template <typename T, typename Allocator>
+class twod_partitioned_graph<SegementManager>::vertex_data {
+ public:
+  typedef T value_type;
+
+  vertex_data(const twod_partitioned_graph& g,
+              Allocator allocate = Allocator())
+    : m_grid(g.grid())
+    , m_row(g.m_mpi_rank / m_grid.cols())
+    , m_col(g.m_mpi_rank % m_grid.cols())
+    , m_row_data(allocate)
+    , m_col_data(allocate) {
+    const uint64_t labels_per_rank = g.m_row_degree.size() / m_grid.cols();
+    m_row_data.resize(labels_per_rank * m_grid.cols());
+    m_col_data.resize(labels_per_rank * m_grid.rows());
+  }
+
+  T& operator[](const vertex_locator& locator) {
+    const uint64_t label = locator.local_id();
+    if (m_grid.row(label) == m_row) {
+      assert(m_grid.row_slot(label) < m_row_data.size());
+      return m_row_data[m_grid.row_slot(label)];
+    }
+    assert(m_grid.col(label) == m_col);
+    assert(m_grid.col_slot(label) < m_col_data.size());
+    return m_col_data[m_grid.col_slot(label)];
+  }
+
+  const T& operator[](const vertex_locator& locator) const {
+    return const_cast<vertex_data&>(*this)[locator];
+  }
+
+  void reset(const T& r) {
+    std::fill(m_row_data.begin(), m_row_data.end(), r);
+    std::fill(m_col_data.begin(), m_col_data.end(), r);
+  }
+
+  /// Sum over the vertices this rank is master of
+  T local_accumulate() const {
+    T to_return = T();
+    for (uint64_t slot = m_col; slot < m_row_data.size();
+         slot += m_grid.cols()) {
+      to_return += m_row_data[slot];
+    }
+    return to_return;
+  }
+
+  T global_accumulate() const {
+    T local = local_accumulate();
+    return mpi_all_reduce(local, std::plus<T>(), MPI_COMM_WORLD);
+  }
+
+ private:
+  grid_partition m_grid;
+  uint64_t m_row;
+  uint64_t m_col;
+  bip::vector<T, Allocator > m_row_data;
+  bip::vector<T, Allocator > m_col_data;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//                         twod_partitioned_graph                             //
+////////////////////////////////////////////////////////////////////////////////
+/**
+ * Builds a twod_partitioned_graph from an unsorted sequence of edges: every
+ * edge is sent to the grid rank of its source's row and target's column,
+ * the received edges become a CSR by source, and the global degrees are
+ * summed over each grid row's communicator.
+ *
+ * @param seg_allocator Allocator of the graph's segment
+ * @param mpi_comm      MPI communicator
+ * @param edges         input edges to partition
+ * @param max_vertex    largest label
+ */
+template <typename SegmentManager>
+template <typename Container>
+twod_partitioned_graph<SegmentManager>::
+twod_partitioned_graph(const SegmentAllocator<void>& seg_allocator,
+                       MPI_Comm mpi_comm, Container& edges,
+                       uint64_t max_vertex)
+    : m_global_max_vertex(max_vertex),
+      m_row_offsets(seg_allocator),
+      m_targets(seg_allocator),
+      m_row_degree(seg_allocator),
+      m_controller_locators(seg_allocator) {
+  CHK_MPI( MPI_Comm_size(mpi_comm, &m_mpi_size) );
+  CHK_MPI( MPI_Comm_rank(mpi_comm, &m_mpi_rank) );
+
+  const grid_partition g = grid();
+  const uint64_t my_row = m_mpi_rank / g.cols();
+  const uint64_t labels_per_rank = max_vertex / m_mpi_size + 1;
+  const uint64_t row_slots = labels_per_rank * g.cols();
+
+  LogStep logstep_main("2D Partitioning", mpi_comm, m_mpi_rank);
+  if (m_mpi_rank == 0) {
+    std::cout << "\tGrid: " << g.rows() << " x " << g.cols() << " ranks."
+              << std::endl;
+  }
+
+  std::vector<std::pair<uint64_t, uint64_t> > local_edges;
+  {
+    LogStep logstep("partition_edges", mpi_comm, m_mpi_rank);
+    partition_edges(mpi_comm, edges, local_edges);
+  }
+
+  {
+    LogStep logstep("build_csr", mpi_comm, m_mpi_rank);
+    std::sort(local_edges.begin(), local_edges.end(),
+        [&g](const std::pair<uint64_t, uint64_t>& a,
+             const std::pair<uint64_t, uint64_t>& b) {
+          const uint64_t slot_a = g.row_slot(a.first);
+          const uint64_t slot_b = g.row_slot(b.first);
+          return slot_a < slot_b || (slot_a == slot_b && a.second < b.second);
+        });
+    m_row_offsets.resize(row_slots + 1, 0);
+    for (size_t i = 0; i < local_edges.size(); ++i) {
+      ++m_row_offsets[g.row_slot(local_edges[i].first) + 1];
+    }
+    std::partial_sum(m_row_offsets.begin(), m_row_offsets.end(),
+                     m_row_offsets.begin());
+    m_targets.reserve(local_edges.size());
+    for (size_t i = 0; i < local_edges.size(); ++i) {
+      m_targets.push_back(label_to_locator(local_edges[i].second));
+    }
+  }
+
+  {
+    LogStep logstep("count_row_degrees", mpi_comm, m_mpi_rank);
+    m_row_degree.resize(row_slots);
+    for (uint64_t slot = 0; slot < row_slots; ++slot) {
+      m_row_degree[slot] = m_row_offsets[slot + 1] - m_row_offsets[slot];
+    }
+    MPI_Comm row_comm;
+    CHK_MPI( MPI_Comm_split(mpi_comm, my_row, m_mpi_rank, &row_comm) );
+    mpi_all_reduce_inplace(m_row_degree, std::plus<uint64_t>(), row_comm);
+    CHK_MPI( MPI_Comm_free(&row_comm) );
+  }
+
+  for (uint64_t label = m_mpi_rank; label <= max_vertex; label += m_mpi_size) {
+    m_controller_locators.push_back(label_to_locator(label));
+  }
+
+  const uint64_t local_count = m_targets.size();
+  const uint64_t max_edges = mpi_all_reduce(local_count,
+      std::greater<uint64_t>(), mpi_comm);
+  const uint64_t sum_edges = mpi_all_reduce(local_count,
+      std::plus<uint64_t>(), mpi_comm);
+  if (m_mpi_rank == 0) {
+    std::cout << "\tEdges per rank: max " << max_edges << ", mean "
+              << sum_edges / m_mpi_size << ", imbalance "
+              << double(max_edges) * m_mpi_size / std::max(sum_edges,
+                                                           uint64_t(1))
+              << "; peers per rank: " << g.rows() + g.cols() - 2
+              << std::endl;
+  }
+}
+
+/**
+ * Exchanges the edges in chunks, each sent to its grid rank, and appends the
+ * received ones to local_edges.
+ */
+template <typename SegmentManager>
+template <typename Container>
+void
+twod_partitioned_graph<SegmentManager>::
+partition_edges(MPI_Comm mpi_comm, Container& edges,
+                std::vector<std::pair<uint64_t, uint64_t> >& local_edges) {
+  const size_t edge_chunk_size = 1024*8;
+  grid_edge_partitioner paritioner(grid());
+  auto itr = edges.begin();
+  auto itr_end = edges.end();
+  while (!detail::global_iterator_range_empty(itr, itr_end, mpi_comm)) {
+    std::vector<std::pair<uint64_t, uint64_t> > to_send_edges;
+    std::vector<std::pair<uint64_t, uint64_t> > to_recv_edges;
+    to_send_edges.reserve(edge_chunk_size);
+    for (size_t i = 0; itr != itr_end && i < edge_chunk_size; ++itr, ++i) {
+      to_send_edges.push_back(*itr);
+    }
+    mpi_all_to_all_better(to_send_edges, to_recv_edges, paritioner, mpi_comm);
+    local_edges.insert(local_edges.end(), to_recv_edges.begin(),
+                       to_recv_edges.end());
+  }
+}
+
+template <typename SegmentManager>
+inline uint64_t
+twod_partitioned_graph<SegmentManager>::
+locator_to_label(vertex_locator locator) const {
+  return locator.m_local_id;
+}
+
+template <typename SegmentManager>
+inline typename twod_partitioned_graph<SegmentManager>::vertex_locator
+twod_partitioned_graph<SegmentManager>::
+label_to_locator(uint64_t label) const {
+  return vertex_locator(label, label % m_mpi_size);
+}
+
+template <typename SegmentManager>
+inline typename twod_partitioned_graph<SegmentManager>::edge_iterator
+twod_partitioned_graph<SegmentManager>::
+edges_begin(vertex_locator locator) const {
+  const grid_partition g = grid();
+  assert(g.row(locator.m_local_id) == uint64_t(m_mpi_rank) / g.cols());
+  return edge_iterator(locator,
+                       m_row_offsets[g.row_slot(locator.m_local_id)], this);
+}
+
+template <typename SegmentManager>
+inline typename twod_partitioned_graph<SegmentManager>::edge_iterator
+twod_partitioned_graph<SegmentManager>::
+edges_end(vertex_locator locator) const {
+  const grid_partition g = grid();
+  assert(g.row(locator.m_local_id) == uint64_t(m_mpi_rank) / g.cols());
+  return edge_iterator(locator,
+                       m_row_offsets[g.row_slot(locator.m_local_id) + 1], this);
+}
+
+template <typename SegmentManager>
+inline uint64_t
+twod_partitioned_graph<SegmentManager>::
+degree(vertex_locator locator) const {
+  const grid_partition g = grid();
+  assert(g.row(locator.m_local_id) == uint64_t(m_mpi_rank) / g.cols());
+  return m_row_degree[g.row_slot(locator.m_local_id)];
+}
+
+template <typename SegmentManager>
+inline uint64_t
+twod_partitioned_graph<SegmentManager>::
+local_degree(vertex_locator locator) const {
+  const uint64_t slot = grid().row_slot(locator.m_local_id);
+  return m_row_offsets[slot + 1] - m_row_offsets[slot];
+}
+
+} // namespace mpi
+} // namespace havoqgt
+
+#endif //HAVOQGT_MPI_IMPL_TWOD_PARTITIONED_GRAPH_IPP_INCLUDED
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * LLNL-CODE-644630.
+ * All rights reserved.
+ *
+ * This file is part of HavoqGT, Version 0.1.
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ *
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ *
+ * Our Preamble Notice
+ *
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ *
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ *
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ *
+ */
+
+
+#ifndef HAVOQGT_MPI_IMPL_VERTEX_BITMAP_HPP_
+#define HAVOQGT_MPI_IMPL_VERTEX_BITMAP_HPP_
+
+#include <havoqgt/delegate_partitioned_graph.hpp>
+
+namespace havoqgt {
+namespace mpi {
+
+/**
+ * One bit per vertex, laid out like vertex_data: owned vertices are indexed
+ * by local_id and delegates by delegate id.
+ *
+ * all_gather() makes a read-only copy of every rank's owned bits so that
+ * test_global() can answer for vertices owned by other ranks; this is what a
+ * bottom-up BFS step needs to probe the frontier.  Delegate bits are kept
+ * consistent with all_reduce_delegates().
+ */
+template <typename SegementManager>
+class delegate_partitioned_graph<SegementManager>::vertex_bitmap {
+ public:
+  vertex_bitmap(const delegate_partitioned_graph& dpg)
+    : m_ptr_graph(&dpg)
+    , m_owned_bits(num_words(dpg.m_owned_info.size()), 0)
+    , m_delegate_bits(num_words(dpg.m_delegate_info.size()), 0) { }
+
+  bool test(const vertex_locator& locator) const {
+    if(locator.is_delegate()) {
+      return get_bit(m_delegate_bits, locator.local_id());
+    }
+    assert(locator.owner() == uint32_t(m_ptr_graph->m_mpi_rank));
+    return get_bit(m_owned_bits, locator.local_id());
+  }
+
+  /// Tests any vertex, using the owned bits from the last all_gather().
+  bool test_global(const vertex_locator& locator) const {
+    if(locator.is_delegate()) {
+      return get_bit(m_delegate_bits, locator.local_id());
+    }
+    assert(locator.owner() + 1 < m_global_offsets.size());
+    const uint64_t offset = m_global_offsets[locator.owner()];
+    assert(offset + (locator.local_id() >> 6)
+             < m_global_offsets[locator.owner() + 1]);
+    return (m_global_owned_bits[offset + (locator.local_id() >> 6)]
+              >> (locator.local_id() & 63)) & 1;
+  }
+
+  void set(const vertex_locator& locator) {
+    if(locator.is_delegate()) {
+      set_bit(m_delegate_bits, locator.local_id());
+    } else {
+      assert(locator.owner() == uint32_t(m_ptr_graph->m_mpi_rank));
+      set_bit(m_owned_bits, locator.local_id());
+    }
+  }
+
+  void reset() {
+    std::fill(m_owned_bits.begin(), m_owned_bits.end(), 0);
+    std::fill(m_delegate_bits.begin(), m_delegate_bits.end(), 0);
+  }
+
+  /// Gathers the owned bits of all ranks.  Ranks may own different numbers
+  /// of vertices (range ownership), so each rank's words start at the
+  /// prefix sum of the word counts before it.
+  void all_gather() {
+    if(m_global_offsets.empty()) {
+      std::vector<uint64_t> counts;
+      mpi_all_gather(uint64_t(m_owned_bits.size()), counts, MPI_COMM_WORLD);
+      m_global_offsets.assign(counts.size() + 1, 0);
+      for(size_t i=0; i<counts.size(); ++i) {
+        m_global_offsets[i+1] = m_global_offsets[i] + counts[i];
+      }
+    }
+    mpi_all_gather(m_owned_bits, m_global_owned_bits,
+                   MPI_COMM_WORLD);
+  }
+
+  /// Bitwise-or of the delegate bits across all ranks.
+  void all_reduce_delegates() {
+    if(m_delegate_bits.size() > 0) {
+      mpi_all_reduce_inplace(m_delegate_bits, std::bit_or<uint64_t>(),
+                             MPI_COMM_WORLD);
+    }
+  }
+
+  uint64_t owned_count() const { return popcount(m_owned_bits); }
+  uint64_t delegate_count() const { return popcount(m_delegate_bits); }
+
+ private:
+  static size_t num_words(size_t bits) { return (bits + 63) / 64; }
+
+  static bool get_bit(const std::vector<uint64_t>& words, uint64_t i) {
+    assert((i >> 6) < words.size());
+    return (words[i >> 6] >> (i & 63)) & 1;
+  }
+
+  static void set_bit(std::vector<uint64_t>& words, uint64_t i) {
+    assert((i >> 6) < words.size());
+    words[i >> 6] |= uint64_t(1) << (i & 63);
+  }
+
+  static uint64_t popcount(const std::vector<uint64_t>& words) {
+    uint64_t count = 0;
+    for(size_t i=0; i<words.size(); ++i) {
+      count += __builtin_popcountll(words[i]);
+    }
+    return count;
+  }
+
+  const delegate_partitioned_graph* m_ptr_graph;
+  std::vector<uint64_t> m_owned_bits;
+  std::vector<uint64_t> m_delegate_bits;
+  std::vector<uint64_t> m_global_owned_bits;
+  std::vector<uint64_t> m_global_offsets;
+};
+
+}  // mpi
+}  // namespace havoqgt
+#endif  // HAVOQGT_MPI_IMPL_VERTEX_BITMAP_HPP_
@@ -88,6 +88,30 @@ class delegate_partitioned_graph<SegementManager>::vertex_locator {
   bool is_intercept() const { return m_is_intercept == 1;}
   void set_intercept(bool intercept) { m_is_intercept = intercept; }
 
+  /// Delegate, bcast and intercept bits, for compact message encodings.
+  uint32_t flags() const {
+    return m_is_delegate | (m_is_bcast << 1) | (m_is_intercept << 2);
+  }
+  /// Inverse of flags(), owner() and local_id().
+  static vertex_locator from_parts(uint32_t flags, uint32_t owner_dest,
+                                   uint64_t local_id) {
+    vertex_locator to_return(flags & 1, local_id, owner_dest);
+    to_return.m_is_bcast     = (flags >> 1) & 1;
+    to_return.m_is_intercept = (flags >> 2) & 1;
+    return to_return;
+  }
+
+  /// Integer with the same order as operator<, for gap-encoded adjacency.
+  uint64_t sort_key() const {
+    return (uint64_t(m_is_delegate) << 59) | (uint64_t(m_owner_dest) << 39)
+           | m_local_id;
+  }
+  /// Inverse of sort_key()
+  static vertex_locator from_sort_key(uint64_t key) {
+    return vertex_locator((key >> 59) & 1, key & ((uint64_t(1) << 39) - 1),
+                          uint32_t(key >> 39) & 0xFFFFF);
+  }
+
   friend bool operator==(const vertex_locator& x,
                          const vertex_locator& y) {return x.is_equal(y); }
   friend bool operator<(const vertex_locator& x,
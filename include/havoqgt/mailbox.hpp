@@ -54,6 +54,8 @@
 
 #include <havoqgt/mpi.hpp>
 #include <havoqgt/environment.hpp>
+#include <havoqgt/detail/message_codec.hpp>
+#include <havoqgt/detail/shm_ring_transport.hpp>
 #include <vector>
 #include <list>
 #include <limits>
@@ -86,6 +88,10 @@ class mailbox_routed {
   // };
 
   typedef TMsg routed_msg_type;
+  typedef havoqgt::detail::locator_message_codec<TMsg> codec_type;
+
+  /// First byte of a buffer when compression is enabled
+  enum wire_format { WIRE_RAW = 0, WIRE_VARINT = 1, WIRE_LZ = 2 };
 
   class twod_router{
   public:
@@ -175,6 +181,14 @@ public:
 
     m_receiving = false;
 
+    m_compression = get_environment().mailbox_compression();
+    m_raw_bytes   = 0;
+    m_wire_bytes  = 0;
+    if(m_compression > 0) {
+      size_t aggregation = get_environment().mailbox_aggregation();
+      m_decoded.resize(aggregation);
+      m_codec_scratch.resize(codec_type::max_encoded_size(aggregation));
+    }
 
     CHK_MPI(MPI_Comm_rank(m_mpi_comm, &m_mpi_rank) );
     CHK_MPI(MPI_Comm_size(m_mpi_comm, &m_mpi_size) );
@@ -188,8 +202,7 @@ public:
 
     for(size_t i=0; i<get_environment().mailbox_num_irecv(); ++i) {
       void* irecv_buff = NULL;
-      int ret = posix_memalign(&irecv_buff, 32,
-                     get_environment().mailbox_aggregation() * sizeof(routed_msg_type));
+      int ret = posix_memalign(&irecv_buff, 32, buffer_bytes());
       if(ret !=0) {
         perror("posix_memalign-irecv"); exit(-1);
       }
@@ -197,6 +210,19 @@ public:
     }
     m_2d_comm = twod_router(m_mpi_rank, m_mpi_size);
 
+    // Node-local buffers bypass MPI when the ranks of m_mpi_comm are those
+    // of the environment's world communicator.
+    m_shm_send_counter = 0;
+    if(get_environment().mailbox_shm() && havoqgt_env() != NULL) {
+      int compare;
+      CHK_MPI( MPI_Comm_compare(m_mpi_comm, havoqgt_env()->world_comm().comm(),
+                                &compare) );
+      if(compare == MPI_IDENT || compare == MPI_CONGRUENT) {
+        m_shm.init(m_mpi_comm, havoqgt_env()->node_local_comm().comm(),
+                   buffer_bytes(), get_environment().mailbox_shm_slots());
+      }
+    }
+
     m_tree_parent = m_mpi_rank / 2;
     m_tree_child1 = (m_mpi_rank * 2) + 1;
     m_tree_child2 = (m_mpi_rank * 2) + 2;
@@ -222,15 +248,22 @@ public:
       uint64_t g_route_counter     = mpi_all_reduce(m_route_counter, std::plus<uint64_t>(), MPI_COMM_WORLD);
       uint64_t g_send_counter      = mpi_all_reduce(m_send_counter, std::plus<uint64_t>(), MPI_COMM_WORLD);
       uint64_t g_recv_counter      = mpi_all_reduce(m_recv_counter, std::plus<uint64_t>(), MPI_COMM_WORLD);
+      uint64_t g_shm_send_counter  = mpi_all_reduce(m_shm_send_counter, std::plus<uint64_t>(), MPI_COMM_WORLD);
+      uint64_t g_raw_bytes         = mpi_all_reduce(m_raw_bytes, std::plus<uint64_t>(), MPI_COMM_WORLD);
+      uint64_t g_wire_bytes        = mpi_all_reduce(m_wire_bytes, std::plus<uint64_t>(), MPI_COMM_WORLD);
       if(m_mpi_rank == 0) {
         std::cout << "******************  Mailbox Statistics ********************" << std::endl;
         std::cout << "routed message size = " << sizeof(TMsg) << std::endl;
         std::cout << "mpi_send_counter  = " << g_mpi_send_counter  << std::endl;
+        std::cout << "shm_send_counter  = " << g_shm_send_counter  << std::endl;
         std::cout << "tree_send_counter = " << g_tree_send_counter << std::endl;
         std::cout << "route_counter     = " << g_route_counter     << std::endl;
         std::cout << "send_counter      = " << g_send_counter      << std::endl;
         std::cout << "recv_counter      = " << g_recv_counter      << std::endl;
         std::cout << "Average send size = " << double(g_send_counter + g_route_counter) / double(g_mpi_send_counter) << std::endl;
+        std::cout << "raw bytes         = " << g_raw_bytes << std::endl;
+        std::cout << "wire bytes        = " << g_wire_bytes << std::endl;
+        std::cout << "Compression ratio = " << double(g_raw_bytes) / double(g_wire_bytes) << std::endl;
         std::cout << "***********************************************************" << std::endl;
       }
     }
@@ -373,34 +406,56 @@ public:
         MPI_Status status;
         CHK_MPI( MPI_Test( request_ptr, &flag, &status) );
         if(flag) {
-          routed_msg_type* recv_ptr = static_cast<routed_msg_type*> (
-                           pair_req.second );
           int count(0);
           CHK_MPI( MPI_Get_count(&status, MPI_BYTE, &count) );
-          for(size_t i=0; i<count/sizeof(routed_msg_type); ++i) {
-            if(recv_ptr[i].dest() == uint32_t(m_mpi_rank) /*|| recv_ptr[i].is_tree_op()*/) {
-              *_oitr = recv_ptr[i];//.msg;
-              ++_oitr;
-              ++m_recv_counter;
-            } else if(recv_ptr[i].get_bcast()) {
-              bcast_to_targets(recv_ptr[i]);
-            } else if(recv_ptr[i].is_intercept()) {
-              if( _oitr.intercept(recv_ptr[i]) ) {
-                route_fast_path(recv_ptr[i].dest(), recv_ptr[i]);
-              }
-            } else {
-              route_fast_path(recv_ptr[i].dest(), recv_ptr[i]);
-            }
-          }
-          post_new_irecv(recv_ptr);
+          handle_received_buffer(pair_req.second, count, _oitr);
+          post_new_irecv(pair_req.second);
         } else {
           m_list_irecv_request.push_front(pair_req);
         }
       }
     //} while(flag);
+    if(m_shm.enabled()) {
+      size_t bytes;
+      const void* shm_buffer = m_shm.peek(bytes);
+      if(shm_buffer != NULL) {
+        handle_received_buffer(shm_buffer, bytes, _oitr);
+        m_shm.release();
+      }
+    }
     m_receiving = false;
   }
 
+  /// Delivers or forwards every message of a received buffer.
+  template <typename OutputIterator>
+  void handle_received_buffer(const void* buffer, size_t bytes,
+                              OutputIterator& _oitr) {
+    const routed_msg_type* recv_ptr =
+        static_cast<const routed_msg_type*>(buffer);
+    size_t num_msgs = bytes/sizeof(routed_msg_type);
+    if(m_compression > 0) {
+      num_msgs = decode_buffer(static_cast<const uint8_t*>(buffer), bytes);
+      recv_ptr = &(m_decoded[0]);
+    }
+    for(size_t i=0; i<num_msgs; ++i) {
+      if(recv_ptr[i].dest() == uint32_t(m_mpi_rank) /*|| recv_ptr[i].is_tree_op()*/) {
+        *_oitr = recv_ptr[i];//.msg;
+        ++_oitr;
+        ++m_recv_counter;
+      } else if(recv_ptr[i].get_bcast() &&
+                recv_ptr[i].dest() > uint32_t(m_mpi_size)) {
+        // Sent by bcast(); a bcast message with a rank as dest is routed
+        bcast_to_targets(recv_ptr[i]);
+      } else if(recv_ptr[i].is_intercept()) {
+        if( _oitr.intercept(recv_ptr[i]) ) {
+          route_fast_path(recv_ptr[i].dest(), recv_ptr[i]);
+        }
+      } else {
+        route_fast_path(recv_ptr[i].dest(), recv_ptr[i]);
+      }
+    }
+  }
+
 
   bool is_idle() {
     cleanup_pending_isend_requests();
@@ -421,17 +476,66 @@ public:
 
 
 private:
+  /// Room for a full buffer of messages plus the wire format byte
+  size_t buffer_bytes() const {
+    return get_environment().mailbox_aggregation() * sizeof(routed_msg_type)
+           + (m_compression > 0 ? 1 : 0);
+  }
+
+  /// Encodes count messages (sorting them) into out, which holds
+  /// buffer_bytes().  Falls back to raw messages if encoding does not pay.
+  size_t encode_buffer(routed_msg_type* msgs, size_t count, uint8_t* out) {
+    const size_t raw_bytes = count * sizeof(routed_msg_type);
+    size_t encoded = codec_type::encode(msgs, count, &(m_codec_scratch[0]));
+    if(m_compression > 1) {
+      size_t compressed = havoqgt::detail::lz_block_codec::compress(
+          &(m_codec_scratch[0]), encoded, out + 1, std::min(encoded, raw_bytes));
+      if(compressed > 0) {
+        out[0] = WIRE_LZ;
+        return compressed + 1;
+      }
+    }
+    if(encoded < raw_bytes) {
+      out[0] = WIRE_VARINT;
+      memcpy(out + 1, &(m_codec_scratch[0]), encoded);
+      return encoded + 1;
+    }
+    out[0] = WIRE_RAW;
+    memcpy(out + 1, msgs, raw_bytes);
+    return raw_bytes + 1;
+  }
+
+  /// Decodes a received buffer into m_decoded; returns the message count.
+  size_t decode_buffer(const uint8_t* in, size_t bytes) {
+    switch(in[0]) {
+      case WIRE_RAW:
+        memcpy(&(m_decoded[0]), in + 1, bytes - 1);
+        return (bytes - 1) / sizeof(routed_msg_type);
+      case WIRE_VARINT:
+        return codec_type::decode(in + 1, &(m_decoded[0]));
+      case WIRE_LZ:
+        havoqgt::detail::lz_block_codec::decompress(in + 1, bytes - 1,
+                                                    &(m_codec_scratch[0]));
+        return codec_type::decode(&(m_codec_scratch[0]), &(m_decoded[0]));
+    }
+    std::cerr << "ERROR:  mailbox_routed unknown wire format" << std::endl;
+    exit(-1);
+  }
+
   msg_buffer allocate_msg_buffer() {
+    return msg_buffer(allocate_raw_buffer());
+  }
+
+  void* allocate_raw_buffer() {
     if(m_vec_free_buffers.empty()) {
       void* buff = NULL;
-      int ret = posix_memalign(&buff, 32,
-                      get_environment().mailbox_aggregation() * sizeof(routed_msg_type));
+      int ret = posix_memalign(&buff, 32, buffer_bytes());
       if(ret !=0) {
         perror("posix_memalign"); exit(-1);
       }
       m_vec_free_buffers.push_back(buff);
     }
-    msg_buffer to_return(m_vec_free_buffers.back());
+    void* to_return = m_vec_free_buffers.back();
     m_vec_free_buffers.pop_back();
     return to_return;
   }
@@ -442,7 +546,6 @@ private:
 
   void post_isend(int index) {
     if(m_buffer_per_rank[index].empty()) return;
-    m_mpi_send_counter++;
     int dest = index;
     bool was_first_pending = false;
     if(m_pending_iterator_per_rank[dest] != m_list_pending.end()) {
@@ -453,16 +556,40 @@ private:
       m_pending_iterator_per_rank[dest] = m_list_pending.end();
     }
 
+    void* buffer_ptr = m_buffer_per_rank[index].get_ptr();
+    int size_in_bytes = m_buffer_per_rank[index].size_in_bytes();
+    m_raw_bytes += size_in_bytes;
+    if(m_compression > 0) {
+      void* wire_ptr = allocate_raw_buffer();
+      size_in_bytes = encode_buffer(static_cast<routed_msg_type*>(buffer_ptr),
+                                    m_buffer_per_rank[index].size(),
+                                    static_cast<uint8_t*>(wire_ptr));
+      free_msg_buffer(buffer_ptr);
+      buffer_ptr = wire_ptr;
+    }
+    m_wire_bytes += size_in_bytes;
+
+    if(m_shm.is_node_local(dest) &&
+       m_shm.try_send(dest, buffer_ptr, size_in_bytes)) {
+      ++m_shm_send_counter;
+      free_msg_buffer(buffer_ptr);
+      --m_pending_partial_buffers;
+      m_buffer_per_rank[index].clear();
+      if(!was_first_pending) {
+        post_isend(m_list_pending.front());
+      }
+      return;
+    }
+
     m_list_isends.push_back(index);
     boost::tuple<MPI_Request, void*,std::list<size_t>::iterator> isend_req_tuple;
     MPI_Request* request_ptr = &(isend_req_tuple.get<0>());
-    isend_req_tuple.get<1>() = m_buffer_per_rank[index].get_ptr();
+    isend_req_tuple.get<1>() = buffer_ptr;
     isend_req_tuple.get<2>() = --m_list_isends.end();
-    void* buffer_ptr = m_buffer_per_rank[index].get_ptr();
-    int size_in_bytes = m_buffer_per_rank[index].size_in_bytes();
 
     CHK_MPI( MPI_Isend( buffer_ptr, size_in_bytes, MPI_BYTE, dest,
                         m_mpi_tag, m_mpi_comm, request_ptr) );
+    m_mpi_send_counter++;
 
     --m_pending_partial_buffers;
     m_buffer_per_rank[index].clear();
@@ -512,7 +639,7 @@ private:
     std::pair<MPI_Request, void*> irecv_req;
     irecv_req.second = _buff;
     MPI_Request* request_ptr = &(irecv_req.first);
-    int num_bytes = get_environment().mailbox_aggregation() * sizeof(routed_msg_type);
+    int num_bytes = buffer_bytes();
     CHK_MPI( MPI_Irecv( _buff, num_bytes, MPI_BYTE, MPI_ANY_SOURCE,
                         m_mpi_tag, m_mpi_comm, request_ptr) );
     m_list_irecv_request.push_back(irecv_req);
@@ -550,12 +677,23 @@ private:
 
   bool m_receiving;
 
+  /// Wire compression, see old_environment::mailbox_compression()
+  uint32_t                     m_compression;
+  std::vector<routed_msg_type> m_decoded;
+  std::vector<uint8_t>         m_codec_scratch;
+
+  /// Node-local transport, see old_environment::mailbox_shm()
+  havoqgt::detail::shm_ring_transport m_shm;
+
   //Statistics
   uint64_t                m_mpi_send_counter;
   uint64_t                m_tree_send_counter;
   uint64_t                m_route_counter;
   uint64_t                m_send_counter;
   uint64_t                m_recv_counter;
+  uint64_t                m_shm_send_counter;
+  uint64_t                m_raw_bytes;
+  uint64_t                m_wire_bytes;
 
 };
 
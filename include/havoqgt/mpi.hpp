@@ -113,6 +113,15 @@ MPI_Op mpi_typeof(std::logical_and<T>) { return MPI_LAND; }
 template <typename T>
 MPI_Op mpi_typeof(std::logical_or<T>) { return MPI_LOR; }
 
+template <typename T>
+MPI_Op mpi_typeof(std::bit_and<T>) { return MPI_BAND; }
+
+template <typename T>
+MPI_Op mpi_typeof(std::bit_or<T>) { return MPI_BOR; }
+
+template <typename T>
+MPI_Op mpi_typeof(std::bit_xor<T>) { return MPI_BXOR; }
+
 class mpi_communicator{
 public:
   mpi_communicator(int argc, char** argv)
@@ -170,7 +179,7 @@ void mpi_yield_barrier(MPI_Comm mpi_comm) {
 }
 
 
-//no std:: equivalent for MPI_BAND, MPI_BOR, MPI_LXOR, MPI_BXOR, MPI_MAXLOC, MPI_MINLOC
+//no std:: equivalent for MPI_LXOR, MPI_MAXLOC, MPI_MINLOC
 
 template <typename T, typename Op>
 T mpi_all_reduce(T in_d, Op in_op, MPI_Comm mpi_comm) {
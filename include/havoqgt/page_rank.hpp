@@ -58,6 +58,8 @@
 #include <havoqgt/visitor_queue.hpp>
 #include <boost/container/deque.hpp>
 #include <vector>
+#include <atomic>
+#include <limits>
 
 namespace havoqgt { namespace mpi {
 
@@ -104,41 +106,89 @@ public:
 
 
 
+/// Global statistics of a page_rank() run.
+struct page_rank_stats {
+  uint64_t pushes;     ///< residual deltas sent along edges
+  uint64_t rounds;     ///< visitor traversals between delegate exchanges
+  double   time;       ///< seconds until convergence or the work limit
+  bool     converged;  ///< false if max_work stopped the computation
+};
+
+/**
+ * Push-based PageRank visitor.
+ *
+ * Every vertex holds a rank and a residual.  A visit moves the residual into
+ * the rank and pushes damping * residual / degree to each neighbor; a push
+ * queues the neighbor only when its residual crosses the tolerance, so there
+ * is at most one pending visit per vertex.
+ *
+ * Pushes to a delegate just accumulate in the local replica.  page_rank()
+ * sums them with vertex_data::all_reduce between traversals and seeds the
+ * delegates whose sum reaches the tolerance; the controller's visit is then
+ * broadcast and every rank pushes the sum over its slice of the edges.
+ *
+ * A visitor with delta 0 is such a seed.
+ */
 template<typename Graph, typename PRData>
 class pr_visitor {
 public:
   typedef typename Graph::vertex_locator                 vertex_locator;
-  pr_visitor(): rank(0)  { }
+  pr_visitor(): delta(0)  { }
 
-  pr_visitor(vertex_locator _vertex, double _rank)
+  pr_visitor(vertex_locator _vertex, double _delta)
     : vertex(_vertex)
-    , rank(_rank) { }
+    , delta(_delta) { }
 
   pr_visitor(vertex_locator _vertex)
     : vertex(_vertex)
-    , rank(0) { }      
+    , delta(0) { }
+
 
-  
   bool pre_visit() const {
-    rank_data()[vertex] += rank;
-    return false;
+    if(delta == 0) {
+      if(vertex.is_delegate()) {
+        return delegate_push_data()[vertex] > 0;
+      }
+      return residual_data()[vertex] >= tolerance();
+    }
+    double old_residual = residual_data()[vertex];
+    residual_data()[vertex] = old_residual + delta;
+    return !vertex.is_delegate() && old_residual < tolerance()
+           && old_residual + delta >= tolerance();
   }
 
   template<typename VisitorQueueHandle>
   bool visit(Graph& g, VisitorQueueHandle vis_queue) const {
-    double old_rank = 1;
-    uint64_t degree = g.degree(vertex);
-    double send_rank = 1;//old_rank / double(degree);
-
+    double residual;
+    if(vertex.is_delegate()) {
+      residual = delegate_push_data()[vertex];
+      if(g.master(vertex) == uint32_t(mpi_comm_rank())) {
+        rank_data()[vertex] += residual;
+      }
+    } else {
+      residual = residual_data()[vertex];
+      if(residual < tolerance() || push_count() >= work_limit()) {
+        return false;
+      }
+      residual_data()[vertex] = 0;
+      rank_data()[vertex] += residual;
+    }
 
+    uint64_t degree = g.degree(vertex);
+    if(degree == 0) {
+      return true;
+    }
+    double send_delta = damping() * residual / double(degree);
+    uint64_t pushed = 0;
     typedef typename Graph::edge_iterator eitr_type;
     for(eitr_type eitr = g.edges_begin(vertex); eitr != g.edges_end(vertex); ++eitr) {
       vertex_locator neighbor = eitr.target();
-      pr_visitor new_visitor( neighbor, send_rank);
+      pr_visitor new_visitor( neighbor, send_delta);
       vis_queue->queue_visitor(new_visitor);
+      ++pushed;
     }
+    push_count() += pushed;
     return true;
-
   }
 
 
@@ -156,21 +206,147 @@ public:
     return *data;
   }
 
+  static PRData& residual_data(PRData* _data = NULL) {
+    static PRData* data;
+    if(_data) data = _data;
+    return *data;
+  }
+
+  /// Residual sum each delegate pushes in the current traversal
+  static PRData& delegate_push_data(PRData* _data = NULL) {
+    static PRData* data;
+    if(_data) data = _data;
+    return *data;
+  }
+
+  static double& damping() {
+    static double value;
+    return value;
+  }
+
+  static double& tolerance() {
+    static double value;
+    return value;
+  }
+
+  /// Local pushes after which owned vertices stop being visited
+  static uint64_t& work_limit() {
+    static uint64_t value;
+    return value;
+  }
+
+  static std::atomic<uint64_t>& push_count() {
+    static std::atomic<uint64_t> count;
+    return count;
+  }
 
   vertex_locator   vertex;
-  double           rank;
+  double           delta;
 };
 
- 
+
+/**
+ * Asynchronous PageRank by residual pushing, normalized so ranks sum to 1
+ * (less the rank lost at vertices without edges).
+ *
+ * @param damping   probability of following an edge
+ * @param tolerance a vertex is visited once its residual reaches tolerance;
+ *                  every rank is within num_vertices * tolerance of the fixed
+ *                  point when converged
+ * @param max_work  stop after about this many pushes over all ranks
+ */
 template <typename TGraph, typename PRData>
-void page_rank(TGraph& g, PRData& pr_data) {
+page_rank_stats page_rank(TGraph& g, PRData& pr_data, double damping = 0.85,
+                          double tolerance = 1e-7,
+                          uint64_t max_work = std::numeric_limits<uint64_t>::max()) {
   typedef  pr_visitor<TGraph, PRData>    visitor_type;
-  visitor_type::rank_data(&pr_data);
   typedef visitor_queue< visitor_type, pr_queue, TGraph >    visitor_queue_type;
-   
-  visitor_queue_type vq(&g);
-  vq.init_visitor_traversal();
+  typedef typename TGraph::vertex_locator vertex_locator;
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  double time_start = MPI_Wtime();
+  const int mpi_rank = mpi_comm_rank();
+  const int mpi_size = mpi_comm_size();
+
+  PRData residual(g);
+  PRData delegate_push(g);
+  visitor_type::rank_data(&pr_data);
+  visitor_type::residual_data(&residual);
+  visitor_type::delegate_push_data(&delegate_push);
+  visitor_type::damping() = damping;
+  visitor_type::tolerance() = tolerance;
+  visitor_type::work_limit() = max_work / mpi_size + (max_work % mpi_size != 0);
+  visitor_type::push_count() = 0;
+
+  uint64_t local_vertices = 0;
+  for(typename TGraph::vertex_iterator vitr = g.vertices_begin();
+      vitr != g.vertices_end(); ++vitr) {
+    ++local_vertices;
+  }
+  const double num_vertices = double(g.num_delegates() +
+      mpi_all_reduce(local_vertices, std::plus<uint64_t>(), MPI_COMM_WORLD));
+
+  // Delegate residuals live on their master so that all_reduce sums them.
+  pr_data.reset(0);
+  delegate_push.reset(0);
+  residual.reset((1.0 - damping) / num_vertices);
+  for(uint64_t i=0; i<g.num_delegates(); ++i) {
+    vertex_locator d = g.delegate_locator(i);
+    if(g.master(d) != uint32_t(mpi_rank)) {
+      residual[d] = 0;
+    }
+  }
+
+  page_rank_stats stats;
+  stats.pushes = 0;
+  stats.rounds = 0;
+  stats.converged = false;
+  while(true) {
+    residual.all_reduce();
+    // A work-limited traversal can leave owned residuals at or above the
+    // tolerance, so both kinds are checked before calling it converged.
+    uint32_t active = 0;
+    for(typename TGraph::vertex_iterator vitr = g.vertices_begin();
+        vitr != g.vertices_end(); ++vitr) {
+      if(residual[*vitr] >= tolerance) {
+        active = 1;
+        break;
+      }
+    }
+    for(uint64_t i=0; i<g.num_delegates(); ++i) {
+      vertex_locator d = g.delegate_locator(i);
+      if(residual[d] >= tolerance) {
+        delegate_push[d] = residual[d];
+        residual[d] = 0;
+        active = 1;
+      } else {
+        delegate_push[d] = 0;
+        if(g.master(d) != uint32_t(mpi_rank)) {
+          residual[d] = 0;
+        }
+      }
+    }
+    active = mpi_all_reduce(active, std::greater<uint32_t>(), MPI_COMM_WORLD);
+
+    if(stats.pushes >= max_work) {
+      stats.converged = !active;
+      break;
+    }
+    if(!active) {
+      stats.converged = true;
+      break;
+    }
+    {
+      visitor_queue_type vq(&g);
+      vq.init_visitor_traversal();
+    }
+    ++stats.rounds;
+    stats.pushes = mpi_all_reduce(uint64_t(visitor_type::push_count()),
+                                  std::plus<uint64_t>(), MPI_COMM_WORLD);
+  }
   pr_data.all_reduce();
+  stats.time = MPI_Wtime() - time_start;
+  return stats;
 }
 
 
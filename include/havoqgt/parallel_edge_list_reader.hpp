@@ -53,19 +53,45 @@
 #define HAVOQGT_PARALLEL_EDGE_LIST_READER_INCLUDED
 
 #include <vector>
-#include <fstream>
-#include <deque>
 #include <string>
-#include <sstream>
+#include <memory>
+#include <thread>
 #include <utility>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
 #include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 #include <havoqgt/environment.hpp>
+#include <havoqgt/detail/edge_stage.hpp>
+#include <havoqgt/detail/mapped_file.hpp>
+#include <havoqgt/detail/message_codec.hpp>
 
 namespace havoqgt {
 
 /// Parallel edge list reader
 ///
+/// The input files are memory mapped and treated as one concatenated byte
+/// range, which is split evenly across ranks regardless of how many files
+/// there are.  Each rank cuts its share into units that are parsed by
+/// HAVOQGT_INGEST_THREADS threads; a line belongs to the unit holding its
+/// first byte.  Lines are "<source> <target>" separated by spaces, tabs or
+/// commas; lines that do not start with two integers (comments, blank lines)
+/// are skipped.  If the first edge line of the input has a third integer, the
+/// input is weighted: that column is each edge's weight, 1 where missing.
+///
+/// When undirected, every edge (u, v) with u != v is followed by (v, u), so
+/// the reverse edges are never staged; when dropping self-loops, (u, u) lines
+/// are skipped like comments.
+///
+/// Unless HAVOQGT_INGEST_STAGE=0, the first pass (which finds the edge count
+/// and max vertex) also stages the parsed edges as varint deltas, in memory
+/// or in an unlinked scratch file under HAVOQGT_INGEST_SCRATCH.  Every later
+/// begin() decodes the stage, so the input is read and parsed only once no
+/// matter how many passes graph construction makes.
 class parallel_edge_list_reader {
 
 public:
@@ -90,6 +116,10 @@ public:
 
     const edge_type& operator*() const { return m_current; }
     //const uint64_t* operator->() const { return &(operator*()); }
+
+    /// Weight of the current edge; 1 if the input is unweighted.
+    uint64_t weight() const { return m_weight; }
+
     input_iterator_type& operator++() {
       get_next();
       return *this;
@@ -123,7 +153,7 @@ public:
     input_iterator_type();
 
     void get_next() {
-      bool ret = m_ptr_reader->try_read_edge(m_current);
+      bool ret = m_ptr_reader->try_read_edge(m_current, m_weight);
       ++m_count;
       assert(m_current.first <= m_ptr_reader->max_vertex_id());
       assert(m_current.second <= m_ptr_reader->max_vertex_id());
@@ -132,32 +162,106 @@ public:
     parallel_edge_list_reader* m_ptr_reader;
     uint64_t m_count;
     edge_type m_current;
+    uint64_t m_weight = 1;
   };
 
 
-  /// @todo Add undirected flag
-  parallel_edge_list_reader(const std::vector< std::string >& filenames ) {
+  parallel_edge_list_reader(const std::vector< std::string >& filenames,
+                            bool undirected = false,
+                            bool drop_self_loops = false)
+    : m_undirected(undirected)
+    , m_drop_self_loops(drop_self_loops) {
     int mpi_rank = havoqgt_env()->world_comm().rank();
     int mpi_size = havoqgt_env()->world_comm().size();
     m_local_edge_count = 0;
     m_global_max_vertex = 0;
-    
-    // identify filenames to be read by local rank
+
+    m_num_threads = ingest_thread_count();
+
+    // map every file; the byte range is split globally, not per file
+    uint64_t total_bytes = 0;
     for(size_t i=0; i<filenames.size(); ++i) {
-      if(i % mpi_size == mpi_rank) {
-        m_local_filenames.push_back(filenames[i]);
+      m_files.emplace_back(new detail::mapped_file(filenames[i]));
+      if(!m_files.back()->good()) {
+        std::cerr << "Error opening filename: " << filenames[i] << std::endl;
       }
+      total_bytes += m_files.back()->size();
     }
-    
-    // First pass to calc max vertex and count edges.
-    open_files();
-    std::cout << "files open" << std::endl;
-    edge_type edge;
+    m_weighted = first_edge_weighted();
+
+    // identify byte range to be read by local rank, cut into units
+    uint64_t range_begin = split_point(total_bytes, mpi_size, mpi_rank);
+    uint64_t range_end   = split_point(total_bytes, mpi_size, mpi_rank + 1);
+    uint64_t file_offset = 0;
+    for(size_t i=0; i<m_files.size(); ++i) {
+      uint64_t file_end = file_offset + m_files[i]->size();
+      uint64_t begin = std::max(range_begin, file_offset);
+      uint64_t end   = std::min(range_end, file_end);
+      for(; begin < end; begin += s_unit_bytes) {
+        parse_unit unit = {i, begin - file_offset,
+                           std::min(end, begin + s_unit_bytes) - file_offset};
+        m_units.push_back(unit);
+      }
+      file_offset = file_end;
+    }
+
+    // First pass to calc max vertex and count edges, staging them if enabled.
+    m_staged = get_environment().ingest_stage();
+    detail::stage_sink sink(get_environment().ingest_scratch(), m_staged);
+    std::vector<uint64_t> thread_count(m_num_threads, 0);
+    std::vector<uint64_t> thread_loops(m_num_threads, 0);
+    std::vector<uint64_t> thread_max(m_num_threads, 0);
+    std::vector< std::vector<uint8_t> > thread_stage(m_num_threads);
+    for(size_t next=0; next<m_units.size(); next+=m_num_threads) {
+      size_t batch_size = std::min(size_t(m_num_threads), m_units.size() - next);
+      run_threads(batch_size, [&](size_t tid) {
+        uint64_t count = 0;
+        uint64_t loops = 0;
+        uint64_t max_vertex = thread_max[tid];
+        edge_encoder encoder(thread_stage[tid], m_weighted);
+        scan_unit(m_units[next + tid], [&](const edge_type& edge,
+                                           uint64_t weight) {
+          ++count;
+          loops += edge.first == edge.second;
+          max_vertex = std::max(max_vertex, std::max(edge.first, edge.second));
+          if(m_staged) {
+            encoder.encode(edge, weight);
+          }
+        });
+        thread_count[tid] += count;
+        thread_loops[tid] += loops;
+        thread_max[tid] = max_vertex;
+        if(m_staged) {
+          encoder.finish(count);
+        }
+      });
+      if(m_staged) {
+        for(size_t t=0; t<batch_size; ++t) {
+          sink.append(thread_stage[t]);
+        }
+      }
+    }
+    if(m_staged) {
+      sink.finish(m_stage_memory, m_stage_file);
+      if(m_stage_file.good()) {
+        m_stage_begin = reinterpret_cast<const uint8_t*>(m_stage_file.data());
+        m_stage_end = m_stage_begin + m_stage_file.size();
+      } else {
+        m_stage_begin = m_stage_memory.data();
+        m_stage_end = m_stage_begin + m_stage_memory.size();
+      }
+      // the text is no longer needed
+      m_files.clear();
+      m_units.clear();
+    }
+
     uint64_t local_max_vertex = 0;
-    while(try_read_edge(edge)) {
-      ++m_local_edge_count;
-      local_max_vertex = std::max(edge.first, local_max_vertex);
-      local_max_vertex = std::max(edge.second, local_max_vertex);
+    for(size_t t=0; t<m_num_threads; ++t) {
+      m_local_edge_count += thread_count[t];
+      if(m_undirected) {
+        m_local_edge_count += thread_count[t] - thread_loops[t];
+      }
+      local_max_vertex = std::max(local_max_vertex, thread_max[t]);
     }
     m_global_max_vertex = mpi::mpi_all_reduce(local_max_vertex, std::greater<uint64_t>(), MPI_COMM_WORLD);
   }
@@ -184,39 +288,271 @@ public:
   	return m_local_edge_count;
   }
 
+  /// True if the edges carry a weight column
+  bool weighted() const {
+    return m_weighted;
+  }
+
+  /// Bytes of staged edges on this rank; 0 when staging is disabled.
+  uint64_t staged_bytes() const {
+    return m_stage_end - m_stage_begin;
+  }
+
 protected:
-  
-  bool try_read_edge(edge_type& edge) {
-    std::string line;
-    while(!m_ptr_ifstreams.empty()) {
-      if(std::getline(*(m_ptr_ifstreams.front()), line)) {
-        std::stringstream ssline(line);
-        ssline >> edge.first >> edge.second;
-        return true;
-      } else { //No remaining lines, close file.
-        delete m_ptr_ifstreams.front();
-        m_ptr_ifstreams.pop_front();
+  /// Byte range [begin, end) of one file, not yet aligned to lines
+  struct parse_unit {
+    size_t   file;
+    uint64_t begin;
+    uint64_t end;
+  };
+
+  static const uint64_t s_unit_bytes = uint64_t(16) << 20;
+
+  /// Stages the edges of one unit as a varint edge count followed by, per
+  /// edge, the zigzag delta of the source from the previous source and of
+  /// the target from the source, then the weight if the input is weighted.
+  /// Units are encoded independently so they can be produced in parallel.
+  class edge_encoder {
+  public:
+    edge_encoder(std::vector<uint8_t>& out, bool weighted)
+      : m_out(out), m_weighted(weighted), m_prev_source(0) {
+      m_out.clear();
+    }
+
+    void encode(const edge_type& edge, uint64_t weight) {
+      size_t pos = m_edges.size();
+      m_edges.resize(pos + 3 * detail::varint_max_bytes);
+      uint8_t* end = detail::varint_encode(
+          detail::zigzag_encode(m_prev_source, edge.first), &m_edges[pos]);
+      end = detail::varint_encode(
+          detail::zigzag_encode(edge.first, edge.second), end);
+      if(m_weighted) {
+        end = detail::varint_encode(weight, end);
+      }
+      m_edges.resize(end - m_edges.data());
+      m_prev_source = edge.first;
+    }
+
+    void finish(uint64_t count) {
+      uint8_t header[detail::varint_max_bytes];
+      uint8_t* end = detail::varint_encode(count, header);
+      m_out.assign(header, end);
+      m_out.insert(m_out.end(), m_edges.begin(), m_edges.end());
+    }
+
+  private:
+    std::vector<uint8_t>& m_out;
+    bool                  m_weighted;
+    std::vector<uint8_t>  m_edges;
+    uint64_t              m_prev_source;
+  };
+
+  static uint64_t split_point(uint64_t total, uint64_t parts, uint64_t i) {
+    return (total / parts) * i + std::min(i, total % parts);
+  }
+
+  /// Runs f(0) .. f(n-1) concurrently; f(0) on the calling thread.
+  template <typename Function>
+  static void run_threads(size_t n, Function f) {
+    std::vector<std::thread> threads;
+    for(size_t t=1; t<n; ++t) {
+      threads.emplace_back(f, t);
+    }
+    f(0);
+    for(size_t t=0; t<threads.size(); ++t) {
+      threads[t].join();
+    }
+  }
+
+  static bool is_separator(char c) {
+    return c == ' ' || c == '\t' || c == ',' || c == '\r';
+  }
+
+  /// Parses one unsigned integer at p, skipping leading separators but never
+  /// a newline.  On success p is left past the last digit.
+  static bool scan_uint(const char*& p, const char* eof, uint64_t& value) {
+    while(p < eof && is_separator(*p)) ++p;
+    if(p == eof || *p < '0' || *p > '9') {
+      return false;
+    }
+    value = 0;
+    do {
+      value = value * 10 + uint64_t(*p - '0');
+      ++p;
+    } while(p < eof && *p >= '0' && *p <= '9');
+    return true;
+  }
+
+  static const char* skip_line(const char* p, const char* eof) {
+    const void* nl = memchr(p, '\n', eof - p);
+    return nl ? static_cast<const char*>(nl) + 1 : eof;
+  }
+
+  /// True if the first line of the input that starts with two integers has
+  /// a third.  Every rank sees the same line, so all agree.
+  bool first_edge_weighted() const {
+    for(size_t i=0; i<m_files.size(); ++i) {
+      const char* p   = m_files[i]->data();
+      const char* eof = p + m_files[i]->size();
+      while(p < eof) {
+        uint64_t source, target, weight;
+        if(scan_uint(p, eof, source) && scan_uint(p, eof, target)) {
+          return scan_uint(p, eof, weight);
+        }
+        p = skip_line(p, eof);
       }
     }
     return false;
   }
-  
-  void open_files() {
-    if(!m_ptr_ifstreams.empty()) {
-      HAVOQGT_ERROR_MSG("m_ptr_ifstreams not empty.");
+
+  /// Calls f(edge, weight) for every line starting inside unit.
+  template <typename Function>
+  void scan_unit(const parse_unit& unit, Function f) const {
+    const char* data = m_files[unit.file]->data();
+    const char* eof  = data + m_files[unit.file]->size();
+    const char* p    = data + unit.begin;
+    const char* stop = data + unit.end;
+    if(unit.begin > 0 && p[-1] != '\n') {
+      p = skip_line(p, eof);  // previous unit owns this line
     }
-    for(auto itr=m_local_filenames.begin(); itr!=m_local_filenames.end(); ++itr) {
-      std::ifstream* ptr = new std::ifstream(*itr);
-      if(ptr->good()) {
-        m_ptr_ifstreams.push_back(ptr);
-      } else {
-        std::cerr << "Error opening filename: " << *itr;
+    while(p < stop) {
+      edge_type edge;
+      uint64_t weight = 1;
+      if(scan_uint(p, eof, edge.first) && scan_uint(p, eof, edge.second)
+         && !(m_drop_self_loops && edge.first == edge.second)) {
+        if(m_weighted && !scan_uint(p, eof, weight)) {
+          weight = 1;
+        }
+        f(edge, weight);
+      }
+      p = skip_line(p, eof);
+    }
+  }
+
+  /// Parses the next m_num_threads units concurrently, one buffer each.
+  bool parse_next_batch() {
+    size_t batch_size = std::min(size_t(m_num_threads),
+                                 m_units.size() - m_next_unit);
+    m_batch.resize(m_num_threads);
+    m_batch_weights.resize(m_num_threads);
+    m_batch_count = batch_size;
+    m_batch_idx = 0;
+    m_batch_pos = 0;
+    if(batch_size == 0) {
+      return false;
+    }
+    run_threads(batch_size, [&](size_t tid) {
+      std::vector<edge_type>& buffer = m_batch[tid];
+      std::vector<uint64_t>& weights = m_batch_weights[tid];
+      buffer.clear();
+      weights.clear();
+      scan_unit(m_units[m_next_unit + tid], [&](const edge_type& edge,
+                                                uint64_t weight) {
+        buffer.push_back(edge);
+        if(m_weighted) {
+          weights.push_back(weight);
+        }
+      });
+    });
+    m_next_unit += batch_size;
+    return true;
+  }
+
+  bool try_read_edge(edge_type& edge, uint64_t& weight) {
+    if(m_reverse_pending) {
+      edge = edge_type(m_reverse.second, m_reverse.first);
+      weight = m_reverse_weight;
+      m_reverse_pending = false;
+      return true;
+    }
+    if(!try_read_input_edge(edge, weight)) {
+      return false;
+    }
+    if(m_undirected && edge.first != edge.second) {
+      m_reverse = edge;
+      m_reverse_weight = weight;
+      m_reverse_pending = true;
+    }
+    return true;
+  }
+
+  bool try_read_input_edge(edge_type& edge, uint64_t& weight) {
+    weight = 1;
+    if(m_staged) {
+      return try_decode_edge(edge, weight);
+    }
+    while(true) {
+      if(m_batch_idx < m_batch_count) {
+        if(m_batch_pos < m_batch[m_batch_idx].size()) {
+          if(m_weighted) {
+            weight = m_batch_weights[m_batch_idx][m_batch_pos];
+          }
+          edge = m_batch[m_batch_idx][m_batch_pos++];
+          return true;
+        }
+        ++m_batch_idx;
+        m_batch_pos = 0;
+      } else if(!parse_next_batch()) {
+        return false;
       }
     }
   }
-  
-  std::vector< std::string >     m_local_filenames;
-  std::deque< std::ifstream* > m_ptr_ifstreams;
+
+  bool try_decode_edge(edge_type& edge, uint64_t& weight) {
+    while(m_stage_unit_left == 0) {
+      if(m_stage_pos == m_stage_end) {
+        return false;
+      }
+      m_stage_pos = detail::varint_decode(m_stage_pos, m_stage_unit_left);
+      m_stage_prev_source = 0;
+    }
+    uint64_t zz;
+    m_stage_pos = detail::varint_decode(m_stage_pos, zz);
+    edge.first = detail::zigzag_decode(m_stage_prev_source, zz);
+    m_stage_pos = detail::varint_decode(m_stage_pos, zz);
+    edge.second = detail::zigzag_decode(edge.first, zz);
+    if(m_weighted) {
+      m_stage_pos = detail::varint_decode(m_stage_pos, weight);
+    }
+    m_stage_prev_source = edge.first;
+    --m_stage_unit_left;
+    return true;
+  }
+
+  void open_files() {
+    m_reverse_pending = false;
+    m_stage_pos = m_stage_begin;
+    m_stage_unit_left = 0;
+    m_stage_prev_source = 0;
+    m_next_unit = 0;
+    m_batch_count = 0;
+    m_batch_idx = 0;
+    m_batch_pos = 0;
+  }
+
+  std::vector< std::unique_ptr<detail::mapped_file> > m_files;
+  std::vector< parse_unit > m_units;
+  std::vector< std::vector<edge_type> > m_batch;
+  std::vector< std::vector<uint64_t> >  m_batch_weights;
+  size_t   m_next_unit   = 0;
+  size_t   m_batch_count = 0;
+  size_t   m_batch_idx   = 0;
+  size_t   m_batch_pos   = 0;
+  bool     m_staged = false;
+  bool     m_undirected;
+  bool     m_drop_self_loops;
+  bool     m_weighted = false;
+  bool     m_reverse_pending = false;
+  edge_type m_reverse;
+  uint64_t m_reverse_weight = 1;
+  std::vector<uint8_t> m_stage_memory;
+  detail::mapped_file  m_stage_file;
+  const uint8_t* m_stage_begin = NULL;
+  const uint8_t* m_stage_end   = NULL;
+  const uint8_t* m_stage_pos   = NULL;
+  uint64_t m_stage_unit_left   = 0;
+  uint64_t m_stage_prev_source = 0;
+  uint32_t m_num_threads;
   uint64_t m_local_edge_count;
   uint64_t m_global_max_vertex;
 
@@ -56,6 +56,11 @@
 
 #include <havoqgt/visitor_queue.hpp>
 #include <queue>
+#include <map>
+#include <vector>
+#include <atomic>
+#include <limits>
+#include <algorithm>
 
 namespace havoqgt { namespace mpi {
 
@@ -103,6 +108,88 @@ public:
 };
 
 
+/**
+ * Delta-stepping local queue.  Visitors are kept in buckets keyed by
+ * Visitor::bucket(), and the lowest bucket is drained first; within a
+ * bucket light relaxations go before the deferred heavy ones, so a vertex's
+ * heavy edges are relaxed only once its distance is settled for the bucket.
+ */
+template <typename Visitor>
+class sssp_bucket_queue
+{
+
+protected:
+  struct bucket {
+    std::vector< Visitor > light;
+    std::vector< Visitor > heavy;
+  };
+  std::map< uint64_t, bucket > m_buckets;
+  size_t                       m_size;
+public:
+  sssp_bucket_queue() : m_size(0) { }
+
+  bool push(Visitor const & task)
+  {
+    bucket& b = m_buckets[task.bucket()];
+    if(task.is_heavy()) {
+      b.heavy.push_back(task);
+    } else {
+      b.light.push_back(task);
+    }
+    ++m_size;
+    return true;
+  }
+
+  void pop()
+  {
+    typename std::map< uint64_t, bucket >::iterator itr = m_buckets.begin();
+    if(!itr->second.light.empty()) {
+      itr->second.light.pop_back();
+    } else {
+      itr->second.heavy.pop_back();
+    }
+    if(itr->second.light.empty() && itr->second.heavy.empty()) {
+      m_buckets.erase(itr);
+    }
+    --m_size;
+  }
+
+  Visitor const & top() //const
+  {
+    bucket& b = m_buckets.begin()->second;
+    if(!b.light.empty()) {
+      return b.light.back();
+    }
+    return b.heavy.back();
+  }
+
+  size_t size() const
+  {
+    return m_size;
+  }
+
+  bool empty() const
+  {
+    return m_size == 0;
+  }
+
+  void clear()
+  {
+    m_buckets.clear();
+    m_size = 0;
+  }
+};
+
+
+/// Global statistics of a shortest path run.
+struct sssp_stats {
+  uint64_t relaxations;   ///< edges relaxed, i.e. visitors sent
+  uint64_t improvements;  ///< relaxations that lowered a distance
+  double   delta;         ///< bucket width used, 0 for the priority queue
+  double   time;          ///< seconds
+};
+
+
 template<typename Graph, typename PathData, typename EdgeWeight>
 class sssp_visitor {
 public:
@@ -120,14 +207,18 @@ public:
     bool do_visit  = (*path_data())[vertex] > m_path;
     if(do_visit) {
       (*path_data())[vertex] = m_path;
+      ++improvement_count();
     }
     return do_visit;
   }
 
   template<typename VisitorQueueHandle>
   bool visit(Graph& g, VisitorQueueHandle vis_queue) const {
-    if(m_path == (*path_data())[vertex]) 
+    // Delegate replicas see only the broadcast, never pre_visit().
+    if(m_path <= (*path_data())[vertex]) 
     {
+      (*path_data())[vertex] = m_path;
+      uint64_t relaxed = 0;
       typedef typename Graph::edge_iterator eitr_type;
       for(eitr_type eitr = g.edges_begin(vertex); eitr != g.edges_end(vertex); ++eitr) {
         vertex_locator neighbor = eitr.target();
@@ -135,7 +226,9 @@ public:
         //std::cout << "Visiting neighbor: " << g.locator_to_label(neighbor) << std::endl;
         sssp_visitor new_visitor( neighbor, weight + m_path);
         vis_queue->queue_visitor(new_visitor);
+        ++relaxed;
       }
+      relaxation_count() += relaxed;
       return true;
     }
     return false;
@@ -163,13 +256,186 @@ public:
     return data;
   }
 
+  static std::atomic<uint64_t>& relaxation_count() {
+    static std::atomic<uint64_t> count;
+    return count;
+  }
+
+  static std::atomic<uint64_t>& improvement_count() {
+    static std::atomic<uint64_t> count;
+    return count;
+  }
+
   vertex_locator   vertex;
   path_type        m_path;
 };
 
+
+/**
+ * Delta-stepping visitor for sssp_bucket_queue.
+ *
+ * Edges of weight at most delta are light, the others heavy.  A light
+ * visitor relaxes the light edges of its vertex and, if the vertex has heavy
+ * edges, queues a heavy visitor for itself in the same bucket.  The heavy
+ * visitor runs after the bucket's light work and is dropped if the distance
+ * improved meanwhile, which saves the heavy relaxations of every distance
+ * that did not survive the bucket.
+ *
+ * A delegate's heavy visitor is queued by the controller, since only the
+ * union of the slices tells whether heavy edges exist; the broadcast then
+ * relaxes each rank's slice.
+ */
+template<typename Graph, typename PathData, typename EdgeWeight>
+class delta_stepping_visitor {
+public:
+  typedef typename Graph::vertex_locator                 vertex_locator;
+  typedef typename PathData::value_type                  path_type;
+  delta_stepping_visitor()
+    : m_path(std::numeric_limits<path_type>::max())
+    , m_heavy(false) { }
+
+  delta_stepping_visitor(vertex_locator _vertex, path_type _path,
+                         bool _heavy = false)
+    : vertex(_vertex)
+    , m_path(_path)
+    , m_heavy(_heavy) { }
+
+  delta_stepping_visitor(vertex_locator _vertex)
+    : vertex(_vertex)
+    , m_path(0)
+    , m_heavy(false) { }
+
+  bool pre_visit() const {
+    if(m_heavy) {
+      return (*path_data())[vertex] == m_path;
+    }
+    bool do_visit  = (*path_data())[vertex] > m_path;
+    if(do_visit) {
+      (*path_data())[vertex] = m_path;
+      ++improvement_count();
+    }
+    return do_visit;
+  }
+
+  template<typename VisitorQueueHandle>
+  bool visit(Graph& g, VisitorQueueHandle vis_queue) const {
+    if(m_path > (*path_data())[vertex]) {
+      return false;
+    }
+    (*path_data())[vertex] = m_path;
+
+    uint64_t relaxed = 0;
+    bool has_heavy = false;
+    typedef typename Graph::edge_iterator eitr_type;
+    for(eitr_type eitr = g.edges_begin(vertex); eitr != g.edges_end(vertex); ++eitr) {
+      path_type weight = (*edge_data())[eitr];
+      if((weight > delta()) != m_heavy) {
+        has_heavy |= !m_heavy;
+        continue;
+      }
+      delta_stepping_visitor new_visitor(eitr.target(), weight + m_path);
+      vis_queue->queue_visitor(new_visitor);
+      ++relaxed;
+    }
+    relaxation_count() += relaxed;
+
+    if(!m_heavy && !vertex.get_bcast()
+       && (has_heavy || vertex.is_delegate())) {
+      delta_stepping_visitor heavy_visitor(vertex, m_path, true);
+      vis_queue->queue_visitor(heavy_visitor);
+    }
+    return true;
+  }
+
+  uint64_t bucket() const { return uint64_t(m_path / delta()); }
+  bool is_heavy() const { return m_heavy; }
+
+  friend inline bool operator>(const delta_stepping_visitor& v1,
+                               const delta_stepping_visitor& v2) {
+    return v1.m_path > v2.m_path;
+  }
+
+  friend inline bool operator<(const delta_stepping_visitor& v1,
+                               const delta_stepping_visitor& v2) {
+    return v1.m_path < v2.m_path;
+  }
+
+  static PathData*& path_data() {
+    static PathData* data;
+    return data;
+  }
+
+  static EdgeWeight*& edge_data() {
+    static EdgeWeight* data;
+    return data;
+  }
+
+  static path_type& delta() {
+    static path_type value;
+    return value;
+  }
+
+  static std::atomic<uint64_t>& relaxation_count() {
+    static std::atomic<uint64_t> count;
+    return count;
+  }
+
+  static std::atomic<uint64_t>& improvement_count() {
+    static std::atomic<uint64_t> count;
+    return count;
+  }
+
+  vertex_locator   vertex;
+  path_type        m_path;
+  bool             m_heavy;
+};
+
+
+/**
+ * Bucket width for delta-stepping: the largest edge weight over the average
+ * degree, so that a bucket holds about one light edge per vertex.
+ */
+template <typename TGraph, typename EdgeWeight>
+typename EdgeWeight::value_type
+sssp_auto_delta(TGraph& g, EdgeWeight& edge_data) {
+  typedef typename EdgeWeight::value_type weight_type;
+
+  weight_type local_max = 0;
+  uint64_t local_edges = 0;
+  for(typename EdgeWeight::iterator itr = edge_data.owned_begin();
+      itr != edge_data.owned_end(); ++itr, ++local_edges) {
+    local_max = std::max(local_max, *itr);
+  }
+  for(typename EdgeWeight::iterator itr = edge_data.delegate_begin();
+      itr != edge_data.delegate_end(); ++itr, ++local_edges) {
+    local_max = std::max(local_max, *itr);
+  }
+  uint64_t local_vertices = 0;
+  for(typename TGraph::vertex_iterator vitr = g.vertices_begin();
+      vitr != g.vertices_end(); ++vitr) {
+    ++local_vertices;
+  }
+
+  weight_type max_weight = mpi_all_reduce(local_max,
+      std::greater<weight_type>(), MPI_COMM_WORLD);
+  uint64_t num_edges = mpi_all_reduce(local_edges, std::plus<uint64_t>(),
+                                      MPI_COMM_WORLD);
+  uint64_t num_vertices = g.num_delegates() + mpi_all_reduce(local_vertices,
+      std::plus<uint64_t>(), MPI_COMM_WORLD);
+
+  weight_type delta = max_weight;
+  if(num_edges > num_vertices && num_vertices > 0) {
+    delta = weight_type(max_weight / (double(num_edges) / double(num_vertices)));
+  }
+  if(!(delta > 0)) {
+    delta = max_weight > 0 ? max_weight : weight_type(1);
+  }
+  return delta;
+}
+
  
 template <typename TGraph, typename PathData, typename EdgeWeight>
-void single_source_shortest_path(TGraph& g, 
+sssp_stats single_source_shortest_path(TGraph& g, 
                                  PathData& path_data, 
                                  EdgeWeight& edge_data,
                                  typename TGraph::vertex_locator s) {
@@ -177,10 +443,72 @@ void single_source_shortest_path(TGraph& g,
   typedef  sssp_visitor<TGraph, PathData, EdgeWeight>    visitor_type;
   visitor_type::set_path_data(&path_data);
   visitor_type::set_edge_weight(&edge_data);
+  visitor_type::relaxation_count() = 0;
+  visitor_type::improvement_count() = 0;
   typedef visitor_queue< visitor_type, sssp_queue, TGraph >    visitor_queue_type;
-   
-  visitor_queue_type vq(&g);
-  vq.init_visitor_traversal(s);
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  double time_start = MPI_Wtime();
+  {
+    visitor_queue_type vq(&g);
+    vq.init_visitor_traversal(s);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  sssp_stats stats;
+  stats.relaxations = mpi_all_reduce(uint64_t(visitor_type::relaxation_count()),
+                                     std::plus<uint64_t>(), MPI_COMM_WORLD);
+  stats.improvements = mpi_all_reduce(
+      uint64_t(visitor_type::improvement_count()), std::plus<uint64_t>(),
+      MPI_COMM_WORLD);
+  stats.delta = 0;
+  stats.time = MPI_Wtime() - time_start;
+  return stats;
+}
+
+
+/**
+ * Delta-stepping single source shortest path.  Weights must be
+ * non-negative; path_data must hold the maximum path_type everywhere.
+ *
+ * @param delta bucket width; 0 selects it with sssp_auto_delta()
+ */
+template <typename TGraph, typename PathData, typename EdgeWeight>
+sssp_stats delta_stepping_shortest_path(TGraph& g,
+                                        PathData& path_data,
+                                        EdgeWeight& edge_data,
+                                        typename TGraph::vertex_locator s,
+                                        typename PathData::value_type delta = 0) {
+  typedef delta_stepping_visitor<TGraph, PathData, EdgeWeight> visitor_type;
+  typedef visitor_queue< visitor_type, sssp_bucket_queue, TGraph >
+      visitor_queue_type;
+
+  if(!(delta > 0)) {
+    delta = sssp_auto_delta(g, edge_data);
+  }
+  visitor_type::path_data() = &path_data;
+  visitor_type::edge_data() = &edge_data;
+  visitor_type::delta() = delta;
+  visitor_type::relaxation_count() = 0;
+  visitor_type::improvement_count() = 0;
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  double time_start = MPI_Wtime();
+  {
+    visitor_queue_type vq(&g);
+    vq.init_visitor_traversal(s);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  sssp_stats stats;
+  stats.relaxations = mpi_all_reduce(uint64_t(visitor_type::relaxation_count()),
+                                     std::plus<uint64_t>(), MPI_COMM_WORLD);
+  stats.improvements = mpi_all_reduce(
+      uint64_t(visitor_type::improvement_count()), std::plus<uint64_t>(),
+      MPI_COMM_WORLD);
+  stats.delta = double(delta);
+  stats.time = MPI_Wtime() - time_start;
+  return stats;
 }
 
 
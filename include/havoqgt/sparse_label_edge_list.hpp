@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Roger Pearce <rpearce@llnl.gov>.
+ * LLNL-CODE-644630.
+ * All rights reserved.
+ *
+ * This file is part of HavoqGT, Version 0.1.
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ *
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ *
+ * Our Preamble Notice
+ *
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ *
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ *
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ *
+ */
+
+
+#ifndef HAVOQGT_SPARSE_LABEL_EDGE_LIST_INCLUDED
+#define HAVOQGT_SPARSE_LABEL_EDGE_LIST_INCLUDED
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include <stdint.h>
+
+#include <havoqgt/mpi.hpp>
+#include <havoqgt/environment.hpp>
+#include <havoqgt/detail/hash.hpp>
+#include <havoqgt/detail/iterator.hpp>
+#include <havoqgt/detail/edge_stage.hpp>
+
+namespace havoqgt {
+
+/// Wraps an edge container whose vertex labels are arbitrary 64-bit ids and
+/// presents its edges with dense labels, so delegate_partitioned_graph sizes
+/// its vertex arrays by the number of vertices rather than the largest id.
+///
+/// Every sparse label is owned by the rank label_owner() hashes it to.
+/// Edges are translated in chunks: each rank sends the distinct labels of
+/// its chunk to their owners, and an owner numbers the labels it has not
+/// seen before 0, 1, ... in rank order, then by label.  Local id i of rank
+/// r becomes dense label i * mpi_size + r, which the graph assigns back to
+/// rank r, so each rank's owned_labels() is exactly the sparse labels of
+/// the vertices it owns.  The numbering only depends on the input and the
+/// number of ranks.
+///
+/// Only a chunk of edges and the owned labels are held in memory; the dense
+/// edges are staged like parsed edges, varint encoded in memory or in a
+/// scratch file under HAVOQGT_INGEST_SCRATCH.
+template <typename EdgeContainer>
+class sparse_label_edge_list {
+public:
+  typedef std::pair<uint64_t, uint64_t> edge_type;
+  typedef detail::edge_stage::const_iterator input_iterator_type;
+
+  sparse_label_edge_list(EdgeContainer& edges, MPI_Comm mpi_comm)
+    : m_stage(get_environment().ingest_scratch()) {
+    int mpi_size(0), mpi_rank(0);
+    CHK_MPI( MPI_Comm_size(mpi_comm, &mpi_size) );
+    CHK_MPI( MPI_Comm_rank(mpi_comm, &mpi_rank) );
+
+    const size_t chunk_size = 1024*64;
+    uint64_t local_max = 0;
+    std::unordered_map<uint64_t, uint64_t> local_ids;
+    std::vector<edge_type> chunk;
+    std::vector<uint64_t> labels, dense_of;
+    std::vector< std::vector<uint64_t> > requests(mpi_size), received,
+                                         replies(mpi_size), dense;
+    std::vector<size_t> next(mpi_size);
+    auto itr = edges.begin();
+    auto itr_end = edges.end();
+    while (!mpi::detail::global_iterator_range_empty(itr, itr_end, mpi_comm)) {
+      // Distinct labels of the chunk, grouped by owner
+      chunk.clear();
+      labels.clear();
+      for (size_t i = 0; i < chunk_size && itr != itr_end; ++i, ++itr) {
+        chunk.push_back(*itr);
+        labels.push_back(itr->first);
+        labels.push_back(itr->second);
+      }
+      std::sort(labels.begin(), labels.end());
+      labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+      for (int r = 0; r < mpi_size; ++r) {
+        requests[r].clear();
+        replies[r].clear();
+      }
+      for (size_t i = 0; i < labels.size(); ++i) {
+        requests[label_owner(labels[i], mpi_size)].push_back(labels[i]);
+      }
+
+      // Owners number the labels they receive, in rank order, and reply
+      mpi::mpi_all_to_all(requests, received, mpi_comm);
+      for (int r = 0; r < mpi_size; ++r) {
+        for (size_t i = 0; i < received[r].size(); ++i) {
+          auto ins = local_ids.insert(
+              std::make_pair(received[r][i], m_owned_labels.size()));
+          if (ins.second) {
+            m_owned_labels.push_back(received[r][i]);
+          }
+          replies[r].push_back(ins.first->second * mpi_size + mpi_rank);
+        }
+      }
+      mpi::mpi_all_to_all(replies, dense, mpi_comm);
+
+      // Each owner's replies follow the sorted labels it was sent
+      dense_of.resize(labels.size());
+      std::fill(next.begin(), next.end(), 0);
+      for (size_t i = 0; i < labels.size(); ++i) {
+        int r = label_owner(labels[i], mpi_size);
+        dense_of[i] = dense[r][next[r]++];
+        local_max = std::max(local_max, dense_of[i]);
+      }
+      for (size_t i = 0; i < chunk.size(); ++i) {
+        m_stage.push(edge_type(dense_label(labels, dense_of, chunk[i].first),
+                               dense_label(labels, dense_of, chunk[i].second)));
+      }
+    }
+    m_stage.finish();
+    m_global_max_vertex = mpi::mpi_all_reduce(local_max,
+        std::greater<uint64_t>(), mpi_comm);
+  }
+
+  /// Rank owning a sparse label.  Uses the high half of the hash, leaving
+  /// the low bits independent for hash tables local to the owner.
+  static int label_owner(uint64_t label, int mpi_size) {
+    return ((detail::mix64(label) >> 32) * uint64_t(mpi_size)) >> 32;
+  }
+
+  /// Returns the begin of the input iterator
+  input_iterator_type begin() const { return m_stage.begin(); }
+
+  /// Returns the end of the input iterator
+  input_iterator_type end() const { return m_stage.end(); }
+
+  uint64_t max_vertex_id() const { return m_global_max_vertex; }
+
+  size_t size() const { return m_stage.size(); }
+
+  /// Sparse label of each local id owned by this rank
+  const std::vector<uint64_t>& owned_labels() const { return m_owned_labels; }
+
+private:
+  /// Dense label of a label in the sorted chunk labels
+  static uint64_t dense_label(const std::vector<uint64_t>& labels,
+                              const std::vector<uint64_t>& dense_of,
+                              uint64_t label) {
+    return dense_of[std::lower_bound(labels.begin(), labels.end(), label)
+                    - labels.begin()];
+  }
+
+  detail::edge_stage m_stage;
+  std::vector<uint64_t> m_owned_labels;
+  uint64_t m_global_max_vertex;
+};
+
+} // namespace havoqgt
+
+#endif  // HAVOQGT_SPARSE_LABEL_EDGE_LIST_INCLUDED
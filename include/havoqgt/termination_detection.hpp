@@ -203,7 +203,7 @@ class termination_detection {
   bool handle_waiting_recv_children (const size_type& in_queued,
                                      const size_type& in_completed) {
     //std::cout << m_mpi_rank << " " << __FUNCTION__ << std::endl;
-    if(is_leaf_rank()) {
+    if(is_leaf_rank() && m_mpi_rank != 0) {
       m_subtree_status_response.first += in_queued;
       m_subtree_status_response.second += in_completed;
       isend_status_response_to_parent();
@@ -338,6 +338,88 @@ class termination_detection {
 
 };
 
+
+/**
+ * Termination detection by waves of non-blocking MPI_Iallreduce.
+ *
+ * Each wave sums (queued, completed) over all ranks; a new wave starts as
+ * soon as the previous one completes.  Every rank sees the same sums, so all
+ * ranks agree to terminate once two consecutive waves report equal sums with
+ * queued == completed.  test_for_termination() only calls MPI_Test, and
+ * quiescence is noticed within two allreduce latencies instead of a tree
+ * round trip of point-to-point messages.
+ *
+ * The constructor and destructor are collective over the communicator.
+ */
+template<typename SizeType>
+class iallreduce_termination_detection {
+  public:
+  typedef SizeType size_type;
+
+  iallreduce_termination_detection(MPI_Comm in_mpi_comm) {
+    CHK_MPI( MPI_Comm_dup(in_mpi_comm, &m_mpi_comm) );
+    m_wave_active = false;
+    m_previous_sums[0] = std::numeric_limits<size_type>::max();
+    m_previous_sums[1] = std::numeric_limits<size_type>::max();
+    m_count_queued = 0;
+    m_count_completed = 0;
+  }
+
+  ~iallreduce_termination_detection() {
+    if(m_wave_active) {
+      CHK_MPI( MPI_Wait(&m_req_wave, MPI_STATUS_IGNORE) );
+    }
+    CHK_MPI( MPI_Comm_free(&m_mpi_comm) );
+  }
+
+  void inc_queued(size_t _i=1) { m_count_queued += _i; }
+  void inc_completed(size_t _i=1) { m_count_completed += _i; }
+
+  bool test_for_termination() {
+    if(!m_wave_active) {
+      start_wave();
+      return false;
+    }
+    int flag(0);
+    CHK_MPI( MPI_Test(&m_req_wave, &flag, MPI_STATUS_IGNORE) );
+    if(!flag) {
+      return false;
+    }
+    m_wave_active = false;
+    if(m_sums[0] == m_sums[1] && m_sums[0] == m_previous_sums[0]
+       && m_sums[1] == m_previous_sums[1]) {
+      m_previous_sums[0] = std::numeric_limits<size_type>::max();
+      m_previous_sums[1] = std::numeric_limits<size_type>::max();
+      return true;
+    }
+    m_previous_sums[0] = m_sums[0];
+    m_previous_sums[1] = m_sums[1];
+    start_wave();
+    return false;
+  }
+
+  private:
+  void start_wave() {
+    m_local_counts[0] = m_count_queued;
+    m_local_counts[1] = m_count_completed;
+    CHK_MPI( MPI_Iallreduce(m_local_counts, m_sums, 2,
+                            mpi_typeof(size_type()), MPI_SUM, m_mpi_comm,
+                            &m_req_wave) );
+    m_wave_active = true;
+  }
+
+  MPI_Comm m_mpi_comm;
+  MPI_Request m_req_wave;
+  bool m_wave_active;
+
+  size_type m_local_counts[2];
+  size_type m_sums[2];
+  size_type m_previous_sums[2];
+
+  size_type m_count_queued;
+  size_type m_count_completed;
+};
+
 }} //namespace havoqgt { namespace mpi {
 
 #endif //HAVOQGT_MPI_TERMINATION_DETECTION_HPP_INCLUDED
@@ -53,7 +53,12 @@
 #define HAVOQGT_MPI_TRIANGLE_COUNT_HPP_INCLUDED
 
 #include <havoqgt/visitor_queue.hpp>
+#include <havoqgt/detail/sorted_intersection.hpp>
 #include <boost/container/deque.hpp>
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
 
 
 namespace havoqgt { namespace mpi {
@@ -226,6 +231,370 @@ uint64_t triangle_count(TGraph& g, typename TGraph::vertex_locator s) {
 
 
 
+template <typename Visitor>
+class triangle_batch_queue
+{
+
+protected:
+  std::vector< Visitor > m_data;
+public:
+  triangle_batch_queue() { }
+
+  bool push(Visitor const & task)
+  {
+    m_data.push_back(task);
+    return true;
+  }
+
+  void pop()
+  {
+    m_data.pop_back();
+  }
+
+  Visitor const & top() //const
+  {
+    return m_data.back();
+  }
+
+  size_t size() const
+  {
+    return m_data.size();;
+  }
+
+  bool empty() const
+  {
+    return m_data.empty();
+  }
+
+  void clear()
+  {
+    m_data.clear();
+  }
+};
+
+
+/**
+ * Returns a vertex's sorted targets, decoded into buf if the graph keeps
+ * them compressed.  Edges added since the last compact() follow the CSR
+ * edges in edge_iterator order, each run sorted, and are merged into buf.
+ */
+template <typename Graph>
+std::pair<const typename Graph::vertex_locator*,
+          const typename Graph::vertex_locator*>
+sorted_targets(const Graph& g, typename Graph::vertex_locator v,
+               std::vector<typename Graph::vertex_locator>& buf) {
+  const std::pair<uint64_t, uint64_t> delta = g.delta_range(v);
+  const uint64_t num_delta = delta.second - delta.first;
+  if(!g.targets_compressed() && num_delta == 0) {
+    return std::make_pair(g.targets_begin(v), g.targets_end(v));
+  }
+  buf.clear();
+  for(typename Graph::edge_iterator eitr = g.edges_begin(v);
+      eitr != g.edges_end(v); ++eitr) {
+    buf.push_back(eitr.target());
+  }
+  std::inplace_merge(buf.begin(), buf.end() - num_delta, buf.end());
+  return std::make_pair(buf.data(), buf.data() + buf.size());
+}
+
+
+/**
+ * Each owned vertex's sorted targets larger than itself.  Compressed
+ * targets are decoded, and vertices with edges added since the last
+ * compact() merged, once when the cache is built instead of on every batch
+ * they receive; other vertices read their CSR targets in place.
+ */
+template <typename Graph>
+class sorted_target_cache {
+public:
+  typedef typename Graph::vertex_locator                 vertex_locator;
+  typedef std::pair<const vertex_locator*, const vertex_locator*> range_type;
+
+  void build(const Graph& g) {
+    clear();
+    m_offsets.assign(g.num_local_vertices() + 1, 0);
+    std::vector<vertex_locator> buf;
+    uint64_t next = 0;
+    for(typename Graph::vertex_iterator vitr = g.vertices_begin();
+        vitr != g.vertices_end(); ++vitr) {
+      const vertex_locator v = *vitr;
+      for(; next <= v.local_id(); ++next) {
+        m_offsets[next] = m_targets.size();
+      }
+      if(is_cached(g, v)) {
+        range_type targets = sorted_targets(g, v, buf);
+        m_targets.insert(m_targets.end(),
+            std::upper_bound(targets.first, targets.second, v),
+            targets.second);
+      }
+    }
+    for(; next < m_offsets.size(); ++next) {
+      m_offsets[next] = m_targets.size();
+    }
+  }
+
+  /// v's targets larger than v
+  range_type upper_targets(const Graph& g, vertex_locator v) const {
+    if(is_cached(g, v)) {
+      const vertex_locator* base = m_targets.data();
+      return range_type(base + m_offsets[v.local_id()],
+                        base + m_offsets[v.local_id() + 1]);
+    }
+    const vertex_locator* end = g.targets_end(v);
+    return range_type(std::upper_bound(g.targets_begin(v), end, v), end);
+  }
+
+  void clear() {
+    m_offsets.clear();
+    m_offsets.shrink_to_fit();
+    m_targets.clear();
+    m_targets.shrink_to_fit();
+  }
+
+private:
+  static bool is_cached(const Graph& g, vertex_locator v) {
+    if(g.targets_compressed()) {
+      return true;
+    }
+    const std::pair<uint64_t, uint64_t> delta = g.delta_range(v);
+    return delta.first != delta.second;
+  }
+
+  std::vector<uint64_t>       m_offsets;
+  std::vector<vertex_locator> m_targets;
+};
+
+
+/**
+ * Triangle counting over sorted adjacency lists.
+ *
+ * Edges are oriented from the smaller to the larger vertex_locator, which
+ * puts delegates last, so only delegates send to delegates.  A seed for
+ * vertex u sends, to every out-neighbor v, the out-neighbors of u that are
+ * larger than v, in batches of up to batch_capacity.  v counts the batch
+ * entries also among its own out-neighbors, so each triangle u < v < w is
+ * counted once, at v.
+ *
+ * A delegate's out-neighbors are spread over all ranks, so its seed uses
+ * the list gathered at the controller by triangle_count_sorted(), and a
+ * batch sent to a delegate is broadcast so every rank intersects it with
+ * its slice.  A repeated edge may sit in the slices of several ranks; the
+ * controller keeps it in one of them, so it is counted once.
+ */
+template<typename Graph>
+class triangle_batch_visitor {
+public:
+  typedef typename Graph::vertex_locator                 vertex_locator;
+  enum { batch_capacity = 7 };
+
+  triangle_batch_visitor()
+    : vertex()
+    , batch_size(0) { }
+
+  explicit triangle_batch_visitor(vertex_locator v)
+    : vertex(v)
+    , batch_size(0) { }
+
+  triangle_batch_visitor(vertex_locator v, const vertex_locator* first,
+                         const vertex_locator* last)
+    : vertex(v)
+    , batch_size(last - first) {
+    assert(batch_size > 0 && batch_size <= batch_capacity);
+    std::copy(first, last, batch);
+  }
+
+  bool pre_visit() const {
+    return true;
+  }
+
+  template<typename VisitorQueueHandle>
+  bool visit(Graph& g, VisitorQueueHandle vis_queue) const {
+    if(batch_size == 0) {
+      if(vertex.is_delegate()) {
+        const std::vector<vertex_locator>& out =
+            delegate_out_lists()[vertex.local_id()];
+        send_batches(out.data(), out.data() + out.size(), vis_queue);
+      } else {
+        // Sorted targets may repeat; keep one of each larger neighbor.
+        std::vector<vertex_locator> out;
+        std::pair<const vertex_locator*, const vertex_locator*> targets =
+            target_cache().upper_targets(g, vertex);
+        for(const vertex_locator* itr = targets.first; itr != targets.second;
+            ++itr) {
+          if(out.empty() || out.back() != *itr) {
+            out.push_back(*itr);
+          }
+        }
+        send_batches(out.data(), out.data() + out.size(), vis_queue);
+      }
+      return false;
+    }
+    const vertex_locator* out_begin;
+    const vertex_locator* end;
+    if(vertex.is_delegate()) {
+      const std::vector<vertex_locator>& slice =
+          delegate_slices()[vertex.local_id()];
+      out_begin = slice.data();
+      end = slice.data() + slice.size();
+    } else {
+      std::pair<const vertex_locator*, const vertex_locator*> targets =
+          target_cache().upper_targets(g, vertex);
+      out_begin = targets.first;
+      end = targets.second;
+    }
+    uint64_t found = havoqgt::detail::sorted_intersection_count(batch,
+        batch + batch_size, out_begin, end);
+    if(found > 0) {
+      triangles() += found;
+    }
+    return true;
+  }
+
+  template<typename VisitorQueueHandle>
+  static void send_batches(const vertex_locator* first,
+                           const vertex_locator* last,
+                           VisitorQueueHandle vis_queue) {
+    for(const vertex_locator* v = first; v + 1 < last; ++v) {
+      for(const vertex_locator* b = v + 1; b < last; b += batch_capacity) {
+        const vertex_locator* b_end = std::min(b + batch_capacity, last);
+        triangle_batch_visitor new_visitor(*v, b, b_end);
+        vis_queue->queue_visitor(new_visitor);
+      }
+    }
+  }
+
+  /// Out-neighbors of the delegates controlled by this rank
+  static std::vector< std::vector<vertex_locator> >& delegate_out_lists() {
+    static std::vector< std::vector<vertex_locator> > lists;
+    return lists;
+  }
+
+  /// This rank's distinct out-neighbors of each delegate larger than it,
+  /// without those the controller assigned to another rank
+  static std::vector< std::vector<vertex_locator> >& delegate_slices() {
+    static std::vector< std::vector<vertex_locator> > slices;
+    return slices;
+  }
+
+  /// Sorted larger targets of this rank's vertices
+  static sorted_target_cache<Graph>& target_cache() {
+    static sorted_target_cache<Graph> cache;
+    return cache;
+  }
+
+  static std::atomic<uint64_t>& triangles() {
+    static std::atomic<uint64_t> count;
+    return count;
+  }
+
+  vertex_locator vertex;
+  uint32_t       batch_size;
+  vertex_locator batch[batch_capacity];
+};
+
+
+/**
+ * Counts the triangles of an undirected graph.  Requires the sorted
+ * adjacency lists built by delegate_partitioned_graph; repeated edges are
+ * counted once, self loops are ignored.
+ *
+ * @return the global number of triangles
+ */
+template <typename TGraph>
+uint64_t triangle_count_sorted(TGraph& g) {
+  typedef TGraph                                                  graph_type;
+  typedef typename graph_type::vertex_locator                     vertex_locator;
+  typedef triangle_batch_visitor<TGraph>                          visitor_type;
+  typedef visitor_queue< visitor_type, triangle_batch_queue, graph_type >
+      visitor_queue_type;
+
+  const int mpi_size = mpi_comm_size();
+
+  // Gather each delegate's out-neighbor slices at its controller.
+  std::vector< std::vector<vertex_locator> >& slices =
+      visitor_type::delegate_slices();
+  slices.assign(g.num_delegates(), std::vector<vertex_locator>());
+  std::vector< std::vector< std::pair<uint64_t, vertex_locator> > >
+      to_send(mpi_size), to_recv;
+  std::vector<vertex_locator> buf;
+  for(uint64_t i = 0; i < g.num_delegates(); ++i) {
+    vertex_locator d = g.delegate_locator(i);
+    std::pair<const vertex_locator*, const vertex_locator*> targets =
+        sorted_targets(g, d, buf);
+    const vertex_locator* end = targets.second;
+    for(const vertex_locator* itr = std::upper_bound(targets.first, end, d);
+        itr != end; ++itr) {
+      if(slices[i].empty() || slices[i].back() != *itr) {
+        slices[i].push_back(*itr);
+        to_send[g.master(d)].push_back(std::make_pair(i, *itr));
+      }
+    }
+  }
+  mpi_all_to_all(to_send, to_recv, MPI_COMM_WORLD);
+
+  // The lowest rank holding an out-neighbor keeps it; the others drop it.
+  typedef std::pair< std::pair<uint64_t, vertex_locator>, int > held_type;
+  std::vector<held_type> held;
+  for(size_t r = 0; r < to_recv.size(); ++r) {
+    for(size_t j = 0; j < to_recv[r].size(); ++j) {
+      held.push_back(held_type(to_recv[r][j], int(r)));
+    }
+  }
+  std::sort(held.begin(), held.end());
+  std::vector< std::vector<vertex_locator> >& lists =
+      visitor_type::delegate_out_lists();
+  lists.assign(g.num_delegates(), std::vector<vertex_locator>());
+  for(size_t r = 0; r < to_send.size(); ++r) {
+    to_send[r].clear();
+  }
+  for(size_t j = 0; j < held.size(); ++j) {
+    if(j > 0 && held[j].first == held[j-1].first) {
+      to_send[held[j].second].push_back(held[j].first);
+    } else {
+      lists[held[j].first.first].push_back(held[j].first.second);
+    }
+  }
+  held.clear();
+  mpi_all_to_all(to_send, to_recv, MPI_COMM_WORLD);
+
+  std::vector< std::pair<uint64_t, vertex_locator> > dropped;
+  for(size_t r = 0; r < to_recv.size(); ++r) {
+    dropped.insert(dropped.end(), to_recv[r].begin(), to_recv[r].end());
+  }
+  std::sort(dropped.begin(), dropped.end());
+  for(size_t j = 0; j < dropped.size(); ) {
+    const uint64_t i = dropped[j].first;
+    std::vector<vertex_locator> kept;
+    for(size_t k = 0; k < slices[i].size(); ++k) {
+      if(j < dropped.size() && dropped[j].first == i &&
+         dropped[j].second == slices[i][k]) {
+        ++j;
+      } else {
+        kept.push_back(slices[i][k]);
+      }
+    }
+    slices[i].swap(kept);
+    while(j < dropped.size() && dropped[j].first == i) {
+      ++j;
+    }
+  }
+
+  visitor_type::target_cache().build(g);
+  visitor_type::triangles() = 0;
+  {
+    visitor_queue_type vq(&g);
+    vq.init_visitor_traversal();
+  }
+  lists.clear();
+  slices.clear();
+  visitor_type::target_cache().clear();
+
+  return mpi_all_reduce(uint64_t(visitor_type::triangles()),
+                        std::plus<uint64_t>(), MPI_COMM_WORLD);
+}
+
+
+
 }} //end namespace havoqgt::mpi
 
 
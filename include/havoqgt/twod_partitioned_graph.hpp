@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Roger Pearce <rpearce@llnl.gov>.
+ * LLNL-CODE-644630.
+ * All rights reserved.
+ *
+ * This file is part of HavoqGT, Version 0.1.
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ *
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ *
+ * Our Preamble Notice
+ *
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ *
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ *
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ *
+ */
+
+
+#ifndef HAVOQGT_MPI_TWOD_PARTITIONED_GRAPH_HPP_INCLUDED
+#define HAVOQGT_MPI_TWOD_PARTITIONED_GRAPH_HPP_INCLUDED
+
+#include <limits>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#include <boost/interprocess/containers/vector.hpp>
+#include <boost/interprocess/allocators/allocator.hpp>
+
+#include <havoqgt/mpi.hpp>
+#include <havoqgt/detail/iterator.hpp>
+#include <havoqgt/impl/edge_partitioner.hpp>
+#include <havoqgt/impl/edge_node_identifier.hpp>
+#include <havoqgt/impl/log_step.hpp>
+
+namespace havoqgt {
+namespace mpi {
+
+namespace bip = boost::interprocess;
+
+/**
+ * Graph partitioned over a 2D (checkerboard) grid of ranks, see
+ * grid_partition.  Edge (u, v) is stored on the rank at u's grid row and
+ * v's grid column, so each rank holds the edges between a block of
+ * N / rows sources and a block of N / cols targets.
+ *
+ * Every vertex behaves like a delegate of delegate_partitioned_graph whose
+ * controllers are the ranks of its master's row: visitor_queue sends a
+ * discovered vertex up its column to the master, and the master's visit is
+ * broadcast along its row (delegate_ranks()), so a rank talks to at most
+ * rows + cols - 2 others.  vertex_data keeps a copy for the labels of the
+ * rank's row and column instead of replicating delegates everywhere.
+ * visitor_queue algorithms such as breadth_first_search run unchanged.
+ */
+template <typename SegementManager>
+class twod_partitioned_graph {
+ public:
+  template<typename T>
+  using SegmentAllocator = bip::allocator<T, SegementManager>;
+
+  /// Object that locates a vertex: its label and master rank
+  class vertex_locator;
+  /// Edge Iterator over the edges a rank stores for a vertex of its row
+  class edge_iterator;
+  /// Vertex Data storage, for the labels of the rank's row and column
+  template <typename T, typename Allocator>
+  class vertex_data;
+
+  typedef typename bip::vector<vertex_locator, SegmentAllocator<vertex_locator> >
+      ::const_iterator controller_iterator;
+  /// Every vertex is controlled by its master; there are no 1D owned vertices
+  typedef controller_iterator vertex_iterator;
+
+  /// Constructor that partitions a given, unsorted sequence of edges.
+  /// Collective.
+  template <typename Container>
+  twod_partitioned_graph(const SegmentAllocator<void>& seg_allocator,
+                         MPI_Comm mpi_comm, Container& edges,
+                         uint64_t max_vertex);
+
+  /// Placement of ranks and vertices on the grid
+  grid_partition grid() const { return grid_partition(m_mpi_size); }
+
+  /// Converts a vertex_locator to the vertex label
+  uint64_t locator_to_label(vertex_locator locator) const;
+
+  /// Converts a vertex label to a vertex_locator
+  vertex_locator label_to_locator(uint64_t label) const;
+
+  /// Returns a begin iterator for the local edges of a vertex of this
+  /// rank's grid row
+  edge_iterator edges_begin(vertex_locator locator) const;
+
+  /// Returns an end iterator for the local edges of a vertex
+  edge_iterator edges_end(vertex_locator locator) const;
+
+  /// Returns the degree of a vertex of this rank's grid row
+  uint64_t degree(vertex_locator locator) const;
+
+  /// Returns the local degree of a vertex of this rank's grid row
+  uint64_t local_degree(vertex_locator locator) const;
+
+  vertex_iterator vertices_begin() const { return m_controller_locators.end(); }
+  vertex_iterator vertices_end() const { return m_controller_locators.end(); }
+
+  /// Vertices whose master is this rank
+  controller_iterator controller_begin() const {
+    return m_controller_locators.begin();
+  }
+
+  controller_iterator controller_end() const {
+    return m_controller_locators.end();
+  }
+
+  size_t num_local_vertices() const { return m_controller_locators.size(); }
+
+  uint64_t max_global_vertex_id() { return m_global_max_vertex; }
+
+  uint32_t master(const vertex_locator& locator) const {
+    return locator.m_local_id % m_mpi_size;
+  }
+
+  /// Ranks [first, second) that store edges of a vertex: its master's row
+  std::pair<uint32_t, uint32_t> delegate_ranks(
+      const vertex_locator& locator) const {
+    const grid_partition g = grid();
+    const uint32_t first = g.row(locator.m_local_id) * g.cols();
+    return std::make_pair(first, uint32_t(first + g.cols()));
+  }
+
+ private:
+  template <typename Container>
+  void partition_edges(MPI_Comm mpi_comm, Container& edges,
+      std::vector<std::pair<uint64_t, uint64_t> >& local_edges);
+
+  int m_mpi_size;
+  int m_mpi_rank;
+  uint64_t m_global_max_vertex;
+
+  // CSR of the local edges by row_slot() of the source, and the global
+  // degree of every vertex of this rank's row.
+  bip::vector<uint64_t, SegmentAllocator<uint64_t> > m_row_offsets;
+  bip::vector<vertex_locator, SegmentAllocator<vertex_locator> > m_targets;
+  bip::vector<uint64_t, SegmentAllocator<uint64_t> > m_row_degree;
+
+  bip::vector<vertex_locator, SegmentAllocator<vertex_locator> >
+      m_controller_locators;
+};  // class twod_partitioned_graph
+
+} // namespace mpi
+} // namespace havoqgt
+
+#include <havoqgt/impl/twod_partitioned_graph.ipp>
+
+#endif //HAVOQGT_MPI_TWOD_PARTITIONED_GRAPH_HPP_INCLUDED
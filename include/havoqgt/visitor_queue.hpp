@@ -55,8 +55,12 @@
 #include <havoqgt/mailbox.hpp>
 #include <havoqgt/termination_detection.hpp>
 #include <havoqgt/detail/reservable_priority_queue.hpp>
+#include <havoqgt/environment.hpp>
 #include <vector>
 #include <iterator>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include <sched.h>
 
 namespace havoqgt { namespace mpi {
@@ -64,11 +68,26 @@ namespace havoqgt { namespace mpi {
 class oned_blocked_partitioned_t { };
 class el_partitioned_t { };
 
-template <typename TVisitor, template<typename T> class Queue, typename TGraph>
+/**
+ * Asynchronous visitor traversal over a distributed graph.
+ *
+ * With HAVOQGT_VISITOR_THREADS=N (N > 1) each rank runs N threads.  Every
+ * thread owns a local queue and steals the top visitor from the others when
+ * it runs dry.  Only the calling thread talks to MPI: it drains the other
+ * threads' outboxes into the mailbox, receives, runs delegate controllers and
+ * drives termination detection, and visits in between.  pre_visit() and
+ * visit() of one vertex are serialized by a striped lock, so visitors must
+ * only touch the state of the vertex they visit.
+ *
+ * TerminationDetection is termination_detection (a tree of point-to-point
+ * queries) or iallreduce_termination_detection.
+ */
+template <typename TVisitor, template<typename T> class Queue, typename TGraph,
+          typename TerminationDetection = termination_detection<uint64_t> >
 class visitor_queue {
   typedef TVisitor              visitor_type;
 
-  typedef termination_detection<uint64_t> termination_detection_type;
+  typedef TerminationDetection termination_detection_type;
   typedef TGraph                graph_type;
   typedef typename TGraph::vertex_locator vertex_locator;
   //typedef typename havoqgt::detail::reservable_priority_queue<visitor_type,
@@ -82,6 +101,8 @@ class visitor_queue {
     void set_dest(uint32_t dest)  {m_visitor.vertex.set_dest(dest); }
     bool is_intercept() const { return m_visitor.vertex.is_intercept(); }
     void set_intercept(bool intercept) {m_visitor.vertex.set_intercept(intercept); }
+    vertex_locator&       locator()       { return m_visitor.vertex; }
+    const vertex_locator& locator() const { return m_visitor.vertex; }
     TVisitor  m_visitor;
   };
 
@@ -92,11 +113,29 @@ class visitor_queue {
 #endif
 
 
+  /// Per-thread state of a multithreaded traversal.
+  struct worker_state {
+    worker_state() : next_push(0) { }
+    std::mutex                   queue_mutex;
+    local_queue_type             queue;
+    std::mutex                   outbox_mutex;
+    std::vector<visitor_wrapper> outbox;        // point-to-point sends
+    std::vector<visitor_wrapper> bcast_outbox;  // delegate broadcasts
+    std::vector<visitor_type>    pending;       // queued during visit()
+    size_t                       next_push;     // round-robin for received
+  };
+
 public:
   visitor_queue(TGraph* _graph)
     : m_mailbox(MPI_COMM_WORLD, 0)
-    , m_termination_detection(MPI_COMM_WORLD, 2, 2, 3, 4)
-    , m_ptr_graph(_graph) {
+    , m_termination_detection(MPI_COMM_WORLD)
+    , m_ptr_graph(_graph)
+    , m_num_threads(std::max(get_environment().visitor_threads(), uint32_t(1)))
+    , m_vec_workers(m_num_threads > 1 ? m_num_threads : 0)
+    , m_vertex_locks(m_num_threads > 1 ? s_num_vertex_locks : 0)
+    , m_threads_queued(0)
+    , m_threads_completed(0)
+    , m_threads_done(false) {
     //m_localqueue_owned.reserve(_graph->num_local_vertices());
     //m_localqueue_delegates.reserve(_graph->num_delegates() * 4);
   }
@@ -123,7 +162,7 @@ public:
 
     bool intercept(const visitor_wrapper& __value) {
       assert(m_vq->m_ptr_graph->master(__value.m_visitor.vertex) != uint32_t(m_vq->m_mailbox.comm_rank()));
-      bool ret = __value.m_visitor.pre_visit();
+      bool ret = m_vq->locked_pre_visit(__value.m_visitor);
       if(!ret) {
         m_vq->m_termination_detection.inc_completed();
       }
@@ -150,7 +189,16 @@ public:
   };
 
   void init_visitor_traversal(vertex_locator _source_v) {
-    if(0 /*_source_v.owner()*/ == m_mailbox.comm_rank()) {
+    if(m_num_threads > 1) {
+      tls_worker() = &m_vec_workers[0];
+      if(seed_rank(_source_v) == uint32_t(m_mailbox.comm_rank())) {
+        queue_visitor(visitor_type(_source_v));
+        flush_pending(m_vec_workers[0]);
+      }
+      run_threaded_traversal();
+      return;
+    }
+    if(seed_rank(_source_v) == uint32_t(m_mailbox.comm_rank())) {
       queue_visitor(visitor_type(_source_v));
     }
     do {
@@ -165,8 +213,8 @@ public:
           visitor_wrapper vw;
           vw.m_visitor = this_visitor;
           vw.set_bcast(true);
-          m_mailbox.bcast(vw, visitor_queue_inserter(this));
-          m_termination_detection.inc_queued(m_mailbox.comm_size());
+          post_bcast(vw);
+          m_termination_detection.inc_queued(bcast_count(v));
         }
         m_termination_detection.inc_completed();
       }
@@ -184,12 +232,26 @@ public:
       visitor_wrapper vw;
       vw.m_visitor = this_visitor;
       vw.set_bcast(true);
-      m_mailbox.bcast(vw, visitor_queue_inserter(this));
-      m_termination_detection.inc_queued(m_mailbox.comm_size());
+      post_bcast(vw);
+      m_termination_detection.inc_queued(bcast_count(v));
     }
   }
 
   void init_visitor_traversal() {
+    if(m_num_threads > 1) {
+      // Seed every local vertex, then let the threads visit them.
+      tls_worker() = &m_vec_workers[0];
+      typename TGraph::controller_iterator citr = m_ptr_graph->controller_begin();
+      for(; citr != m_ptr_graph->controller_end(); ++citr) {
+        seed_visitor(visitor_type(*citr));
+      }
+      typename TGraph::vertex_iterator vitr = m_ptr_graph->vertices_begin();
+      for(; vitr != m_ptr_graph->vertices_end(); ++vitr) {
+        seed_visitor(visitor_type(*vitr));
+      }
+      run_threaded_traversal();
+      return;
+    }
     typename TGraph::controller_iterator citr = m_ptr_graph->controller_begin();
     for(; citr != m_ptr_graph->controller_end(); ++citr) {
       visitor_type v(*citr);
@@ -221,6 +283,11 @@ public:
   }
 
   void queue_visitor(const visitor_type& v) {
+    if(tls_worker() != NULL) {
+      // Routed after visit() returns, once the vertex lock is released.
+      tls_worker()->pending.push_back(v);
+      return;
+    }
     if(v.vertex.is_delegate()) {
       local_delegate_visit(v);
     } else {
@@ -256,7 +323,7 @@ private:
       } else { //send interceptable to parent
         visitor_wrapper vw;
         vw.m_visitor = v;
-        vw.set_intercept(true);
+        vw.set_intercept(bcast_to_all(v.vertex));
         uint32_t master_rank = m_ptr_graph->master(v.vertex);
         vw.set_dest(master_rank);
         m_mailbox.send(master_rank, vw, visitor_queue_inserter(this));
@@ -301,7 +368,15 @@ private:
     while(!m_local_controller_queue.empty()) {
       TVisitor v = m_local_controller_queue.front();
       m_local_controller_queue.pop();
-      v.visit(*m_ptr_graph, this);
+      if(m_num_threads > 1) {
+        {
+          std::lock_guard<std::mutex> lock(vertex_lock(v.vertex));
+          v.visit(*m_ptr_graph, this);
+        }
+        flush_pending(m_vec_workers[0]);
+      } else {
+        v.visit(*m_ptr_graph, this);
+      }
       m_termination_detection.inc_completed();
     }
   }
@@ -324,7 +399,7 @@ private:
         }
       } else {
         assert(m_ptr_graph->master(vw.m_visitor.vertex) == uint32_t(m_mailbox.comm_rank()));
-        if(vw.m_visitor.pre_visit()) {
+        if(locked_pre_visit(vw.m_visitor)) {
           //if(m_ptr_graph->master(vw.m_visitor.vertex) == m_mailbox.comm_rank()) {
             //delegate_bcast(vw.m_visitor);
             push(vw.m_visitor);
@@ -344,7 +419,7 @@ private:
       assert(vw.m_visitor.vertex.owner() == uint32_t(m_mailbox.comm_rank()));
       //
       // Now handle owned vertices
-      if(vw.m_visitor.pre_visit()) {
+      if(locked_pre_visit(vw.m_visitor)) {
         push(vw.m_visitor);
       } else {
         m_termination_detection.inc_completed();
@@ -353,6 +428,14 @@ private:
   }
 
   void push(const visitor_type& v) {
+    if(m_num_threads > 1) {
+      // Received visitors are spread over the threads' queues.
+      worker_state& self = m_vec_workers[0];
+      worker_state& w = m_vec_workers[self.next_push++ % m_num_threads];
+      std::lock_guard<std::mutex> lock(w.queue_mutex);
+      w.queue.push(v);
+      return;
+    }
     /*if(v.vertex.is_delegate()) {
       m_localqueue_delegates.push(v);
     } else {
@@ -399,6 +482,250 @@ private:
     return m_localqueue_owned.empty() && m_localqueue_delegates.empty();
   }
 
+
+  //
+  // Multithreaded traversal
+  //
+
+  static worker_state*& tls_worker() {
+    static thread_local worker_state* worker = NULL;
+    return worker;
+  }
+
+  std::mutex& vertex_lock(const vertex_locator& v) {
+    uint64_t key = (v.local_id() << 1) | uint64_t(v.is_delegate());
+    return m_vertex_locks[key % m_vertex_locks.size()];
+  }
+
+  /// A delegate is seeded at its master, which holds its data in every
+  /// graph; other vertices at rank 0, which sends them to their owner.
+  uint32_t seed_rank(const vertex_locator& v) const {
+    return v.is_delegate() ? m_ptr_graph->master(v) : 0;
+  }
+
+  /// True if every rank stores edges, and so data, of delegate v.  Only
+  /// then may ranks on the way to the master intercept it with pre_visit().
+  bool bcast_to_all(const vertex_locator& v) const {
+    std::pair<uint32_t, uint32_t> ranks = m_ptr_graph->delegate_ranks(v);
+    return ranks.second - ranks.first == uint32_t(m_mailbox.comm_size());
+  }
+
+  /// Messages the master's bcast of delegate v delivers; the mailbox bcast
+  /// to every rank also returns one to the master.
+  uint32_t bcast_count(const vertex_locator& v) const {
+    std::pair<uint32_t, uint32_t> ranks = m_ptr_graph->delegate_ranks(v);
+    return bcast_to_all(v) ? ranks.second - ranks.first
+                           : ranks.second - ranks.first - 1;
+  }
+
+  /// Sends a delegate visited at its master to the other ranks that store
+  /// its edges, see TGraph::delegate_ranks().
+  void post_bcast(visitor_wrapper vw) {
+    const vertex_locator v = vw.locator();
+    if(bcast_to_all(v)) {
+      m_mailbox.bcast(vw, visitor_queue_inserter(this));
+      return;
+    }
+    const uint32_t rank = uint32_t(m_mailbox.comm_rank());
+    std::pair<uint32_t, uint32_t> ranks = m_ptr_graph->delegate_ranks(v);
+    for(uint32_t dest = ranks.first; dest < ranks.second; ++dest) {
+      if(dest != rank) {
+        vw.set_dest(dest);
+        m_mailbox.send(dest, vw, visitor_queue_inserter(this));
+      }
+    }
+  }
+
+  bool locked_pre_visit(const visitor_type& v) {
+    if(m_num_threads > 1) {
+      std::lock_guard<std::mutex> lock(vertex_lock(v.vertex));
+      return v.pre_visit();
+    }
+    return v.pre_visit();
+  }
+
+  void seed_visitor(const visitor_type& v) {
+    if(locked_pre_visit(v)) {
+      m_termination_detection.inc_queued();
+      push(v);
+    }
+  }
+
+  /// Queues locally or stages for the mailbox; counted as queued before the
+  /// visitor becomes visible to other threads.
+  void push_local(worker_state& w, const visitor_type& v) {
+    ++m_threads_queued;
+    std::lock_guard<std::mutex> lock(w.queue_mutex);
+    w.queue.push(v);
+  }
+
+  /// Routes what visit() queued, mirroring queue_visitor().
+  void flush_pending(worker_state& w) {
+    const uint32_t rank = uint32_t(m_mailbox.comm_rank());
+    for(size_t i=0; i<w.pending.size(); ++i) {
+      const visitor_type& v = w.pending[i];
+      if(v.vertex.is_delegate()) {
+        if(!locked_pre_visit(v)) {
+          continue;
+        }
+        uint32_t master_rank = m_ptr_graph->master(v.vertex);
+        if(master_rank == rank) {
+          push_local(w, v);
+        } else {
+          visitor_wrapper vw;
+          vw.m_visitor = v;
+          vw.set_intercept(bcast_to_all(v.vertex));
+          vw.set_dest(master_rank);
+          stage_send(w, vw);
+        }
+      } else if(v.vertex.owner() == rank) {
+        if(locked_pre_visit(v)) {
+          push_local(w, v);
+        }
+      } else {
+        visitor_wrapper vw;
+        vw.m_visitor = v;
+        stage_send(w, vw);
+      }
+    }
+    w.pending.clear();
+  }
+
+  void stage_send(worker_state& w, const visitor_wrapper& vw) {
+    ++m_threads_queued;
+    std::lock_guard<std::mutex> lock(w.outbox_mutex);
+    w.outbox.push_back(vw);
+  }
+
+  bool pop_or_steal(size_t id, visitor_type& out) {
+    for(size_t i=0; i<m_num_threads; ++i) {
+      worker_state& w = m_vec_workers[(id + i) % m_num_threads];
+      std::unique_lock<std::mutex> lock(w.queue_mutex, std::defer_lock);
+      if(i == 0) {
+        lock.lock();
+      } else if(!lock.try_lock()) {
+        continue;
+      }
+      if(!w.queue.empty()) {
+        out = w.queue.top();
+        w.queue.pop();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// Visits one visitor from thread id's queue, or one stolen from another.
+  bool process_one(size_t id) {
+    worker_state& w = m_vec_workers[id];
+    visitor_type this_visitor;
+    if(!pop_or_steal(id, this_visitor)) {
+      return false;
+    }
+    const vertex_locator v = this_visitor.vertex;
+    bool ret;
+    {
+      std::lock_guard<std::mutex> lock(vertex_lock(v));
+      ret = this_visitor.visit(*m_ptr_graph, this);
+    }
+    if(ret && v.is_delegate() &&
+       m_ptr_graph->master(v) == uint32_t(m_mailbox.comm_rank())) {
+      visitor_wrapper vw;
+      vw.m_visitor = this_visitor;
+      vw.set_bcast(true);
+      m_threads_queued += bcast_count(v);
+      std::lock_guard<std::mutex> lock(w.outbox_mutex);
+      w.bcast_outbox.push_back(vw);
+    }
+    flush_pending(w);
+    ++m_threads_completed;
+    return true;
+  }
+
+  void worker_loop(size_t id) {
+    tls_worker() = &m_vec_workers[id];
+    while(!m_threads_done.load()) {
+      if(!process_one(id)) {
+        sched_yield();
+      }
+    }
+    tls_worker() = NULL;
+  }
+
+  /// Hands the staged messages of every thread to the mailbox.
+  bool drain_outboxes() {
+    std::vector<visitor_wrapper> sends, bcasts;
+    bool drained = false;
+    for(size_t i=0; i<m_num_threads; ++i) {
+      worker_state& w = m_vec_workers[i];
+      {
+        std::lock_guard<std::mutex> lock(w.outbox_mutex);
+        sends.swap(w.outbox);
+        bcasts.swap(w.bcast_outbox);
+      }
+      for(size_t j=0; j<sends.size(); ++j) {
+        m_mailbox.send(sends[j].dest(), sends[j], visitor_queue_inserter(this));
+      }
+      for(size_t j=0; j<bcasts.size(); ++j) {
+        post_bcast(bcasts[j]);
+      }
+      drained |= !sends.empty() || !bcasts.empty();
+      sends.clear();
+      bcasts.clear();
+    }
+    return drained;
+  }
+
+  bool queues_empty() {
+    for(size_t i=0; i<m_num_threads; ++i) {
+      std::lock_guard<std::mutex> lock(m_vec_workers[i].queue_mutex);
+      if(!m_vec_workers[i].queue.empty()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// Moves the threads' counts into termination detection.  Completions are
+  /// read first: a visitor is always counted as queued before it completes,
+  /// so the folded totals never show a completion without its queue.
+  void fold_thread_counts() {
+    uint64_t completed = m_threads_completed.exchange(0);
+    uint64_t queued = m_threads_queued.exchange(0);
+    m_termination_detection.inc_queued(queued);
+    m_termination_detection.inc_completed(completed);
+  }
+
+  void run_threaded_traversal() {
+    m_threads_done = false;
+    std::vector<std::thread> threads;
+    for(size_t i=1; i<m_num_threads; ++i) {
+      threads.push_back(std::thread(&visitor_queue::worker_loop, this, i));
+    }
+    while(true) {
+      bool busy = drain_outboxes();
+      process_pending_controllers();
+      check_mailbox();
+      for(size_t i=0; i<s_visits_per_poll && process_one(0); ++i) {
+        busy = true;
+      }
+      busy |= drain_outboxes();
+      if(!busy && queues_empty()) {
+        m_mailbox.flush_buffers_if_idle();
+      }
+      fold_thread_counts();
+      if(m_local_controller_queue.empty() && m_mailbox.is_idle() &&
+         m_termination_detection.test_for_termination()) {
+        break;
+      }
+    }
+    m_threads_done = true;
+    for(size_t i=0; i<threads.size(); ++i) {
+      threads[i].join();
+    }
+    tls_worker() = NULL;
+  }
+
 /*  void init_visitor_traversal() {
     typedef typename graph_type::vertex_iterator vitr_type;
     std::pair< vitr_type, vitr_type > vitr = vertices(*m_ptr_graph);
@@ -437,6 +764,16 @@ private:
   local_queue_type       m_localqueue_delegates;
   TGraph*                m_ptr_graph;
   std::queue<TVisitor> m_local_controller_queue;
+
+  static const size_t s_num_vertex_locks = 4096;
+  static const size_t s_visits_per_poll = 64;
+
+  size_t                    m_num_threads;
+  std::vector<worker_state> m_vec_workers;
+  std::vector<std::mutex>   m_vertex_locks;
+  std::atomic<uint64_t>     m_threads_queued;
+  std::atomic<uint64_t>     m_threads_completed;
+  std::atomic<bool>         m_threads_done;
 };
 
 
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Roger Pearce <rpearce@llnl.gov>.
+ * LLNL-CODE-644630.
+ * All rights reserved.
+ *
+ * This file is part of HavoqGT, Version 0.1.
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ *
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ *
+ * Our Preamble Notice
+ *
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ *
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ *
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ *
+ */
+
+#include <havoqgt/detail/radix_sort.hpp>
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <stdlib.h>
+#include <unistd.h>
+
+void usage()  {
+  std::cerr << "Usage: [-t <int>] [-r <int>]\n"
+       << " -t <int>      - threads for the parallel radix sort (Default is 4)\n"
+       << " -r <int>      - repetitions per measurement (Default is 5)\n"
+       << " -h            - print help and exit\n\n";
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Times std::sort against radix_sort_pairs on random edge batches of the
+ * sizes graph construction sorts: received 8K edge chunks (the exchange
+ * delivers from a few to several times edge_chunk_size) and external sort
+ * runs of millions of edges.
+ */
+int main(int argc, char** argv) {
+  typedef std::pair<uint64_t, uint64_t> edge_type;
+  size_t threads = 4;
+  size_t reps = 5;
+
+  char c;
+  while ((c = getopt(argc, argv, "t:r:h ")) != -1) {
+    switch (c) {
+      case 't':
+        threads = std::max(1ul, strtoul(optarg, NULL, 10));
+        break;
+      case 'r':
+        reps = std::max(1ul, strtoul(optarg, NULL, 10));
+        break;
+      default:
+        usage();
+        exit(-1);
+    }
+  }
+
+  const size_t sizes[] = {size_t(1) << 13, size_t(1) << 15, size_t(1) << 17,
+                          size_t(1) << 20, size_t(1) << 23};
+  const int label_bits[] = {24, 32, 40};
+
+  std::cout << "edges\tbits\tstd::sort\tradix x1\tradix x" << threads
+            << "\t(ms per sort)" << std::endl;
+  std::mt19937_64 rng(12345);
+  for (size_t n : sizes) {
+    for (int bits : label_bits) {
+      std::uniform_int_distribution<uint64_t> dist(0, (uint64_t(1) << bits) - 1);
+      std::vector<edge_type> input(n);
+      for (size_t i = 0; i < n; ++i) {
+        input[i] = edge_type(dist(rng), dist(rng));
+      }
+      std::vector<edge_type> expected(input);
+      std::sort(expected.begin(), expected.end());
+
+      double time[3] = {0, 0, 0};
+      for (size_t r = 0; r < reps; ++r) {
+        for (int method = 0; method < 3; ++method) {
+          std::vector<edge_type> data(input);
+          auto start = std::chrono::steady_clock::now();
+          if (method == 0) {
+            std::sort(data.begin(), data.end());
+          } else {
+            havoqgt::detail::radix_sort_pairs(data, bits, bits,
+                                              method == 1 ? 1 : threads);
+          }
+          time[method] += seconds_since(start);
+          if (data != expected) {
+            std::cerr << "Mismatch: method " << method << ", " << n
+                      << " edges" << std::endl;
+            return 1;
+          }
+        }
+      }
+      std::cout << n << "\t" << bits;
+      for (int method = 0; method < 3; ++method) {
+        std::cout << "\t" << 1000.0 * time[method] / reps;
+      }
+      std::cout << std::endl;
+    }
+  }
+  return 0;
+}
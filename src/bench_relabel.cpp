@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Roger Pearce <rpearce@llnl.gov>.
+ * LLNL-CODE-644630.
+ * All rights reserved.
+ *
+ * This file is part of HavoqGT, Version 0.1.
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ *
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ *
+ * Our Preamble Notice
+ *
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ *
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ *
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ *
+ */
+
+
+#include <havoqgt/environment.hpp>
+#include <havoqgt/rmat_edge_generator.hpp>
+#include <havoqgt/breadth_first_search.hpp>
+#include <havoqgt/delegate_partitioned_graph.hpp>
+
+#include <boost/interprocess/managed_heap_memory.hpp>
+
+#include <list>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace hmpi = havoqgt::mpi;
+using namespace havoqgt::mpi;
+using namespace havoqgt;
+
+typedef bip::managed_heap_memory::segment_manager segment_manager_t;
+typedef hmpi::delegate_partitioned_graph<segment_manager_t> graph_type;
+
+void usage()  {
+  if(havoqgt_env()->world_comm().rank() == 0) {
+    std::cerr << "Usage: [-s <int>] [-e <int>] [-l <int>] [-c <int>] [-r <int>]\n"
+         << " -s <int>      - RMAT vertex scale (Default is 18)\n"
+         << " -e <int>      - edges per vertex (Default is 16)\n"
+         << " -l <int>      - vertices relabeled per rank (Default is 65536)\n"
+         << " -c <int>      - simulated cache size in KB (Default is 256)\n"
+         << " -r <int>      - BFS repetitions (Default is 3)\n"
+         << " -h            - print help and exit\n\n";
+  }
+}
+
+/// Set associative LRU cache of 64 byte lines, counting misses
+class cache_simulator {
+ public:
+  cache_simulator(uint64_t bytes, uint64_t ways)
+    : m_ways(ways)
+    , m_sets(std::max(uint64_t(1), bytes / line_bytes / ways))
+    , m_lines(m_sets) { }
+
+  void access(uint64_t address) {
+    const uint64_t line = address / line_bytes;
+    std::list<uint64_t>& set = m_lines[line % m_sets];
+    ++m_accesses;
+    auto itr = std::find(set.begin(), set.end(), line);
+    if (itr != set.end()) {
+      set.splice(set.begin(), set, itr);
+      return;
+    }
+    ++m_misses;
+    set.push_front(line);
+    if (set.size() > m_ways) {
+      set.pop_back();
+    }
+  }
+
+  uint64_t accesses() const { return m_accesses; }
+  uint64_t misses() const { return m_misses; }
+
+ private:
+  static const uint64_t line_bytes = 64;
+  uint64_t m_ways;
+  uint64_t m_sets;
+  std::vector<std::list<uint64_t> > m_lines;
+  uint64_t m_accesses = 0;
+  uint64_t m_misses = 0;
+};
+
+/**
+ * Replays the vertex_data reads of a pass over all edges: owned vertices in
+ * order, reading the 8 byte entry of every local non-delegate target.
+ */
+void simulate_edge_pass(graph_type* graph, cache_simulator& cache) {
+  const uint32_t mpi_rank = havoqgt_env()->world_comm().rank();
+  for (auto vitr = graph->vertices_begin(); vitr != graph->vertices_end();
+       ++vitr) {
+    for (auto eitr = graph->edges_begin(*vitr);
+         eitr != graph->edges_end(*vitr); ++eitr) {
+      graph_type::vertex_locator target = eitr.target();
+      if (!target.is_delegate() && target.owner() == mpi_rank) {
+        cache.access(target.local_id() * sizeof(uint64_t));
+      }
+    }
+  }
+}
+
+/// Fastest of reps BFS runs from the first label with edges
+double time_bfs(graph_type* graph, int reps) {
+  graph_type::vertex_data<uint8_t, std::allocator<uint8_t> > level(*graph);
+  graph_type::vertex_data<graph_type::vertex_locator,
+      std::allocator<graph_type::vertex_locator> > parent(*graph);
+
+  const int mpi_rank = havoqgt_env()->world_comm().rank();
+  graph_type::vertex_locator source;
+  for (uint64_t label = 0; ; ++label) {
+    source = graph->label_to_locator(label);
+    uint64_t local_degree = 0;
+    if (source.is_delegate() || uint32_t(mpi_rank) == source.owner()) {
+      local_degree = graph->degree(source);
+    }
+    if (mpi_all_reduce(local_degree, std::greater<uint64_t>(),
+                       MPI_COMM_WORLD) > 0) {
+      break;
+    }
+  }
+
+  double best = 0;
+  for (int r = 0; r < reps; ++r) {
+    level.reset(128);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double time_start = MPI_Wtime();
+    hmpi::breadth_first_search(graph, level, parent, source);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double time = MPI_Wtime() - time_start;
+    best = (r == 0) ? time : std::min(best, time);
+  }
+  return best;
+}
+
+/**
+ * Builds the same RMAT graph twice, relabeling the second, and compares the
+ * simulated cache miss rate of vertex_data reads and the BFS time.
+ */
+int main(int argc, char** argv) {
+  havoqgt::havoqgt_init(&argc, &argv);
+  {
+  int mpi_rank = havoqgt_env()->world_comm().rank();
+  int mpi_size = havoqgt_env()->world_comm().size();
+  havoqgt::get_environment();
+
+  uint64_t vert_scale = 18;
+  uint64_t edge_factor = 16;
+  uint64_t relabel_count = 65536;
+  uint64_t cache_kb = 256;
+  int reps = 3;
+
+  char c;
+  bool prn_help = false;
+  while ((c = getopt(argc, argv, "s:e:l:c:r:h ")) != -1) {
+    switch (c) {
+      case 's':
+        vert_scale = atoll(optarg);
+        break;
+      case 'e':
+        edge_factor = atoll(optarg);
+        break;
+      case 'l':
+        relabel_count = atoll(optarg);
+        break;
+      case 'c':
+        cache_kb = atoll(optarg);
+        break;
+      case 'r':
+        reps = std::max(1, atoi(optarg));
+        break;
+      default:
+        prn_help = true;
+        break;
+    }
+  }
+  if (prn_help) {
+    usage();
+    exit(-1);
+  }
+
+  const uint64_t num_edges_per_rank =
+      (uint64_t(1) << vert_scale) * edge_factor / mpi_size;
+  if (mpi_rank == 0) {
+    std::cout << "Scale " << vert_scale << ", " << edge_factor
+              << " edges per vertex, " << cache_kb << " KB cache."
+              << std::endl;
+    std::cout << "layout\tmiss rate\tBFS seconds" << std::endl;
+  }
+
+  for (int relabel = 0; relabel < 2; ++relabel) {
+    // Undirected edges are stored twice, plus delegate and vertex metadata
+    bip::managed_heap_memory heap(num_edges_per_rank * 48 +
+        (uint64_t(1) << vert_scale) * 32 / mpi_size + (uint64_t(1) << 24));
+    bip::allocator<void, segment_manager_t> alloc_inst(
+        heap.get_segment_manager());
+    havoqgt::rmat_edge_generator rmat(
+        uint64_t(5489) + uint64_t(mpi_rank) * 3ULL, vert_scale,
+        num_edges_per_rank, 0.57, 0.19, 0.19, 0.05, true, true);
+    graph_type* graph = heap.construct<graph_type>("graph_obj")
+        (alloc_inst, MPI_COMM_WORLD, rmat, rmat.max_vertex_id(), 1024);
+    if (relabel) {
+      graph->relabel_vertices(MPI_COMM_WORLD, relabel_count);
+    }
+
+    cache_simulator cache(cache_kb * 1024, 8);
+    simulate_edge_pass(graph, cache);
+    uint64_t accesses = mpi_all_reduce(cache.accesses(),
+        std::plus<uint64_t>(), MPI_COMM_WORLD);
+    uint64_t misses = mpi_all_reduce(cache.misses(),
+        std::plus<uint64_t>(), MPI_COMM_WORLD);
+    double bfs_time = time_bfs(graph, reps);
+
+    if (mpi_rank == 0) {
+      std::cout << (relabel ? "relabeled" : "original") << "\t"
+                << double(misses) / double(std::max(accesses, uint64_t(1)))
+                << "\t" << bfs_time << std::endl;
+    }
+    heap.destroy_ptr(graph);
+  }
+  }  // END Main MPI
+  havoqgt::havoqgt_finalize();
+  return 0;
+}
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Roger Pearce <rpearce@llnl.gov>.
+ * LLNL-CODE-644630.
+ * All rights reserved.
+ *
+ * This file is part of HavoqGT, Version 0.1.
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ *
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ *
+ * Our Preamble Notice
+ *
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ *
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ *
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ *
+ */
+
+#include <havoqgt/termination_detection.hpp>
+#include <havoqgt/environment.hpp>
+#include <havoqgt/mpi.hpp>
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+
+namespace hmpi = havoqgt::mpi;
+using namespace havoqgt::mpi;
+using namespace havoqgt;
+
+void usage()  {
+  if(havoqgt_env()->world_comm().rank() == 0) {
+    std::cerr << "Usage: [-t <int>] [-p <int>] [-w <int>]\n"
+         << " -t <int>      - number of trials (Default is 10)\n"
+         << " -p <int>      - hops per token, times (rank + 1) (Default is 1000)\n"
+         << " -w <int>      - microseconds of work per hop (Default is 1)\n"
+         << " -h            - print help and exit\n\n";
+  }
+}
+
+void parse_cmd_line(int argc, char** argv, uint64_t& trials, uint64_t& hops,
+                    uint64_t& work_us) {
+  if(havoqgt_env()->world_comm().rank() == 0) {
+    std::cout << "CMD line:";
+    for (int i=0; i<argc; ++i) {
+      std::cout << " " << argv[i];
+    }
+    std::cout << std::endl;
+  }
+
+  trials = 10;
+  hops = 1000;
+  work_us = 1;
+
+  char c;
+  bool prn_help = false;
+  while ((c = getopt(argc, argv, "t:p:w:h ")) != -1) {
+     switch (c) {
+       case 'h':
+         prn_help = true;
+         break;
+       case 't':
+         trials = strtoull(optarg, NULL, 10);
+         break;
+       case 'p':
+         hops = strtoull(optarg, NULL, 10);
+         break;
+       case 'w':
+         work_us = strtoull(optarg, NULL, 10);
+         break;
+      default:
+         std::cerr << "Unrecognized option: "<<c<<", ignore."<<std::endl;
+         prn_help = true;
+         break;
+     }
+   }
+   if (prn_help) {
+     usage();
+     exit(-1);
+   }
+}
+
+void spin(double seconds) {
+  double end = MPI_Wtime() + seconds;
+  while(MPI_Wtime() < end) { }
+}
+
+/**
+ * Passes one token per rank around the ring; the token of rank r makes
+ * hops * (r + 1) hops, so ranks go idle at different times.  Like
+ * visitor_queue, the detector is only polled while a rank is idle.
+ *
+ * @return seconds from the globally last completed hop to the time the
+ *         slowest rank saw termination
+ */
+template <typename TerminationDetection>
+double time_to_quiescence(uint64_t hops, double work) {
+  const int tag = 77;
+  const int mpi_rank = mpi_comm_rank();
+  const int mpi_size = mpi_comm_size();
+  const int next = (mpi_rank + 1) % mpi_size;
+
+  TerminationDetection td(MPI_COMM_WORLD);
+  std::deque< std::pair<uint64_t, MPI_Request> > sends;
+  MPI_Barrier(MPI_COMM_WORLD);
+  const double time_start = MPI_Wtime();
+
+  double time_last_completed = time_start;
+  sends.push_back(std::make_pair(hops * (mpi_rank + 1), MPI_REQUEST_NULL));
+  CHK_MPI( MPI_Isend(&sends.back().first, 1, mpi_typeof(uint64_t()), next,
+                     tag, MPI_COMM_WORLD, &sends.back().second) );
+  td.inc_queued();
+
+  while(true) {
+    int flag(0);
+    CHK_MPI( MPI_Iprobe(MPI_ANY_SOURCE, tag, MPI_COMM_WORLD, &flag,
+                        MPI_STATUS_IGNORE) );
+    if(flag) {
+      uint64_t remaining;
+      CHK_MPI( MPI_Recv(&remaining, 1, mpi_typeof(uint64_t()), MPI_ANY_SOURCE,
+                        tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE) );
+      spin(work);
+      if(remaining > 1) {
+        sends.push_back(std::make_pair(remaining - 1, MPI_REQUEST_NULL));
+        CHK_MPI( MPI_Isend(&sends.back().first, 1, mpi_typeof(uint64_t()),
+                           next, tag, MPI_COMM_WORLD, &sends.back().second) );
+        td.inc_queued();
+      }
+      td.inc_completed();
+      time_last_completed = MPI_Wtime();
+      continue;
+    }
+    while(!sends.empty()) {
+      CHK_MPI( MPI_Test(&sends.front().second, &flag, MPI_STATUS_IGNORE) );
+      if(!flag) {
+        break;
+      }
+      sends.pop_front();
+    }
+    if(td.test_for_termination()) {
+      break;
+    }
+  }
+  const double time_end = MPI_Wtime();
+  while(!sends.empty()) {
+    CHK_MPI( MPI_Wait(&sends.front().second, MPI_STATUS_IGNORE) );
+    sends.pop_front();
+  }
+
+  // Times are taken relative to the barrier, as MPI_Wtime may not be global.
+  double last_completed = mpi_all_reduce(time_last_completed - time_start,
+      std::greater<double>(), MPI_COMM_WORLD);
+  double terminated = mpi_all_reduce(time_end - time_start,
+      std::greater<double>(), MPI_COMM_WORLD);
+  return terminated - last_completed;
+}
+
+template <typename TerminationDetection>
+void run_trials(const std::string& name, uint64_t trials, uint64_t hops,
+                double work) {
+  std::vector<double> latency;
+  for(uint64_t i=0; i<trials; ++i) {
+    latency.push_back(time_to_quiescence<TerminationDetection>(hops, work));
+  }
+  std::sort(latency.begin(), latency.end());
+  if(mpi_comm_rank() == 0 && !latency.empty()) {
+    double sum = 0;
+    for(size_t i=0; i<latency.size(); ++i) {
+      sum += latency[i];
+    }
+    std::cout << name << ": ranks = " << mpi_comm_size()
+              << ", min = " << latency.front()
+              << ", median = " << latency[latency.size() / 2]
+              << ", mean = " << sum / latency.size()
+              << ", max = " << latency.back() << " seconds" << std::endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  int mpi_rank(0), mpi_size(0);
+
+  havoqgt::havoqgt_init(&argc, &argv);
+  {
+  CHK_MPI(MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank));
+  CHK_MPI(MPI_Comm_size(MPI_COMM_WORLD, &mpi_size));
+  havoqgt::get_environment();
+
+  if (mpi_rank == 0) {
+    std::cout << "MPI initialized with " << mpi_size << " ranks." << std::endl;
+  }
+
+  uint64_t trials, hops, work_us;
+  parse_cmd_line(argc, argv, trials, hops, work_us);
+
+  run_trials< termination_detection<uint64_t> >("tree", trials, hops,
+                                                work_us * 1e-6);
+  run_trials< iallreduce_termination_detection<uint64_t> >("iallreduce",
+      trials, hops, work_us * 1e-6);
+  }  // END Main MPI
+  havoqgt::havoqgt_finalize();
+
+  return 0;
+}
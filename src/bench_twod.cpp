@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Roger Pearce <rpearce@llnl.gov>.
+ * LLNL-CODE-644630.
+ * All rights reserved.
+ *
+ * This file is part of HavoqGT, Version 0.1.
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ *
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ *
+ * Our Preamble Notice
+ *
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ *
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ *
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ *
+ */
+
+
+#include <havoqgt/environment.hpp>
+#include <havoqgt/rmat_edge_generator.hpp>
+#include <havoqgt/breadth_first_search.hpp>
+#include <havoqgt/delegate_partitioned_graph.hpp>
+#include <havoqgt/twod_partitioned_graph.hpp>
+
+#include <boost/interprocess/managed_heap_memory.hpp>
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace hmpi = havoqgt::mpi;
+using namespace havoqgt::mpi;
+using namespace havoqgt;
+
+typedef bip::managed_heap_memory::segment_manager segment_manager_t;
+typedef hmpi::delegate_partitioned_graph<segment_manager_t> oned_graph_type;
+typedef hmpi::twod_partitioned_graph<segment_manager_t> twod_graph_type;
+
+void usage()  {
+  if(havoqgt_env()->world_comm().rank() == 0) {
+    std::cerr << "Usage: [-s <int>] [-e <int>] [-d <int>] [-r <int>]\n"
+         << " -s <int>      - RMAT vertex scale (Default is 18)\n"
+         << " -e <int>      - edges per vertex (Default is 16)\n"
+         << " -d <int>      - delegate degree threshold of the 1D graph (Default is 1024)\n"
+         << " -r <int>      - BFS repetitions (Default is 3)\n"
+         << " -h            - print help and exit\n\n";
+  }
+}
+
+/// First label with edges in graph
+uint64_t find_source(oned_graph_type* graph) {
+  const int mpi_rank = havoqgt_env()->world_comm().rank();
+  for (uint64_t label = 0; ; ++label) {
+    oned_graph_type::vertex_locator source = graph->label_to_locator(label);
+    uint64_t local_degree = 0;
+    if (source.is_delegate() || uint32_t(mpi_rank) == source.owner()) {
+      local_degree = graph->degree(source);
+    }
+    if (mpi_all_reduce(local_degree, std::greater<uint64_t>(),
+                       MPI_COMM_WORLD) > 0) {
+      return label;
+    }
+  }
+}
+
+/**
+ * Fastest of reps BFS runs from label; levels receives the number of
+ * vertices found at each level.
+ */
+template <typename Graph>
+double time_bfs(Graph* graph, uint64_t label, int reps,
+                std::vector<uint64_t>& levels) {
+  typename Graph::template vertex_data<uint8_t, std::allocator<uint8_t> >
+      level(*graph);
+  typename Graph::template vertex_data<typename Graph::vertex_locator,
+      std::allocator<typename Graph::vertex_locator> > parent(*graph);
+  typename Graph::vertex_locator source = graph->label_to_locator(label);
+
+  double best = 0;
+  for (int r = 0; r < reps; ++r) {
+    level.reset(128);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double time_start = MPI_Wtime();
+    hmpi::breadth_first_search(graph, level, parent, source);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double time = MPI_Wtime() - time_start;
+    best = (r == 0) ? time : std::min(best, time);
+  }
+
+  levels.assign(128, 0);
+  for (auto vitr = graph->vertices_begin(); vitr != graph->vertices_end();
+       ++vitr) {
+    if (level[*vitr] < 128) {
+      ++levels[level[*vitr]];
+    }
+  }
+  for (auto citr = graph->controller_begin(); citr != graph->controller_end();
+       ++citr) {
+    if (level[*citr] < 128) {
+      ++levels[level[*citr]];
+    }
+  }
+  mpi_all_reduce_inplace(levels, std::plus<uint64_t>(), MPI_COMM_WORLD);
+  return best;
+}
+
+/**
+ * Builds the same RMAT graph as a delegate_partitioned_graph and as a
+ * twod_partitioned_graph, runs BFS on both and checks that every level
+ * finds the same number of vertices.
+ */
+int main(int argc, char** argv) {
+  havoqgt::havoqgt_init(&argc, &argv);
+  int result = 0;
+  {
+  int mpi_rank = havoqgt_env()->world_comm().rank();
+  int mpi_size = havoqgt_env()->world_comm().size();
+  havoqgt::get_environment();
+
+  uint64_t vert_scale = 18;
+  uint64_t edge_factor = 16;
+  uint64_t delegate_threshold = 1024;
+  int reps = 3;
+
+  char c;
+  bool prn_help = false;
+  while ((c = getopt(argc, argv, "s:e:d:r:h ")) != -1) {
+    switch (c) {
+      case 's':
+        vert_scale = atoll(optarg);
+        break;
+      case 'e':
+        edge_factor = atoll(optarg);
+        break;
+      case 'd':
+        delegate_threshold = atoll(optarg);
+        break;
+      case 'r':
+        reps = std::max(1, atoi(optarg));
+        break;
+      default:
+        prn_help = true;
+        break;
+    }
+  }
+  if (prn_help) {
+    usage();
+    exit(-1);
+  }
+
+  const uint64_t num_edges_per_rank =
+      (uint64_t(1) << vert_scale) * edge_factor / mpi_size;
+  // Undirected edges are stored twice, plus vertex metadata
+  bip::managed_heap_memory heap(num_edges_per_rank * 48 +
+      (uint64_t(1) << vert_scale) * 32 / mpi_size + (uint64_t(1) << 24));
+  bip::allocator<void, segment_manager_t> alloc_inst(
+      heap.get_segment_manager());
+
+  std::vector<uint64_t> oned_levels, twod_levels;
+  double oned_time, twod_time;
+  uint64_t source;
+  {
+    havoqgt::rmat_edge_generator rmat(
+        uint64_t(5489) + uint64_t(mpi_rank) * 3ULL, vert_scale,
+        num_edges_per_rank, 0.57, 0.19, 0.19, 0.05, true, true);
+    oned_graph_type* graph = heap.construct<oned_graph_type>("oned_graph")
+        (alloc_inst, MPI_COMM_WORLD, rmat, rmat.max_vertex_id(),
+         delegate_threshold);
+    source = find_source(graph);
+    oned_time = time_bfs(graph, source, reps, oned_levels);
+    heap.destroy_ptr(graph);
+  }
+  {
+    havoqgt::rmat_edge_generator rmat(
+        uint64_t(5489) + uint64_t(mpi_rank) * 3ULL, vert_scale,
+        num_edges_per_rank, 0.57, 0.19, 0.19, 0.05, true, true);
+    twod_graph_type* graph = heap.construct<twod_graph_type>("twod_graph")
+        (alloc_inst, MPI_COMM_WORLD, rmat, rmat.max_vertex_id());
+    twod_time = time_bfs(graph, source, reps, twod_levels);
+    heap.destroy_ptr(graph);
+  }
+
+  if (mpi_rank == 0) {
+    std::cout << "Scale " << vert_scale << ", " << edge_factor
+              << " edges per vertex, BFS from " << source << "." << std::endl;
+    std::cout << "layout\tvisited\tBFS seconds" << std::endl;
+    std::cout << "1D\t" << std::accumulate(oned_levels.begin(),
+                                           oned_levels.end(), uint64_t(0))
+              << "\t" << oned_time << std::endl;
+    std::cout << "2D\t" << std::accumulate(twod_levels.begin(),
+                                           twod_levels.end(), uint64_t(0))
+              << "\t" << twod_time << std::endl;
+    if (oned_levels != twod_levels) {
+      std::cout << "ERROR: BFS levels differ." << std::endl;
+    }
+  }
+  result = (oned_levels == twod_levels) ? 0 : 1;
+  }  // END Main MPI
+  havoqgt::havoqgt_finalize();
+  return result;
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Roger Pearce <rpearce@llnl.gov>.
+ * LLNL-CODE-644630.
+ * All rights reserved.
+ *
+ * This file is part of HavoqGT, Version 0.1.
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ *
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ *
+ * Our Preamble Notice
+ *
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ *
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ *
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ *
+ */
+
+#include <havoqgt/parallel_edge_list_reader.hpp>
+#include <havoqgt/binary_edge_list_reader.hpp>
+#include <havoqgt/environment.hpp>
+#include <havoqgt/mpi.hpp>
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <unistd.h>
+
+using namespace havoqgt;
+
+void usage()  {
+  if(havoqgt_env()->world_comm().rank() == 0) {
+    std::cerr << "Usage: -o <string> [file ...]\n"
+         << " -o <string>   - output base filename; each rank writes\n"
+         << "                 <base>_<rank>_of_<size> (required)\n"
+         << " -h            - print help and exit\n"
+         << "[file ...] - list of text edge list files to convert; a third\n"
+         << "             column of weights is kept\n\n";
+  }
+}
+
+void parse_cmd_line(int argc, char** argv, std::string& output_filename,
+                    std::vector< std::string >& input_filenames) {
+  if(havoqgt_env()->world_comm().rank() == 0) {
+    std::cout << "CMD line:";
+    for (int i=0; i<argc; ++i) {
+      std::cout << " " << argv[i];
+    }
+    std::cout << std::endl;
+  }
+
+  bool found_output_filename = false;
+  input_filenames.clear();
+
+  char c;
+  bool prn_help = false;
+  while ((c = getopt(argc, argv, "o:h ")) != -1) {
+     switch (c) {
+       case 'h':
+         prn_help = true;
+         break;
+       case 'o':
+         found_output_filename = true;
+         output_filename = optarg;
+         break;
+      default:
+         std::cerr << "Unrecognized option: "<<c<<", ignore."<<std::endl;
+         prn_help = true;
+         break;
+     }
+   }
+   if (prn_help || !found_output_filename) {
+     usage();
+     exit(-1);
+   }
+
+   for (int index = optind; index < argc; index++) {
+     input_filenames.push_back(argv[index]);
+   }
+}
+
+
+int main(int argc, char** argv) {
+  havoqgt_init(&argc, &argv);
+  {
+    int mpi_rank = havoqgt_env()->world_comm().rank();
+    int mpi_size = havoqgt_env()->world_comm().size();
+
+    if (mpi_rank == 0) {
+      std::cout << "MPI initialized with " << mpi_size << " ranks." << std::endl;
+      havoqgt::get_environment().print();
+    }
+
+    std::string                output_filename;
+    std::vector< std::string > input_filenames;
+    parse_cmd_line(argc, argv, output_filename, input_filenames);
+
+    double start_time = MPI_Wtime();
+    parallel_edge_list_reader pelr(input_filenames);
+
+    std::stringstream rank_filename;
+    rank_filename << output_filename << "_" << mpi_rank << "_of_" << mpi_size;
+    binary_edge_list_writer writer(rank_filename.str(), pelr.weighted());
+    for (auto itr = pelr.begin(); itr != pelr.end(); ++itr) {
+      writer.write(itr->first, itr->second, itr.weight());
+    }
+    writer.close();
+
+    uint64_t global_edges = mpi::mpi_all_reduce(writer.edge_count(),
+        std::plus<uint64_t>(), MPI_COMM_WORLD);
+    double end_time = MPI_Wtime();
+    if (mpi_rank == 0) {
+      std::cout << "Converted " << global_edges << " edges into "
+                << mpi_size << " binary files in "
+                << (end_time - start_time) << " seconds." << std::endl;
+    }
+  }
+  havoqgt_finalize();
+
+  return 0;
+}
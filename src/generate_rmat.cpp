@@ -77,16 +77,17 @@ using namespace havoqgt::mpi;
 
 void usage()  {
   if(havoqgt_env()->world_comm().rank() == 0) {
-    std::cerr << "Usage: -s <int> -d <int> -o <string>\n"
+    std::cerr << "Usage: -s <int> -d <int> -o <string> [-c]\n"
          << " -s <int>    - RMAT graph Scale (default 17)\n"
-         << " -d <int>    - delegate threshold (Default is 1048576)\n"
+         << " -d <int>    - delegate threshold, 0 picks one (Default is 1048576)\n"
          << " -o <string> - output graph base filename\n"
+         << " -c          - store edge targets compressed\n"
          << " -h          - print help and exit\n\n";
          
   }
 }
 
-void parse_cmd_line(int argc, char** argv, uint64_t& scale, uint64_t& delegate_threshold, std::string& output_filename) {
+void parse_cmd_line(int argc, char** argv, uint64_t& scale, uint64_t& delegate_threshold, std::string& output_filename, bool& compress) {
   if(havoqgt_env()->world_comm().rank() == 0) {
     std::cout << "CMD line:";
     for (int i=0; i<argc; ++i) {
@@ -98,10 +99,11 @@ void parse_cmd_line(int argc, char** argv, uint64_t& scale, uint64_t& delegate_t
   bool found_output_filename = false;
   scale = 17;
   delegate_threshold = 1048576;
+  compress = false;
   
   char c;
   bool prn_help = false;
-  while ((c = getopt(argc, argv, "s:d:o:h ")) != -1) {
+  while ((c = getopt(argc, argv, "s:d:o:ch ")) != -1) {
      switch (c) {
        case 'h':  
          prn_help = true;
@@ -112,6 +114,9 @@ void parse_cmd_line(int argc, char** argv, uint64_t& scale, uint64_t& delegate_t
       case 'd':
          delegate_threshold = atoll(optarg);
          break; 
+      case 'c':
+         compress = true;
+         break;
       case 'o':
          found_output_filename = true;
          output_filename = optarg;
@@ -153,8 +158,9 @@ int main(int argc, char** argv) {
     uint64_t vert_scale;
     uint64_t hub_threshold;
     std::string fname_output;
+    bool compress;
         
-    parse_cmd_line(argc, argv, vert_scale, hub_threshold, fname_output);
+    parse_cmd_line(argc, argv, vert_scale, hub_threshold, fname_output, compress);
 
     num_vertices <<= vert_scale;
     if (mpi_rank == 0) {
@@ -182,6 +188,9 @@ int main(int argc, char** argv) {
     graph_type *graph = segment_manager->construct<graph_type>
         ("graph_obj")
         (alloc_inst, MPI_COMM_WORLD, rmat, rmat.max_vertex_id(), hub_threshold);
+    if (compress) {
+      graph->compress_targets(alloc_inst);
+    }
 
 
     havoqgt_env()->world_comm().barrier();
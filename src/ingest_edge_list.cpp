@@ -53,6 +53,9 @@
 #include <boost/function.hpp>
 #include <havoqgt/delegate_partitioned_graph.hpp>
 #include <havoqgt/parallel_edge_list_reader.hpp>
+#include <havoqgt/binary_edge_list_reader.hpp>
+#include <havoqgt/sparse_label_edge_list.hpp>
+#include <havoqgt/deduplicated_edge_list.hpp>
 #include <havoqgt/environment.hpp>
 #include <havoqgt/cache_utilities.hpp>
 #include <havoqgt/distributed_db.hpp>
@@ -63,6 +66,7 @@
 #include <algorithm>
 #include <functional>
 #include <fstream>      // std::ifstream
+#include <memory>
 #include <unistd.h>
 
 
@@ -79,15 +83,30 @@ typedef hmpi::delegate_partitioned_graph<segment_manager_t> graph_type;
 
 void usage()  {
   if(havoqgt_env()->world_comm().rank() == 0) {
-    std::cerr << "Usage: -o <string> -d <int> [file ...]\n"
+    std::cerr << "Usage: -o <string> -d <int> [-l <int>] [-x] [-u] [-s] [-q] [-c] [-r] [file ...]\n"
          << " -o <string>   - output graph base filename (required)\n"
-         << " -d <int>      - delegate threshold (Default is 1048576)\n"
+         << " -d <int>      - delegate threshold, 0 picks one (Default is 1048576)\n"
+         << " -l <int>      - renumber each rank's <int> highest degree\n"
+         << "                 vertices first, for locality (Default is 0)\n"
+         << " -x            - vertex labels are sparse 64-bit ids; number them\n"
+         << "                 densely and keep a dictionary in the graph\n"
+         << " -u            - undirected: add the reverse of every edge\n"
+         << " -s            - drop self-loops\n"
+         << " -q            - drop duplicate edges before counting degrees\n"
+         << "                 (binary inputs always pass through this step\n"
+         << "                 when -u or -s is given)\n"
+         << " -c            - store edge targets compressed\n"
+         << " -r            - resume an interrupted ingest of the same files\n"
+         << "                 into the output graph\n"
          << " -h            - print help and exit\n"
-         << "[file ...] - list of edge list files to ingest\n\n";
+         << "[file ...] - list of edge list files to ingest (text, or binary\n"
+         << "             files written by convert_edge_list); a third column\n"
+         << "             of weights is stored with the edges, unless -x or -q\n"
+         << "             is given\n\n";
   }
 }
 
-void parse_cmd_line(int argc, char** argv, std::string& output_filename, uint64_t& delegate_threshold, std::vector< std::string >& input_filenames) {
+void parse_cmd_line(int argc, char** argv, std::string& output_filename, uint64_t& delegate_threshold, uint64_t& relabel_count, bool& sparse, bool& undirected, bool& drop_self_loops, bool& dedup, bool& compress, bool& resume, std::vector< std::string >& input_filenames) {
   if(havoqgt_env()->world_comm().rank() == 0) {
     std::cout << "CMD line:";
     for (int i=0; i<argc; ++i) {
@@ -98,11 +117,18 @@ void parse_cmd_line(int argc, char** argv, std::string& output_filename, uint64_
   
   bool found_output_filename = false;
   delegate_threshold = 1048576;
+  relabel_count = 0;
+  sparse = false;
+  undirected = false;
+  drop_self_loops = false;
+  dedup = false;
+  compress = false;
+  resume = false;
   input_filenames.clear();
   
   char c;
   bool prn_help = false;
-  while ((c = getopt(argc, argv, "o:d:h ")) != -1) {
+  while ((c = getopt(argc, argv, "o:d:l:xusqcrh ")) != -1) {
      switch (c) {
        case 'h':  
          prn_help = true;
@@ -110,6 +136,27 @@ void parse_cmd_line(int argc, char** argv, std::string& output_filename, uint64_
        case 'd':
          delegate_threshold = atoll(optarg);
          break;
+       case 'l':
+         relabel_count = atoll(optarg);
+         break;
+       case 'x':
+         sparse = true;
+         break;
+       case 'u':
+         undirected = true;
+         break;
+       case 's':
+         drop_self_loops = true;
+         break;
+       case 'q':
+         dedup = true;
+         break;
+       case 'c':
+         compress = true;
+         break;
+       case 'r':
+         resume = true;
+         break;
       case 'o':
          found_output_filename = true;
          output_filename = optarg;
@@ -131,6 +178,93 @@ void parse_cmd_line(int argc, char** argv, std::string& output_filename, uint64_
    }
 }
 
+template <typename EdgeContainer>
+graph_type* construct_graph(segment_manager_t* segment_manager,
+                            bip::allocator<void, segment_manager_t>& alloc_inst,
+                            EdgeContainer& edges, uint64_t delegate_threshold,
+                            bool resume) {
+  if (resume) {
+    graph_type* graph = segment_manager->find<graph_type>("graph_obj").first;
+    int found = mpi_all_reduce(int(graph != nullptr), std::less<int>(),
+                               MPI_COMM_WORLD);
+    if (!found) {
+      HAVOQGT_ERROR_MSG("No graph to resume; ingest it from scratch.");
+    }
+    // complete_construction() redoes the earliest phase any rank completed
+    int phase = mpi_all_reduce(int(graph->construction_state()),
+                               std::less<int>(), MPI_COMM_WORLD);
+    if (havoqgt_env()->world_comm().rank() == 0) {
+      std::cout << "Resuming graph construction from phase " << phase << "."
+                << std::endl;
+    }
+    graph->complete_construction(alloc_inst, MPI_COMM_WORLD, edges);
+    return graph;
+  }
+  if (havoqgt_env()->world_comm().rank() == 0) {
+    std::cout << "Generating new graph." << std::endl;
+  }
+  return segment_manager->construct<graph_type>
+      ("graph_obj")
+      (alloc_inst, MPI_COMM_WORLD, edges, edges.max_vertex_id(), delegate_threshold);
+}
+
+/// Prints that the edge weights of a weighted input are not kept
+template <typename EdgeContainer>
+void note_dropped_weights(const EdgeContainer& edges) {
+  if (havoqgt::mpi::detail::container_weighted(edges) &&
+      havoqgt_env()->world_comm().rank() == 0) {
+    std::cout << "Edge weights are not kept with -x or -q." << std::endl;
+  }
+}
+
+/// Constructs the graph, first numbering sparse labels densely if asked to.
+template <typename EdgeContainer>
+graph_type* ingest_graph(segment_manager_t* segment_manager,
+                         bip::allocator<void, segment_manager_t>& alloc_inst,
+                         EdgeContainer& edges, uint64_t delegate_threshold,
+                         bool sparse, bool resume) {
+  if (!sparse) {
+    return construct_graph(segment_manager, alloc_inst, edges,
+                           delegate_threshold, resume);
+  }
+  note_dropped_weights(edges);
+  if (havoqgt::get_environment().range_partition()) {
+    HAVOQGT_ERROR_MSG("-x needs label % ranks ownership; unset HAVOQGT_RANGE_PARTITION.");
+  }
+  havoqgt::sparse_label_edge_list<EdgeContainer> dense_edges(edges,
+      MPI_COMM_WORLD);
+  uint64_t vertices = mpi_all_reduce(uint64_t(dense_edges.owned_labels().size()),
+      std::plus<uint64_t>(), MPI_COMM_WORLD);
+  if (havoqgt_env()->world_comm().rank() == 0) {
+    std::cout << "Numbered " << vertices << " sparse labels, max dense label "
+              << dense_edges.max_vertex_id() << "." << std::endl;
+  }
+  graph_type* graph = construct_graph(segment_manager, alloc_inst, dense_edges,
+                                      delegate_threshold, resume);
+  graph->set_sparse_labels(MPI_COMM_WORLD, dense_edges.owned_labels());
+  return graph;
+}
+
+/// Removes duplicate edges, after adding reverse edges and dropping
+/// self-loops if asked to, then constructs the graph from what is left.
+template <typename EdgeContainer>
+graph_type* deduplicate_and_ingest(segment_manager_t* segment_manager,
+                                   bip::allocator<void, segment_manager_t>& alloc_inst,
+                                   EdgeContainer& edges, uint64_t delegate_threshold,
+                                   bool sparse, bool undirected,
+                                   bool drop_self_loops, bool resume) {
+  note_dropped_weights(edges);
+  havoqgt::deduplicated_edge_list<EdgeContainer> distinct_edges(edges,
+      MPI_COMM_WORLD, undirected, drop_self_loops);
+  uint64_t kept = mpi_all_reduce(uint64_t(distinct_edges.size()),
+      std::plus<uint64_t>(), MPI_COMM_WORLD);
+  if (havoqgt_env()->world_comm().rank() == 0) {
+    std::cout << "Kept " << kept << " distinct edges, removed "
+              << distinct_edges.removed_edges() << "." << std::endl;
+  }
+  return ingest_graph(segment_manager, alloc_inst, distinct_edges,
+                      delegate_threshold, sparse, resume);
+}
 
 int main(int argc, char** argv) {
 
@@ -150,29 +284,72 @@ int main(int argc, char** argv) {
 
     std::string                output_filename;
     uint64_t                   delegate_threshold;
+    uint64_t                   relabel_count;
+    bool                       sparse;
+    bool                       undirected;
+    bool                       drop_self_loops;
+    bool                       dedup;
+    bool                       compress;
+    bool                       resume;
     std::vector< std::string > input_filenames;
     
-    parse_cmd_line(argc, argv, output_filename, delegate_threshold, input_filenames);
+    parse_cmd_line(argc, argv, output_filename, delegate_threshold, relabel_count, sparse, undirected, drop_self_loops, dedup, compress, resume, input_filenames);
 
     if (mpi_rank == 0) {
       std::cout << "Ingesting graph from " << input_filenames.size() << " files." << std::endl;
     }
 
-    havoqgt::distributed_db ddb(havoqgt::db_create(), output_filename.c_str());
+    // Each construction phase is synced to the file as it completes, so an
+    // interrupted ingest can be reopened and continued.
+    std::unique_ptr<havoqgt::distributed_db> ddb(resume
+        ? new havoqgt::distributed_db(havoqgt::db_resume(),
+                                      output_filename.c_str())
+        : new havoqgt::distributed_db(havoqgt::db_create(),
+                                      output_filename.c_str()));
 
-    segment_manager_t* segment_manager = ddb.get_segment_manager();
+    segment_manager_t* segment_manager = ddb->get_segment_manager();
     bip::allocator<void, segment_manager_t> alloc_inst(segment_manager);
 
-    //Setup edge list reader
-    havoqgt::parallel_edge_list_reader pelr(input_filenames);
-
-
-    if (mpi_rank == 0) {
-      std::cout << "Generating new graph." << std::endl;
+    //Setup edge list reader; binary edge lists are detected by their header
+    graph_type *graph;
+    if (!input_filenames.empty() &&
+        havoqgt::binary_edge_list_reader::is_binary_file(input_filenames[0])) {
+      havoqgt::binary_edge_list_reader belr(input_filenames);
+      if (dedup || undirected || drop_self_loops) {
+        graph = deduplicate_and_ingest(segment_manager, alloc_inst, belr,
+            delegate_threshold, sparse, undirected, drop_self_loops, resume);
+      } else {
+        graph = ingest_graph(segment_manager, alloc_inst, belr,
+                             delegate_threshold, sparse, resume);
+      }
+    } else {
+      havoqgt::parallel_edge_list_reader pelr(input_filenames, undirected,
+                                              drop_self_loops);
+      uint64_t staged_bytes = mpi_all_reduce(pelr.staged_bytes(),
+          std::plus<uint64_t>(), MPI_COMM_WORLD);
+      uint64_t edges = mpi_all_reduce(uint64_t(pelr.size()),
+          std::plus<uint64_t>(), MPI_COMM_WORLD);
+      if (mpi_rank == 0 && staged_bytes > 0) {
+        std::cout << "Read " << edges << " edges, staged in " << staged_bytes
+                  << " bytes." << std::endl;
+      }
+      if (dedup) {
+        graph = deduplicate_and_ingest(segment_manager, alloc_inst, pelr,
+            delegate_threshold, sparse, false, false, resume);
+      } else {
+        graph = ingest_graph(segment_manager, alloc_inst, pelr,
+                             delegate_threshold, sparse, resume);
+      }
+    }
+    if (relabel_count > 0) {
+      graph->relabel_vertices(MPI_COMM_WORLD, relabel_count);
+    }
+    if (compress) {
+      graph->compress_targets(alloc_inst);
+    }
+    if (mpi_rank == 0 && graph->has_edge_weights()) {
+      std::cout << "Stored edge weights." << std::endl;
     }
-    graph_type *graph = segment_manager->construct<graph_type>
-        ("graph_obj")
-        (alloc_inst, MPI_COMM_WORLD, pelr, pelr.max_vertex_id(), delegate_threshold);
 
 
     havoqgt_env()->world_comm().barrier();
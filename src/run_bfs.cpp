@@ -79,14 +79,16 @@ using namespace havoqgt;
 
 void usage()  {
   if(havoqgt_env()->world_comm().rank() == 0) {
-    std::cerr << "Usage: -i <string> -s <int>\n"
+    std::cerr << "Usage: -i <string> -s <int> [-d]\n"
          << " -i <string>   - input graph base filename (required)\n"
          << " -s <int>      - Source vertex of BFS (Default is 0)\n"
+         << " -d            - level-synchronous direction-optimizing BFS (undirected graphs)\n"
          << " -h            - print help and exit\n\n";
   }
 }
 
-void parse_cmd_line(int argc, char** argv, std::string& input_filename, uint64_t& source_vertex) {
+void parse_cmd_line(int argc, char** argv, std::string& input_filename, uint64_t& source_vertex,
+                    bool& direction_optimizing) {
   if(havoqgt_env()->world_comm().rank() == 0) {
     std::cout << "CMD line:";
     for (int i=0; i<argc; ++i) {
@@ -97,10 +99,11 @@ void parse_cmd_line(int argc, char** argv, std::string& input_filename, uint64_t
   
   bool found_input_filename = false;
   source_vertex = 0;
+  direction_optimizing = false;
   
   char c;
   bool prn_help = false;
-  while ((c = getopt(argc, argv, "i:s:h ")) != -1) {
+  while ((c = getopt(argc, argv, "i:s:dh ")) != -1) {
      switch (c) {
        case 'h':  
          prn_help = true;
@@ -108,6 +111,9 @@ void parse_cmd_line(int argc, char** argv, std::string& input_filename, uint64_t
        case 's':
          source_vertex = atoll(optarg);
          break;
+       case 'd':
+         direction_optimizing = true;
+         break;
       case 'i':
          found_input_filename = true;
          input_filename = optarg;
@@ -146,8 +152,9 @@ int main(int argc, char** argv) {
 
   std::string graph_input;
   uint64_t source_vertex = 0;
+  bool direction_optimizing = false;
   
-  parse_cmd_line(argc, argv, graph_input, source_vertex);
+  parse_cmd_line(argc, argv, graph_input, source_vertex, direction_optimizing);
 
   MPI_Barrier(MPI_COMM_WORLD);
 
@@ -179,6 +186,16 @@ int main(int argc, char** argv) {
     double time(0);
     int count(0);
     uint64_t isource = source_vertex;
+    if (graph->has_sparse_labels()) {
+      // -s names a sparse label; search from its dense label
+      graph_type::vertex_locator sparse_source =
+          graph->sparse_label_to_locator(source_vertex, MPI_COMM_WORLD);
+      if (!sparse_source.is_valid()) {
+        HAVOQGT_ERROR_MSG("Source vertex is not in the graph.");
+      }
+      isource = graph->locator_to_label(sparse_source);
+    }
+    const uint64_t requested_source = isource;
       graph_type::vertex_locator source = graph->label_to_locator(isource);
       uint64_t global_degree(0);
       do {
@@ -195,7 +212,7 @@ int main(int argc, char** argv) {
         if(global_degree == 0) ++isource;
       } while (global_degree == 0);
       if (uint32_t(mpi_rank) == source.owner()) {
-        if(isource != source_vertex) {
+        if(isource != requested_source) {
           std::cout << "Vertex " << source_vertex << " has a degree of 0.   New source vertex = " << isource << std::endl;
         } else {
           std::cout << "Starting vertex = " << isource << std::endl;
@@ -207,13 +224,33 @@ int main(int argc, char** argv) {
 
       bfs_level_data.reset(128);
 
+      std::vector<hmpi::bfs_level_stats> level_stats;
       MPI_Barrier(MPI_COMM_WORLD);
       double time_start = MPI_Wtime();
-      hmpi::breadth_first_search(graph, bfs_level_data, bfs_parent_data,
-          source);
+      if (direction_optimizing) {
+        hmpi::direction_optimizing_bfs(graph, bfs_level_data, bfs_parent_data,
+            source, level_stats);
+      } else {
+        hmpi::breadth_first_search(graph, bfs_level_data, bfs_parent_data,
+            source);
+      }
       MPI_Barrier(MPI_COMM_WORLD);
       double time_end = MPI_Wtime();
 
+      if (mpi_rank == 0 && direction_optimizing) {
+        uint64_t edges_examined_total(0);
+        for (size_t i = 0; i < level_stats.size(); ++i) {
+          std::cout << "Level " << level_stats[i].level << ": "
+                    << (level_stats[i].bottom_up ? "bottom-up" : "top-down")
+                    << ", frontier = " << level_stats[i].frontier_size
+                    << ", edges examined = " << level_stats[i].edges_examined
+                    << ", time = " << level_stats[i].time << std::endl;
+          edges_examined_total += level_stats[i].edges_examined;
+        }
+        std::cout << "Edges examined total = " << edges_examined_total
+                  << std::endl;
+      }
+
       uint64_t visited_total(0);
       for (uint64_t level = 0; level < 15; ++level) {
         uint64_t local_count(0);
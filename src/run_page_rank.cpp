@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Roger Pearce <rpearce@llnl.gov>.
+ * LLNL-CODE-644630.
+ * All rights reserved.
+ *
+ * This file is part of HavoqGT, Version 0.1.
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ *
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ *
+ * Our Preamble Notice
+ *
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ *
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ *
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ *
+ */
+
+#include <havoqgt/page_rank.hpp>
+#include <havoqgt/environment.hpp>
+#include <havoqgt/delegate_partitioned_graph.hpp>
+#include <havoqgt/distributed_db.hpp>
+#include <assert.h>
+
+#include <string>
+#include <limits>
+#include <functional>
+
+namespace hmpi = havoqgt::mpi;
+using namespace havoqgt::mpi;
+using namespace havoqgt;
+
+void usage()  {
+  if(havoqgt_env()->world_comm().rank() == 0) {
+    std::cerr << "Usage: -i <string> [-d <double>] [-t <double>] [-w <int>]\n"
+         << " -i <string>   - input graph base filename (required)\n"
+         << " -d <double>   - damping factor (Default is 0.85)\n"
+         << " -t <double>   - residual tolerance (Default is 1e-7)\n"
+         << " -w <int>      - maximum number of pushes (Default is unlimited)\n"
+         << " -h            - print help and exit\n\n";
+  }
+}
+
+void parse_cmd_line(int argc, char** argv, std::string& input_filename,
+                    double& damping, double& tolerance, uint64_t& max_work) {
+  if(havoqgt_env()->world_comm().rank() == 0) {
+    std::cout << "CMD line:";
+    for (int i=0; i<argc; ++i) {
+      std::cout << " " << argv[i];
+    }
+    std::cout << std::endl;
+  }
+
+  bool found_input_filename = false;
+  damping = 0.85;
+  tolerance = 1e-7;
+  max_work = std::numeric_limits<uint64_t>::max();
+
+  char c;
+  bool prn_help = false;
+  while ((c = getopt(argc, argv, "i:d:t:w:h ")) != -1) {
+     switch (c) {
+       case 'h':
+         prn_help = true;
+         break;
+       case 'd':
+         damping = atof(optarg);
+         break;
+       case 't':
+         tolerance = atof(optarg);
+         break;
+       case 'w':
+         max_work = strtoull(optarg, NULL, 10);
+         break;
+      case 'i':
+         found_input_filename = true;
+         input_filename = optarg;
+         break;
+      default:
+         std::cerr << "Unrecognized option: "<<c<<", ignore."<<std::endl;
+         prn_help = true;
+         break;
+     }
+   }
+   if (prn_help || !found_input_filename) {
+     usage();
+     exit(-1);
+   }
+}
+
+int main(int argc, char** argv) {
+  typedef havoqgt::distributed_db::segment_manager_type segment_manager_t;
+  typedef hmpi::delegate_partitioned_graph<segment_manager_t> graph_type;
+
+  int mpi_rank(0), mpi_size(0);
+
+  havoqgt::havoqgt_init(&argc, &argv);
+  {
+  CHK_MPI(MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank));
+  CHK_MPI(MPI_Comm_size(MPI_COMM_WORLD, &mpi_size));
+  havoqgt::get_environment();
+
+  if (mpi_rank == 0) {
+    std::cout << "MPI initialized with " << mpi_size << " ranks." << std::endl;
+    havoqgt::get_environment().print();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  std::string graph_input;
+  double damping, tolerance;
+  uint64_t max_work;
+
+  parse_cmd_line(argc, argv, graph_input, damping, tolerance, max_work);
+
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  havoqgt::distributed_db ddb(havoqgt::db_open(), graph_input.c_str());
+
+  graph_type *graph = ddb.get_segment_manager()->
+    find<graph_type>("graph_obj").first;
+  assert(graph != nullptr);
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (mpi_rank == 0) {
+    std::cout << "Graph Loaded Ready." << std::endl;
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  // PageRank Experiment
+  {
+    typedef graph_type::vertex_data<double, std::allocator<double> > pr_data_type;
+    pr_data_type pr_data(*graph);
+
+    hmpi::page_rank_stats stats = hmpi::page_rank(*graph, pr_data, damping,
+                                                  tolerance, max_work);
+
+    // Delegate ranks are replicated; count them once, at the controller.
+    double local_sum(0), local_max(0);
+    uint64_t local_max_label(0);
+    graph_type::vertex_iterator vitr;
+    for (vitr = graph->vertices_begin(); vitr != graph->vertices_end(); ++vitr) {
+      local_sum += pr_data[*vitr];
+      if (pr_data[*vitr] > local_max) {
+        local_max = pr_data[*vitr];
+        local_max_label = graph->locator_to_label(*vitr);
+      }
+    }
+    graph_type::controller_iterator citr;
+    for (citr = graph->controller_begin(); citr != graph->controller_end(); ++citr) {
+      local_sum += pr_data[*citr];
+      if (pr_data[*citr] > local_max) {
+        local_max = pr_data[*citr];
+        local_max_label = graph->locator_to_label(*citr);
+      }
+    }
+    double global_sum = mpi_all_reduce(local_sum, std::plus<double>(),
+                                       MPI_COMM_WORLD);
+    double global_max = mpi_all_reduce(local_max, std::greater<double>(),
+                                       MPI_COMM_WORLD);
+    if (local_max == global_max && local_max > 0) {
+      std::cout << "Max rank = " << global_max << " at vertex "
+                << local_max_label << std::endl;
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    if (mpi_rank == 0) {
+      std::cout << "Converged = " << stats.converged << std::endl
+                << "Rounds = " << stats.rounds << std::endl
+                << "Pushes = " << stats.pushes << std::endl
+                << "Rank sum = " << global_sum << std::endl
+                << "PageRank Time = " << stats.time << std::endl;
+    }
+  }  // End PageRank Experiment
+  }  // END Main MPI
+  havoqgt::havoqgt_finalize();
+
+  return 0;
+}
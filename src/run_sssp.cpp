@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Roger Pearce <rpearce@llnl.gov>.
+ * LLNL-CODE-644630.
+ * All rights reserved.
+ *
+ * This file is part of HavoqGT, Version 0.1.
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ *
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ *
+ * Our Preamble Notice
+ *
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ *
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ *
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ *
+ */
+
+#include <havoqgt/single_source_shortest_path.hpp>
+#include <havoqgt/environment.hpp>
+#include <havoqgt/delegate_partitioned_graph.hpp>
+#include <havoqgt/distributed_db.hpp>
+#include <havoqgt/detail/hash.hpp>
+#include <assert.h>
+
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <functional>
+
+#include <boost/interprocess/managed_heap_memory.hpp>
+
+namespace hmpi = havoqgt::mpi;
+using namespace havoqgt::mpi;
+using namespace havoqgt;
+
+void usage()  {
+  if(havoqgt_env()->world_comm().rank() == 0) {
+    std::cerr << "Usage: -i <string> [-s <int>] [-d <int>] [-w <int>] [-p]\n"
+         << " -i <string>   - input graph base filename (required)\n"
+         << " -s <int>      - source vertex (Default is 0)\n"
+         << " -d <int>      - delta-stepping bucket width (Default is 0, automatic)\n"
+         << " -w <int>      - edge weights are drawn from [1, w] unless the graph\n"
+         << "                 stores its own (Default is 100)\n"
+         << " -p            - use the priority queue instead of delta-stepping\n"
+         << " -h            - print help and exit\n\n";
+  }
+}
+
+void parse_cmd_line(int argc, char** argv, std::string& input_filename,
+                    uint64_t& source_vertex, uint64_t& delta,
+                    uint32_t& max_weight, bool& priority_queue) {
+  if(havoqgt_env()->world_comm().rank() == 0) {
+    std::cout << "CMD line:";
+    for (int i=0; i<argc; ++i) {
+      std::cout << " " << argv[i];
+    }
+    std::cout << std::endl;
+  }
+
+  bool found_input_filename = false;
+  source_vertex = 0;
+  delta = 0;
+  max_weight = 100;
+  priority_queue = false;
+
+  char c;
+  bool prn_help = false;
+  while ((c = getopt(argc, argv, "i:s:d:w:ph ")) != -1) {
+     switch (c) {
+       case 'h':
+         prn_help = true;
+         break;
+       case 's':
+         source_vertex = strtoull(optarg, NULL, 10);
+         break;
+       case 'd':
+         delta = strtoull(optarg, NULL, 10);
+         break;
+       case 'w':
+         max_weight = std::max(1ul, strtoul(optarg, NULL, 10));
+         break;
+       case 'p':
+         priority_queue = true;
+         break;
+      case 'i':
+         found_input_filename = true;
+         input_filename = optarg;
+         break;
+      default:
+         std::cerr << "Unrecognized option: "<<c<<", ignore."<<std::endl;
+         prn_help = true;
+         break;
+     }
+   }
+   if (prn_help || !found_input_filename) {
+     usage();
+     exit(-1);
+   }
+}
+
+/// Weight of an edge, the same in both directions
+uint32_t edge_weight(uint64_t u, uint64_t v, uint32_t max_weight) {
+  uint64_t lo = std::min(u, v), hi = std::max(u, v);
+  uint32_t h = havoqgt::detail::hash32(uint32_t(lo) ^
+                                       havoqgt::detail::hash32(uint32_t(hi)));
+  return 1 + h % max_weight;
+}
+
+/// Runs SSSP from source_vertex with the given edge weights and reports it
+template <typename Graph, typename EdgeWeight>
+void run_sssp(Graph& graph, EdgeWeight& weights, uint64_t source_vertex,
+              uint64_t delta, bool priority_queue) {
+  typedef typename Graph::template vertex_data<uint64_t,
+      std::allocator<uint64_t> > path_data_type;
+  int mpi_rank = havoqgt_env()->world_comm().rank();
+
+  path_data_type path_data(graph);
+  path_data.reset(std::numeric_limits<uint64_t>::max());
+
+  typename Graph::vertex_locator source =
+    graph.label_to_locator(source_vertex);
+  hmpi::sssp_stats stats;
+  if (priority_queue) {
+    stats = hmpi::single_source_shortest_path(graph, path_data, weights,
+                                              source);
+  } else {
+    stats = hmpi::delta_stepping_shortest_path(graph, path_data, weights,
+                                               source, delta);
+  }
+
+  // Delegate paths are replicated; count them once, at the controller.
+  uint64_t local_reached(0), local_max(0);
+  typename Graph::vertex_iterator vitr;
+  for (vitr = graph.vertices_begin(); vitr != graph.vertices_end(); ++vitr) {
+    if (path_data[*vitr] != std::numeric_limits<uint64_t>::max()) {
+      ++local_reached;
+      local_max = std::max(local_max, path_data[*vitr]);
+    }
+  }
+  typename Graph::controller_iterator citr;
+  for (citr = graph.controller_begin(); citr != graph.controller_end(); ++citr) {
+    if (path_data[*citr] != std::numeric_limits<uint64_t>::max()) {
+      ++local_reached;
+      local_max = std::max(local_max, path_data[*citr]);
+    }
+  }
+  uint64_t global_reached = mpi_all_reduce(local_reached,
+      std::plus<uint64_t>(), MPI_COMM_WORLD);
+  uint64_t global_max = mpi_all_reduce(local_max,
+      std::greater<uint64_t>(), MPI_COMM_WORLD);
+
+  if (mpi_rank == 0) {
+    std::cout << "Delta = " << stats.delta << std::endl
+              << "Reached = " << global_reached << std::endl
+              << "Max Path = " << global_max << std::endl
+              << "Relaxations = " << stats.relaxations << std::endl
+              << "Improvements = " << stats.improvements << std::endl
+              << "SSSP Time = " << stats.time << std::endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  typedef havoqgt::distributed_db::segment_manager_type segment_manager_t;
+  typedef hmpi::delegate_partitioned_graph<segment_manager_t> graph_type;
+  typedef bip::managed_heap_memory::segment_manager heap_manager_t;
+
+  int mpi_rank(0), mpi_size(0);
+
+  havoqgt::havoqgt_init(&argc, &argv);
+  {
+  CHK_MPI(MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank));
+  CHK_MPI(MPI_Comm_size(MPI_COMM_WORLD, &mpi_size));
+  havoqgt::get_environment();
+
+  if (mpi_rank == 0) {
+    std::cout << "MPI initialized with " << mpi_size << " ranks." << std::endl;
+    havoqgt::get_environment().print();
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  std::string graph_input;
+  uint64_t source_vertex, delta;
+  uint32_t max_weight;
+  bool priority_queue;
+
+  parse_cmd_line(argc, argv, graph_input, source_vertex, delta, max_weight,
+                 priority_queue);
+
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  havoqgt::distributed_db ddb(havoqgt::db_open(), graph_input.c_str());
+
+  graph_type *graph = ddb.get_segment_manager()->
+    find<graph_type>("graph_obj").first;
+  assert(graph != nullptr);
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (mpi_rank == 0) {
+    std::cout << "Graph Loaded Ready." << std::endl;
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  // SSSP Experiment
+  if (graph->has_edge_weights()) {
+    if (mpi_rank == 0) {
+      std::cout << "Using the graph's edge weights." << std::endl;
+    }
+    run_sssp(*graph, *graph->edge_weights(), source_vertex, delta,
+             priority_queue);
+  } else {
+    typedef graph_type::edge_data<uint32_t, heap_manager_t> weight_data_type;
+
+    uint64_t local_edges = 0;
+    graph_type::vertex_iterator vitr;
+    for (vitr = graph->vertices_begin(); vitr != graph->vertices_end(); ++vitr) {
+      local_edges += graph->local_degree(*vitr);
+    }
+    for (uint64_t i = 0; i < graph->num_delegates(); ++i) {
+      local_edges += graph->local_degree(graph->delegate_locator(i));
+    }
+    bip::managed_heap_memory weight_heap(
+        local_edges * sizeof(uint32_t) * 2 + (1 << 20));
+    weight_data_type* weights = graph->create_edge_data<uint32_t>(
+        weight_heap.get_segment_manager());
+
+    for (vitr = graph->vertices_begin(); vitr != graph->vertices_end(); ++vitr) {
+      uint64_t label = graph->locator_to_label(*vitr);
+      for (graph_type::edge_iterator eitr = graph->edges_begin(*vitr);
+           eitr != graph->edges_end(*vitr); ++eitr) {
+        (*weights)[eitr] = edge_weight(label,
+            graph->locator_to_label(eitr.target()), max_weight);
+      }
+    }
+    for (uint64_t i = 0; i < graph->num_delegates(); ++i) {
+      graph_type::vertex_locator d = graph->delegate_locator(i);
+      uint64_t label = graph->locator_to_label(d);
+      for (graph_type::edge_iterator eitr = graph->edges_begin(d);
+           eitr != graph->edges_end(d); ++eitr) {
+        (*weights)[eitr] = edge_weight(label,
+            graph->locator_to_label(eitr.target()), max_weight);
+      }
+    }
+
+    run_sssp(*graph, *weights, source_vertex, delta, priority_queue);
+  }  // End SSSP Experiment
+  }  // END Main MPI
+  havoqgt::havoqgt_finalize();
+
+  return 0;
+}
@@ -127,11 +127,14 @@ int main(int argc, char** argv) {
   //graph->print_graph_statistics();
   MPI_Barrier(MPI_COMM_WORLD);
  
-  for(int i=0; i<100; ++i) {
-    uint64_t count = triangle_count(*graph, graph->label_to_locator(i));
-    if(mpi_rank == 0) {
-      std::cout << "Vertex " << i << " has " << count <<  " triangles." << std::endl;
-    }
+  MPI_Barrier(MPI_COMM_WORLD);
+  double time_start = MPI_Wtime();
+  uint64_t count = triangle_count_sorted(*graph);
+  MPI_Barrier(MPI_COMM_WORLD);
+  double time_end = MPI_Wtime();
+  if(mpi_rank == 0) {
+    std::cout << "Triangles = " << count << std::endl
+              << "Triangle Count Time = " << time_end - time_start << std::endl;
   }
 
   }  // END Main MPI
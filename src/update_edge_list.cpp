@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+ * Produced at the Lawrence Livermore National Laboratory.
+ * Written by Roger Pearce <rpearce@llnl.gov>.
+ * LLNL-CODE-644630.
+ * All rights reserved.
+ *
+ * This file is part of HavoqGT, Version 0.1.
+ * For details, see https://computation.llnl.gov/casc/dcca-pub/dcca/Downloads.html
+ *
+ * Please also read this link – Our Notice and GNU Lesser General Public License.
+ *   http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License (as published by the Free
+ * Software Foundation) version 2.1 dated February 1999.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the terms and conditions of the GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+ *
+ * Our Preamble Notice
+ *
+ * A. This notice is required to be provided under our contract with the
+ * U.S. Department of Energy (DOE). This work was produced at the Lawrence
+ * Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with the DOE.
+ *
+ * B. Neither the United States Government nor Lawrence Livermore National
+ * Security, LLC nor any of their employees, makes any warranty, express or
+ * implied, or assumes any liability or responsibility for the accuracy,
+ * completeness, or usefulness of any information, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately-owned rights.
+ *
+ * C. Also, reference herein to any specific commercial products, process, or
+ * services by trade name, trademark, manufacturer or otherwise does not
+ * necessarily constitute or imply its endorsement, recommendation, or favoring by
+ * the United States Government or Lawrence Livermore National Security, LLC. The
+ * views and opinions of authors expressed herein do not necessarily state or
+ * reflect those of the United States Government or Lawrence Livermore National
+ * Security, LLC, and shall not be used for advertising or product endorsement
+ * purposes.
+ *
+ */
+
+#include <havoqgt/delegate_partitioned_graph.hpp>
+#include <havoqgt/parallel_edge_list_reader.hpp>
+#include <havoqgt/binary_edge_list_reader.hpp>
+#include <havoqgt/environment.hpp>
+#include <havoqgt/distributed_db.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unistd.h>
+
+using namespace havoqgt;
+namespace hmpi = havoqgt::mpi;
+using namespace havoqgt::mpi;
+
+typedef havoqgt::distributed_db::segment_manager_type segment_manager_t;
+typedef hmpi::delegate_partitioned_graph<segment_manager_t> graph_type;
+
+void usage()  {
+  if(havoqgt_env()->world_comm().rank() == 0) {
+    std::cerr << "Usage: -i <string> [-g <int>] [-c] [file ...]\n"
+         << " -i <string>   - graph base filename to update (required)\n"
+         << " -g <int>      - MB to grow each rank's file by (Default is\n"
+         << "                 64 bytes per added edge per rank, plus 16 MB)\n"
+         << " -c            - compact the delta into the CSR before exiting\n"
+         << " -h            - print help and exit\n"
+         << "[file ...] - list of edge list files to add (text, or binary\n"
+         << "             files written by convert_edge_list)\n\n";
+  }
+}
+
+void parse_cmd_line(int argc, char** argv, std::string& graph_filename,
+                    uint64_t& grow_mb, bool& compact,
+                    std::vector< std::string >& input_filenames) {
+  if(havoqgt_env()->world_comm().rank() == 0) {
+    std::cout << "CMD line:";
+    for (int i=0; i<argc; ++i) {
+      std::cout << " " << argv[i];
+    }
+    std::cout << std::endl;
+  }
+
+  bool found_graph_filename = false;
+  grow_mb = 0;
+  compact = false;
+  input_filenames.clear();
+
+  char c;
+  bool prn_help = false;
+  while ((c = getopt(argc, argv, "i:g:ch ")) != -1) {
+     switch (c) {
+       case 'h':
+         prn_help = true;
+         break;
+       case 'g':
+         grow_mb = atoll(optarg);
+         break;
+       case 'c':
+         compact = true;
+         break;
+      case 'i':
+         found_graph_filename = true;
+         graph_filename = optarg;
+         break;
+      default:
+         std::cerr << "Unrecognized option: "<<c<<", ignore."<<std::endl;
+         prn_help = true;
+         break;
+     }
+   }
+   if (prn_help || !found_graph_filename) {
+     usage();
+     exit(-1);
+   }
+
+   for (int index = optind; index < argc; index++) {
+     input_filenames.push_back(argv[index]);
+   }
+}
+
+template <typename EdgeContainer>
+void update_graph(const std::string& graph_filename, uint64_t grow_mb,
+                  bool compact, EdgeContainer& edges) {
+  int mpi_rank = havoqgt_env()->world_comm().rank();
+  int mpi_size = havoqgt_env()->world_comm().size();
+
+  uint64_t num_edges = mpi_all_reduce(uint64_t(edges.size()),
+      std::plus<uint64_t>(), MPI_COMM_WORLD);
+  uint64_t grow_bytes = grow_mb > 0 ? grow_mb << 20
+      : 64 * (num_edges / mpi_size + 1) + (uint64_t(16) << 20);
+  if (mpi_rank == 0) {
+    std::cout << "Adding " << num_edges << " edges, growing each rank by "
+              << grow_bytes << " bytes." << std::endl;
+  }
+
+  havoqgt::distributed_db ddb(havoqgt::db_open(), graph_filename.c_str(),
+                              grow_bytes);
+  segment_manager_t* segment_manager = ddb.get_segment_manager();
+  bip::allocator<void, segment_manager_t> alloc_inst(segment_manager);
+
+  graph_type *graph = segment_manager->find<graph_type>("graph_obj").first;
+  if (graph == nullptr) {
+    HAVOQGT_ERROR_MSG("graph_obj not found.");
+  }
+
+  graph->add_edges(alloc_inst, MPI_COMM_WORLD, edges);
+  if (compact) {
+    LogStep logstep("compact", MPI_COMM_WORLD, mpi_rank);
+    graph->compact(alloc_inst);
+  }
+
+  uint64_t delta = mpi_all_reduce(uint64_t(graph->delta_size()),
+      std::plus<uint64_t>(), MPI_COMM_WORLD);
+  if (mpi_rank == 0) {
+    std::cout << "Graph updated, " << delta << " edges in the delta."
+              << std::endl;
+  }
+  havoqgt_env()->world_comm().barrier();
+}
+
+int main(int argc, char** argv) {
+
+  havoqgt_init(&argc, &argv);
+  {
+    int mpi_rank = havoqgt_env()->world_comm().rank();
+    int mpi_size = havoqgt_env()->world_comm().size();
+    havoqgt::get_environment();
+
+    if (mpi_rank == 0) {
+      std::cout << "MPI initialized with " << mpi_size << " ranks." << std::endl;
+      havoqgt::get_environment().print();
+    }
+    havoqgt_env()->world_comm().barrier();
+
+    std::string                graph_filename;
+    uint64_t                   grow_mb;
+    bool                       compact;
+    std::vector< std::string > input_filenames;
+
+    parse_cmd_line(argc, argv, graph_filename, grow_mb, compact,
+                   input_filenames);
+
+    if (!input_filenames.empty() &&
+        havoqgt::binary_edge_list_reader::is_binary_file(input_filenames[0])) {
+      havoqgt::binary_edge_list_reader belr(input_filenames);
+      update_graph(graph_filename, grow_mb, compact, belr);
+    } else {
+      havoqgt::parallel_edge_list_reader pelr(input_filenames);
+      update_graph(graph_filename, grow_mb, compact, pelr);
+    }
+  } //END Main MPI
+  havoqgt_finalize();
+  return 0;
+}
@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+#include <havoqgt/environment.hpp>
+#include <havoqgt/delegate_partitioned_graph.hpp>
+
+#include <boost/interprocess/managed_heap_memory.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace havoqgt { namespace test {
+
+namespace bip = boost::interprocess;
+typedef bip::managed_heap_memory::segment_manager segment_manager_t;
+typedef havoqgt::mpi::delegate_partitioned_graph<segment_manager_t> graph_type;
+typedef graph_type::vertex_locator vertex_locator;
+
+static const uint64_t s_num_vertices = 256;
+static const uint64_t s_delegate_threshold = 32;
+static const int      s_num_threads = 4;
+static const uint64_t s_updates_per_thread = 500;
+
+/// A ring plus a star around vertex 1, which becomes a delegate.  Built once
+/// by every rank, as construction is collective.
+graph_type& test_graph() {
+  static bip::managed_heap_memory heap(uint64_t(1) << 24);
+  static graph_type* graph = NULL;
+  if(graph == NULL) {
+    const int mpi_rank = havoqgt_env()->world_comm().rank();
+    const int mpi_size = havoqgt_env()->world_comm().size();
+    std::vector< std::pair<uint64_t, uint64_t> > edges;
+    for(uint64_t v = 2; v < s_num_vertices; ++v) {
+      if(int(v % mpi_size) != mpi_rank) continue;
+      const uint64_t next = v + 1 < s_num_vertices ? v + 1 : 2;
+      edges.push_back(std::make_pair(uint64_t(1), v));
+      edges.push_back(std::make_pair(v, uint64_t(1)));
+      edges.push_back(std::make_pair(v, next));
+      edges.push_back(std::make_pair(next, v));
+    }
+    bip::allocator<void, segment_manager_t> alloc_inst(
+        heap.get_segment_manager());
+    graph = heap.construct<graph_type>("graph_obj")
+        (alloc_inst, MPI_COMM_WORLD, edges, s_num_vertices - 1,
+         s_delegate_threshold);
+  }
+  return *graph;
+}
+
+/// This rank's owned vertices followed by every delegate
+std::vector<vertex_locator> local_vertices(graph_type& g) {
+  std::vector<vertex_locator> to_return;
+  for(graph_type::vertex_iterator vitr = g.vertices_begin();
+      vitr != g.vertices_end(); ++vitr) {
+    to_return.push_back(*vitr);
+  }
+  for(uint64_t i = 0; i < g.num_delegates(); ++i) {
+    to_return.push_back(g.delegate_locator(i));
+  }
+  return to_return;
+}
+
+/// Runs f(thread_id) on s_num_threads threads
+template <typename Function>
+void run_threads(Function f) {
+  std::vector<std::thread> threads;
+  for(int t = 0; t < s_num_threads; ++t) {
+    threads.push_back(std::thread(f, t));
+  }
+  for(size_t t = 0; t < threads.size(); ++t) {
+    threads[t].join();
+  }
+}
+
+TEST(atomic_vertex_data, graph_has_owned_and_delegate_vertices) {
+  graph_type& g = test_graph();
+  EXPECT_EQ(1u, g.num_delegates());
+  EXPECT_TRUE(g.delegate_locator(0).is_delegate());
+}
+
+TEST(atomic_vertex_data, fetch_add_uint64) {
+  graph_type& g = test_graph();
+  graph_type::atomic_vertex_data<uint64_t, std::allocator<uint64_t> > data(g);
+  data.reset(0);
+  const std::vector<vertex_locator> vertices = local_vertices(g);
+
+  // Each thread records which prior values it saw; together they must be
+  // exactly 0 .. total-1 for every vertex.
+  std::vector< std::vector<uint64_t> > seen(s_num_threads);
+  run_threads([&](int t) {
+    for(uint64_t i = 0; i < s_updates_per_thread; ++i) {
+      for(size_t v = 0; v < vertices.size(); ++v) {
+        uint64_t prior = data.fetch_add(vertices[v], 1);
+        if(v == 0) {
+          seen[t].push_back(prior);
+        }
+      }
+    }
+  });
+
+  const uint64_t total = s_num_threads * s_updates_per_thread;
+  for(size_t v = 0; v < vertices.size(); ++v) {
+    EXPECT_EQ(total, data.load(vertices[v]));
+  }
+  std::vector<uint64_t> all_seen;
+  for(int t = 0; t < s_num_threads; ++t) {
+    all_seen.insert(all_seen.end(), seen[t].begin(), seen[t].end());
+  }
+  std::sort(all_seen.begin(), all_seen.end());
+  ASSERT_EQ(total, all_seen.size());
+  for(uint64_t i = 0; i < total; ++i) {
+    EXPECT_EQ(i, all_seen[i]);
+  }
+}
+
+TEST(atomic_vertex_data, fetch_add_double) {
+  graph_type& g = test_graph();
+  graph_type::atomic_vertex_data<double, std::allocator<double> > data(g);
+  data.reset(1.0);
+  const std::vector<vertex_locator> vertices = local_vertices(g);
+
+  run_threads([&](int) {
+    for(uint64_t i = 0; i < s_updates_per_thread; ++i) {
+      for(size_t v = 0; v < vertices.size(); ++v) {
+        data.fetch_add(vertices[v], 0.25);
+      }
+    }
+  });
+
+  // Multiples of 0.25 add exactly.
+  const double expected = 1.0 + 0.25 * s_num_threads * s_updates_per_thread;
+  for(size_t v = 0; v < vertices.size(); ++v) {
+    EXPECT_EQ(expected, data.load(vertices[v]));
+  }
+}
+
+TEST(atomic_vertex_data, fetch_min) {
+  graph_type& g = test_graph();
+  graph_type::atomic_vertex_data<uint64_t, std::allocator<uint64_t> > data(g);
+  data.reset(std::numeric_limits<uint64_t>::max());
+  const std::vector<vertex_locator> vertices = local_vertices(g);
+
+  // Thread t offers t, t + s_num_threads, ... in decreasing order, so every
+  // value lowers some vertex at most once and the minimum is 0.
+  std::vector<uint64_t> lowered(s_num_threads, 0);
+  run_threads([&](int t) {
+    for(uint64_t i = s_updates_per_thread; i-- > 0; ) {
+      const uint64_t val = i * s_num_threads + t;
+      for(size_t v = 0; v < vertices.size(); ++v) {
+        if(data.fetch_min(vertices[v], val) > val) {
+          ++lowered[t];
+        }
+      }
+    }
+  });
+
+  for(size_t v = 0; v < vertices.size(); ++v) {
+    EXPECT_EQ(0u, data.load(vertices[v]));
+  }
+  // A value above the current minimum leaves it unchanged.
+  EXPECT_EQ(0u, data.fetch_min(vertices[0], 5));
+  EXPECT_EQ(0u, data.load(vertices[0]));
+  uint64_t total_lowered = 0;
+  for(int t = 0; t < s_num_threads; ++t) {
+    total_lowered += lowered[t];
+  }
+  EXPECT_GE(total_lowered, vertices.size());
+  EXPECT_LE(total_lowered,
+            vertices.size() * s_num_threads * s_updates_per_thread);
+}
+
+TEST(atomic_vertex_data, compare_exchange) {
+  graph_type& g = test_graph();
+  graph_type::atomic_vertex_data<uint64_t, std::allocator<uint64_t> > data(g);
+  data.reset(0);
+  const std::vector<vertex_locator> vertices = local_vertices(g);
+
+  // Failure reports the current value
+  uint64_t expected = 7;
+  EXPECT_FALSE(data.compare_exchange(vertices[0], expected, 9));
+  EXPECT_EQ(0u, expected);
+  EXPECT_TRUE(data.compare_exchange(vertices[0], expected, 0));
+
+  // An increment built from compare_exchange loses no update.
+  run_threads([&](int) {
+    for(uint64_t i = 0; i < s_updates_per_thread; ++i) {
+      for(size_t v = 0; v < vertices.size(); ++v) {
+        uint64_t current = data.load(vertices[v]);
+        while(!data.compare_exchange(vertices[v], current, current + 1)) { }
+      }
+    }
+  });
+
+  for(size_t v = 0; v < vertices.size(); ++v) {
+    EXPECT_EQ(uint64_t(s_num_threads) * s_updates_per_thread,
+              data.load(vertices[v]));
+  }
+
+  // Delegate replicas are per rank; store and load see the local copy.
+  const vertex_locator delegate = g.delegate_locator(0);
+  data.store(delegate, 42);
+  EXPECT_EQ(42u, data.load(delegate));
+}
+
+}} //end namespace havoqgt::test
+
+//mpi main for gteset
+GTEST_API_ int main(int argc, char **argv) {
+  havoqgt::havoqgt_init(&argc, &argv);
+  std::cout << "Running main() from gtest_main.cc\n";
+
+  testing::InitGoogleTest(&argc, argv);
+  int to_return = RUN_ALL_TESTS();
+  havoqgt::havoqgt_finalize();
+  return to_return;
+}
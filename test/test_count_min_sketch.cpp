@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <havoqgt/environment.hpp>
+#include <havoqgt/detail/count_min_sketch.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace havoqgt { namespace test {
+
+using havoqgt::detail::count_min_sketch;
+
+static const uint64_t s_num_keys = 5000;
+static const size_t   s_width = 1024;
+static const size_t   s_depth = 4;
+
+/// Skewed counts: every 97th key is heavy.  Depends on the rank so the
+/// reduction has something to sum.
+uint64_t count_on_rank(uint64_t key, int rank) {
+  return (key % 97 == 0 ? 1000 : key % 5 + 1) * uint64_t(rank + 1);
+}
+
+TEST(count_min_sketch, bytes) {
+  count_min_sketch sketch(s_width, s_depth);
+  EXPECT_EQ(s_width * s_depth * sizeof(uint64_t), sketch.bytes());
+}
+
+TEST(count_min_sketch, few_keys_are_exact) {
+  count_min_sketch sketch(1 << 16, s_depth);
+  for(uint64_t key = 0; key < 10; ++key) {
+    sketch.add(key * 12345, key + 1);
+  }
+  for(uint64_t key = 0; key < 10; ++key) {
+    EXPECT_EQ(key + 1, sketch.estimate(key * 12345));
+  }
+}
+
+TEST(count_min_sketch, all_reduce_within_error_bound) {
+  const int mpi_rank = havoqgt_env()->world_comm().rank();
+  const int mpi_size = havoqgt_env()->world_comm().size();
+
+  count_min_sketch sketch(s_width, s_depth);
+  for(uint64_t key = 0; key < s_num_keys; ++key) {
+    sketch.add(key, count_on_rank(key, mpi_rank));
+  }
+  sketch.all_reduce(MPI_COMM_WORLD);
+
+  std::vector<uint64_t> exact(s_num_keys, 0);
+  uint64_t total = 0;
+  for(uint64_t key = 0; key < s_num_keys; ++key) {
+    for(int rank = 0; rank < mpi_size; ++rank) {
+      exact[key] += count_on_rank(key, rank);
+    }
+    total += exact[key];
+  }
+
+  // Never undercounts; overcounts by total / width per row in expectation,
+  // and by more than e * total / width with probability at most e^-depth.
+  const double per_row = double(total) / s_width;
+  double sum_over = 0;
+  uint64_t num_large = 0;
+  for(uint64_t key = 0; key < s_num_keys; ++key) {
+    const uint64_t est = sketch.estimate(key);
+    ASSERT_GE(est, exact[key]);
+    sum_over += est - exact[key];
+    if(est - exact[key] > std::exp(1.0) * per_row) {
+      ++num_large;
+    }
+  }
+  EXPECT_LE(sum_over / s_num_keys, per_row);
+  EXPECT_LE(double(num_large) / s_num_keys, 2 * std::exp(-double(s_depth)));
+}
+
+}} //end namespace havoqgt::test
+
+//mpi main for gteset
+GTEST_API_ int main(int argc, char **argv) {
+  havoqgt::havoqgt_init(&argc, &argv);
+  std::cout << "Running main() from gtest_main.cc\n";
+
+  testing::InitGoogleTest(&argc, argv);
+  int to_return = RUN_ALL_TESTS();
+  havoqgt::havoqgt_finalize();
+  return to_return;
+}
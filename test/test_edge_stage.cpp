@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <havoqgt/detail/edge_stage.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace havoqgt { namespace test {
+
+using havoqgt::detail::edge_stage;
+
+typedef std::pair<uint64_t, uint64_t> edge_type;
+
+/// Sorted runs of small deltas mixed with full-width labels
+std::vector<edge_type> random_edges(size_t size, uint64_t seed) {
+  std::mt19937_64 gen(seed);
+  std::vector<edge_type> to_return;
+  uint64_t source = 0;
+  for(size_t i = 0; i < size; ++i) {
+    source = (i % 7 == 0) ? gen() : source + gen() % 3;
+    to_return.push_back(edge_type(source, i % 5 == 0 ? gen() : gen() % 1000));
+  }
+  return to_return;
+}
+
+/// Stages edges under dir and reads them back twice
+void check(const std::vector<edge_type>& edges, const std::string& dir) {
+  edge_stage stage(dir);
+  for(size_t i = 0; i < edges.size(); ++i) {
+    stage.push(edges[i]);
+  }
+  stage.finish();
+  EXPECT_EQ(edges.size(), stage.size());
+  for(int pass = 0; pass < 2; ++pass) {
+    std::vector<edge_type> read(stage.begin(), stage.end());
+    EXPECT_TRUE(edges == read);
+  }
+}
+
+TEST(edge_stage, empty) {
+  check(std::vector<edge_type>(), "");
+  check(std::vector<edge_type>(), "/tmp");
+}
+
+TEST(edge_stage, in_memory) {
+  check(random_edges(1, 1), "");
+  check(random_edges(100000, 2), "");
+}
+
+TEST(edge_stage, scratch_file) {
+  check(random_edges(1, 3), "/tmp");
+  check(random_edges(100000, 4), "/tmp");
+}
+
+TEST(edge_stage, varint_compressed) {
+  edge_stage stage("");
+  for(uint64_t i = 0; i < 1000; ++i) {
+    stage.push(edge_type(i / 10, i / 10 + i % 10));
+  }
+  stage.finish();
+  EXPECT_EQ(2000u, stage.bytes());
+}
+
+}} //end namespace havoqgt::test
@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+#include <havoqgt/detail/message_codec.hpp>
+
+#include <cstdlib>
+#include <vector>
+
+namespace havoqgt { namespace test {
+
+using havoqgt::detail::varint_encode;
+using havoqgt::detail::varint_decode;
+using havoqgt::detail::zigzag_encode;
+using havoqgt::detail::zigzag_decode;
+using havoqgt::detail::lz_block_codec;
+
+/// Stand-in for vertex_locator with the interface the codec needs
+struct test_locator {
+  uint32_t m_flags;
+  uint32_t m_owner;
+  uint64_t m_local_id;
+
+  uint32_t flags() const { return m_flags; }
+  uint32_t owner() const { return m_owner; }
+  uint64_t local_id() const { return m_local_id; }
+
+  static test_locator from_parts(uint32_t flags, uint32_t owner,
+                                 uint64_t local_id) {
+    test_locator to_return = {flags, owner, local_id};
+    return to_return;
+  }
+
+  friend bool operator<(const test_locator& x, const test_locator& y) {
+    if(x.m_flags != y.m_flags) return x.m_flags < y.m_flags;
+    if(x.m_owner != y.m_owner) return x.m_owner < y.m_owner;
+    return x.m_local_id < y.m_local_id;
+  }
+};
+
+/// A routed message: locator between two payload fields
+struct test_msg {
+  uint64_t     m_parent;
+  test_locator m_vertex;
+  uint64_t     m_level;
+
+  test_locator& locator() { return m_vertex; }
+  const test_locator& locator() const { return m_vertex; }
+};
+
+typedef havoqgt::detail::locator_message_codec<test_msg> codec_type;
+
+void expect_same(const test_msg& a, const test_msg& b) {
+  EXPECT_EQ(a.m_parent, b.m_parent);
+  EXPECT_EQ(a.m_level, b.m_level);
+  EXPECT_EQ(a.m_vertex.m_flags, b.m_vertex.m_flags);
+  EXPECT_EQ(a.m_vertex.m_owner, b.m_vertex.m_owner);
+  EXPECT_EQ(a.m_vertex.m_local_id, b.m_vertex.m_local_id);
+}
+
+/// Encodes msgs, which encode() sorts in place, and checks the decode
+size_t round_trip(std::vector<test_msg>& msgs) {
+  std::vector<uint8_t> encoded(codec_type::max_encoded_size(msgs.size()));
+  size_t bytes = codec_type::encode(msgs.data(), msgs.size(), encoded.data());
+  EXPECT_LE(bytes, encoded.size());
+
+  std::vector<test_msg> decoded(msgs.size() + 1);
+  EXPECT_EQ(msgs.size(), codec_type::decode(encoded.data(), decoded.data()));
+  for(size_t i=0; i<msgs.size(); ++i) {
+    expect_same(msgs[i], decoded[i]);
+  }
+  return bytes;
+}
+
+/// Compresses in and checks that it decompresses to the same bytes
+void lz_round_trip(const std::vector<uint8_t>& in) {
+  std::vector<uint8_t> compressed(in.size() * 2 + 64);
+  size_t bytes = lz_block_codec::compress(in.data(), in.size(),
+                                          compressed.data(), compressed.size());
+  ASSERT_GT(bytes, 0u);
+  std::vector<uint8_t> out(in.size() + 1);
+  EXPECT_EQ(in.size(), lz_block_codec::decompress(compressed.data(), bytes,
+                                                   out.data()));
+  out.resize(in.size());
+  EXPECT_EQ(in, out);
+}
+
+test_msg make_msg(uint32_t flags, uint32_t owner, uint64_t local_id,
+                  uint64_t parent, uint64_t level) {
+  test_msg msg;
+  msg.m_parent = parent;
+  msg.m_vertex = test_locator::from_parts(flags, owner, local_id);
+  msg.m_level  = level;
+  return msg;
+}
+
+TEST(message_codec, varint_round_trip) {
+  const uint64_t values[] = {0, 1, 127, 128, 300, uint64_t(1) << 35,
+                             ~uint64_t(0)};
+  for(uint64_t value : values) {
+    uint8_t buf[havoqgt::detail::varint_max_bytes];
+    uint8_t* end = varint_encode(value, buf);
+    EXPECT_LE(size_t(end - buf), havoqgt::detail::varint_max_bytes);
+    uint64_t decoded;
+    EXPECT_EQ(end, varint_decode(buf, decoded));
+    EXPECT_EQ(value, decoded);
+  }
+}
+
+TEST(message_codec, zigzag_round_trip) {
+  const uint64_t values[] = {0, 1, 5, 1000, ~uint64_t(0)};
+  for(uint64_t from : values) {
+    for(uint64_t to : values) {
+      EXPECT_EQ(to, zigzag_decode(from, zigzag_encode(from, to)));
+    }
+  }
+  EXPECT_EQ(1u, zigzag_encode(10, 9));
+  EXPECT_EQ(2u, zigzag_encode(9, 10));
+}
+
+TEST(message_codec, lz_empty) {
+  lz_round_trip(std::vector<uint8_t>());
+}
+
+TEST(message_codec, lz_repetitive) {
+  std::vector<uint8_t> in;
+  for(int i=0; i<5000; ++i) {
+    in.push_back(uint8_t(i % 7));
+  }
+  lz_round_trip(in);
+
+  std::vector<uint8_t> compressed(in.size());
+  EXPECT_LT(lz_block_codec::compress(in.data(), in.size(), compressed.data(),
+                                     compressed.size()), in.size() / 10);
+}
+
+TEST(message_codec, lz_incompressible) {
+  std::srand(1);
+  std::vector<uint8_t> in(4096);
+  for(size_t i=0; i<in.size(); ++i) {
+    in[i] = uint8_t(std::rand() >> 7);
+  }
+  lz_round_trip(in);
+
+  // Capacity of the input size is what the mailbox allows; this overflows.
+  std::vector<uint8_t> compressed(in.size());
+  EXPECT_EQ(0u, lz_block_codec::compress(in.data(), in.size(),
+                                         compressed.data(), compressed.size()));
+}
+
+TEST(message_codec, locator_codec_empty) {
+  std::vector<test_msg> msgs;
+  EXPECT_EQ(1u, round_trip(msgs));
+}
+
+TEST(message_codec, locator_codec_single_message) {
+  std::vector<test_msg> msgs(1, make_msg(5, 3, 123456789, 42, 7));
+  round_trip(msgs);
+}
+
+TEST(message_codec, locator_codec_many_messages) {
+  std::srand(2);
+  std::vector<test_msg> msgs;
+  for(int i=0; i<1000; ++i) {
+    msgs.push_back(make_msg(std::rand() % 8, std::rand() % 4,
+                            std::rand() % 100000, std::rand() % 3,
+                            uint64_t(std::rand()) << 20));
+  }
+  // Equal locators must survive too
+  msgs.push_back(msgs[0]);
+  round_trip(msgs);
+}
+
+TEST(message_codec, locator_codec_then_lz) {
+  std::vector<test_msg> msgs;
+  for(int i=0; i<1024; ++i) {
+    msgs.push_back(make_msg(0, 1, i * 3, 99, 4));
+  }
+  std::vector<test_msg> sorted = msgs;
+  std::vector<uint8_t> encoded(codec_type::max_encoded_size(msgs.size()));
+  size_t bytes = codec_type::encode(msgs.data(), msgs.size(), encoded.data());
+  EXPECT_LT(bytes, msgs.size() * sizeof(test_msg));
+
+  std::vector<uint8_t> compressed(bytes);
+  size_t lz_bytes = lz_block_codec::compress(encoded.data(), bytes,
+                                             compressed.data(), bytes);
+  ASSERT_GT(lz_bytes, 0u);
+  std::vector<uint8_t> decompressed(bytes);
+  EXPECT_EQ(bytes, lz_block_codec::decompress(compressed.data(), lz_bytes,
+                                              decompressed.data()));
+  std::vector<test_msg> decoded(msgs.size());
+  EXPECT_EQ(msgs.size(), codec_type::decode(decompressed.data(),
+                                            decoded.data()));
+  for(size_t i=0; i<msgs.size(); ++i) {
+    expect_same(sorted[i], decoded[i]);
+  }
+}
+
+}} //end namespace havoqgt::test
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <havoqgt/detail/radix_sort.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace havoqgt { namespace test {
+
+using havoqgt::detail::radix_sort_pairs;
+using havoqgt::detail::significant_bits;
+
+typedef std::pair<uint64_t, uint64_t> pair_type;
+
+/// Pairs with first below 2^first_bits and second below 2^second_bits
+std::vector<pair_type> random_pairs(size_t size, int first_bits,
+                                    int second_bits, uint64_t seed) {
+  std::mt19937_64 gen(seed);
+  const uint64_t first_mask = first_bits == 64 ? ~uint64_t(0)
+                            : (uint64_t(1) << first_bits) - 1;
+  const uint64_t second_mask = second_bits == 64 ? ~uint64_t(0)
+                             : (uint64_t(1) << second_bits) - 1;
+  std::vector<pair_type> to_return(size);
+  for(size_t i = 0; i < size; ++i) {
+    to_return[i] = pair_type(gen() & first_mask, gen() & second_mask);
+  }
+  return to_return;
+}
+
+/// radix_sort_pairs against std::sort
+void check(const std::vector<pair_type>& data, int first_bits,
+           int second_bits, size_t num_threads) {
+  std::vector<pair_type> expected = data;
+  std::sort(expected.begin(), expected.end());
+  std::vector<pair_type> sorted = data;
+  radix_sort_pairs(sorted, first_bits, second_bits, num_threads);
+  EXPECT_TRUE(expected == sorted);
+}
+
+/// An edge with a payload that must travel with it
+struct payload_edge : public pair_type {
+  payload_edge(uint64_t s, uint64_t t, uint64_t p)
+    : pair_type(s, t), m_payload(p) { }
+  payload_edge() : m_payload(0) { }
+  uint64_t m_payload;
+};
+
+bool pair_less(const payload_edge& a, const payload_edge& b) {
+  return static_cast<const pair_type&>(a) < static_cast<const pair_type&>(b);
+}
+
+TEST(radix_sort, significant_bits) {
+  EXPECT_EQ(0, significant_bits(0));
+  EXPECT_EQ(1, significant_bits(1));
+  EXPECT_EQ(2, significant_bits(3));
+  EXPECT_EQ(11, significant_bits(1024));
+  EXPECT_EQ(64, significant_bits(~uint64_t(0)));
+}
+
+TEST(radix_sort, small_inputs) {
+  check(std::vector<pair_type>(), 10, 10, 1);
+  check(random_pairs(1, 10, 10, 1), 10, 10, 1);
+  check(random_pairs(255, 10, 10, 2), 10, 10, 1);
+  check(random_pairs(256, 10, 10, 3), 10, 10, 1);
+}
+
+TEST(radix_sort, packed_random) {
+  check(random_pairs(10000, 20, 20, 4), 20, 20, 1);
+  check(random_pairs(10000, 32, 32, 5), 32, 32, 1);
+  check(random_pairs(10000, 0, 64, 6), 0, 64, 1);
+  check(random_pairs(10000, 64, 0, 7), 64, 0, 1);
+}
+
+TEST(radix_sort, unpacked_random) {
+  check(random_pairs(10000, 40, 40, 8), 40, 40, 1);
+  check(random_pairs(10000, 64, 64, 9), 64, 64, 1);
+}
+
+TEST(radix_sort, duplicate_heavy) {
+  check(random_pairs(10000, 2, 3, 10), 2, 3, 1);
+  check(random_pairs(10000, 40, 40, 11), 40, 40, 1);
+  std::vector<pair_type> same(10000, pair_type(5, 9));
+  check(same, 20, 20, 1);
+  check(same, 40, 40, 1);
+
+  // Few distinct wide keys, repeated
+  std::vector<pair_type> wide = random_pairs(16, 48, 48, 12);
+  std::vector<pair_type> repeated;
+  for(size_t i = 0; i < 5000; ++i) {
+    repeated.push_back(wide[(i * 7) % wide.size()]);
+  }
+  check(repeated, 48, 48, 1);
+}
+
+TEST(radix_sort, multithreaded) {
+  const size_t size = size_t(1) << 17;
+  check(random_pairs(size, 24, 24, 13), 24, 24, 2);
+  check(random_pairs(size, 24, 24, 14), 24, 24, 4);
+  check(random_pairs(size, 64, 64, 15), 64, 64, 4);
+  check(random_pairs(size, 3, 3, 16), 3, 3, 4);
+}
+
+TEST(radix_sort, record_payload) {
+  // Unique keys below min_radix use std::sort; payloads follow keys.
+  std::vector<payload_edge> small;
+  for(uint64_t i = 0; i < 100; ++i) {
+    small.push_back(payload_edge((i * 37) % 100, i, i * 3));
+  }
+  radix_sort_pairs(small, 7, 7);
+  for(size_t i = 0; i < small.size(); ++i) {
+    EXPECT_EQ(i, small[i].first);
+    EXPECT_EQ(small[i].second * 3, small[i].m_payload);
+  }
+}
+
+TEST(radix_sort, record_stable) {
+  const size_t threads[] = {1, 4};
+  for(size_t num_threads : threads) {
+    std::vector<pair_type> keys = random_pairs(size_t(1) << 17, 6, 6, 17);
+    std::vector<payload_edge> data;
+    for(size_t i = 0; i < keys.size(); ++i) {
+      data.push_back(payload_edge(keys[i].first, keys[i].second, i));
+    }
+    std::vector<payload_edge> expected = data;
+    std::stable_sort(expected.begin(), expected.end(), pair_less);
+    radix_sort_pairs(data, 6, 6, num_threads);
+    ASSERT_EQ(expected.size(), data.size());
+    for(size_t i = 0; i < data.size(); ++i) {
+      ASSERT_EQ(expected[i].first, data[i].first);
+      ASSERT_EQ(expected[i].second, data[i].second);
+      ASSERT_EQ(expected[i].m_payload, data[i].m_payload);
+    }
+  }
+}
+
+}} //end namespace havoqgt::test
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <havoqgt/detail/sorted_intersection.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <vector>
+
+namespace havoqgt { namespace test {
+
+using havoqgt::detail::merge_intersection_count;
+using havoqgt::detail::gallop_intersection_count;
+using havoqgt::detail::gallop_lower_bound;
+using havoqgt::detail::sorted_intersection_count;
+
+/// size sorted values below range, distinct if unique is set
+std::vector<uint64_t> random_sorted(size_t size, uint64_t range, bool unique) {
+  std::vector<uint64_t> to_return;
+  for(size_t i=0; i<size; ++i) {
+    to_return.push_back(uint64_t(std::rand()) % range);
+  }
+  std::sort(to_return.begin(), to_return.end());
+  if(unique) {
+    to_return.erase(std::unique(to_return.begin(), to_return.end()),
+                    to_return.end());
+  }
+  return to_return;
+}
+
+uint64_t reference_count(const std::vector<uint64_t>& a,
+                         const std::vector<uint64_t>& b) {
+  std::vector<uint64_t> common;
+  std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                        std::back_inserter(common));
+  return common.size();
+}
+
+/// All three counts against std::set_intersection
+void check(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b) {
+  const uint64_t expected = reference_count(a, b);
+  EXPECT_EQ(expected, merge_intersection_count(a.begin(), a.end(),
+                                               b.begin(), b.end()));
+  EXPECT_EQ(expected, gallop_intersection_count(a.begin(), a.end(),
+                                                b.begin(), b.end()));
+  EXPECT_EQ(expected, sorted_intersection_count(a.begin(), a.end(),
+                                                b.begin(), b.end()));
+}
+
+TEST(sorted_intersection, empty_ranges) {
+  std::vector<uint64_t> empty, some;
+  some.push_back(1);
+  some.push_back(4);
+  check(empty, empty);
+  check(empty, some);
+  check(some, empty);
+}
+
+TEST(sorted_intersection, similar_lengths) {
+  std::srand(1);
+  for(int trial=0; trial<50; ++trial) {
+    std::vector<uint64_t> a = random_sorted(200, 1000, true);
+    std::vector<uint64_t> b = random_sorted(300, 1000, true);
+    check(a, b);
+  }
+}
+
+TEST(sorted_intersection, short_in_long) {
+  std::srand(2);
+  for(int trial=0; trial<50; ++trial) {
+    std::vector<uint64_t> a = random_sorted(10, 100000, true);
+    std::vector<uint64_t> b = random_sorted(5000, 100000, true);
+    // Make sure some elements match, including the first and last of b
+    a.push_back(b.front());
+    a.push_back(b.back());
+    std::sort(a.begin(), a.end());
+    a.erase(std::unique(a.begin(), a.end()), a.end());
+    check(a, b);
+  }
+}
+
+TEST(sorted_intersection, duplicates_in_second_range) {
+  std::srand(3);
+  for(int trial=0; trial<50; ++trial) {
+    std::vector<uint64_t> a = random_sorted(20, 50, true);
+    std::vector<uint64_t> b = random_sorted(2000, 50, false);
+    check(a, b);
+  }
+}
+
+TEST(sorted_intersection, gallop_lower_bound_matches_std) {
+  std::srand(4);
+  std::vector<uint64_t> values = random_sorted(1000, 3000, false);
+  for(uint64_t x = 0; x < 3001; x += 7) {
+    for(size_t start = 0; start < values.size(); start += 97) {
+      EXPECT_EQ(std::lower_bound(values.begin() + start, values.end(), x),
+                gallop_lower_bound(values.begin() + start, values.end(), x));
+    }
+  }
+}
+
+}} //end namespace havoqgt::test
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <havoqgt/environment.hpp>
+#include <havoqgt/delegate_partitioned_graph.hpp>
+#include <havoqgt/triangle_count.hpp>
+
+#include <boost/interprocess/managed_heap_memory.hpp>
+
+#include <random>
+#include <set>
+#include <vector>
+
+namespace havoqgt { namespace test {
+
+namespace bip = boost::interprocess;
+typedef bip::managed_heap_memory::segment_manager segment_manager_t;
+typedef havoqgt::mpi::delegate_partitioned_graph<segment_manager_t> graph_type;
+typedef std::pair<uint64_t, uint64_t> edge_type;
+
+static const uint64_t s_num_vertices = 2000;
+static const uint64_t s_num_edges = 20000;
+
+/// Every rank's edges, undirected, with skewed endpoints so low labels
+/// become delegates.  Edges repeat and include self loops; the repeats of
+/// an edge between delegates are split over several ranks by overflow.
+std::vector<edge_type> all_edges() {
+  std::mt19937_64 gen(7);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::vector<edge_type> to_return;
+  for(uint64_t i = 0; i < s_num_edges; ++i) {
+    const double x = uniform(gen), y = uniform(gen);
+    uint64_t u = 1 + uint64_t(x * x * x * x * (s_num_vertices - 1));
+    uint64_t v = 1 + uint64_t(y * y * y * (s_num_vertices - 1));
+    to_return.push_back(edge_type(u, v));
+  }
+  return to_return;
+}
+
+/// Triangles among the distinct edges, without self loops
+uint64_t reference_count(const std::vector<edge_type>& edges) {
+  std::vector< std::set<uint64_t> > adj(s_num_vertices);
+  for(size_t i = 0; i < edges.size(); ++i) {
+    if(edges[i].first != edges[i].second) {
+      adj[edges[i].first].insert(edges[i].second);
+      adj[edges[i].second].insert(edges[i].first);
+    }
+  }
+  uint64_t count = 0;
+  for(uint64_t u = 0; u < s_num_vertices; ++u) {
+    for(uint64_t v : adj[u]) {
+      if(v <= u) continue;
+      for(uint64_t w : adj[v]) {
+        if(w > v && adj[u].count(w)) {
+          ++count;
+        }
+      }
+    }
+  }
+  return count;
+}
+
+TEST(triangle_count, repeated_edges_counted_once) {
+  const int mpi_rank = havoqgt_env()->world_comm().rank();
+  const int mpi_size = havoqgt_env()->world_comm().size();
+  const std::vector<edge_type> edges = all_edges();
+
+  std::vector<edge_type> my_edges;
+  for(size_t i = 0; i < edges.size(); ++i) {
+    if(int(i % mpi_size) == mpi_rank) {
+      my_edges.push_back(edges[i]);
+      my_edges.push_back(edge_type(edges[i].second, edges[i].first));
+    }
+  }
+  bip::managed_heap_memory heap(uint64_t(1) << 24);
+  bip::allocator<void, segment_manager_t> alloc_inst(
+      heap.get_segment_manager());
+  graph_type* graph = heap.construct<graph_type>("graph_obj")
+      (alloc_inst, MPI_COMM_WORLD, my_edges, s_num_vertices - 1, 64);
+  ASSERT_GT(graph->num_delegates(), 1u);
+
+  EXPECT_EQ(reference_count(edges), mpi::triangle_count_sorted(*graph));
+}
+
+TEST(triangle_count, added_edges_merged_with_csr) {
+  const int mpi_rank = havoqgt_env()->world_comm().rank();
+  const int mpi_size = havoqgt_env()->world_comm().size();
+  const std::vector<edge_type> edges = all_edges();
+
+  // The last twentieth of the edges is added, staying below the default
+  // HAVOQGT_DELTA_COMPACT_PERCENT so it is not compacted.
+  std::vector<edge_type> built, added;
+  for(size_t i = 0; i < edges.size(); ++i) {
+    if(int(i % mpi_size) == mpi_rank) {
+      std::vector<edge_type>& part = i < edges.size() / 20 * 19
+          ? built : added;
+      part.push_back(edges[i]);
+      part.push_back(edge_type(edges[i].second, edges[i].first));
+    }
+  }
+  bip::managed_heap_memory heap(uint64_t(1) << 24);
+  bip::allocator<void, segment_manager_t> alloc_inst(
+      heap.get_segment_manager());
+  graph_type* graph = heap.construct<graph_type>("graph_obj")
+      (alloc_inst, MPI_COMM_WORLD, built, s_num_vertices - 1, 64);
+  graph->add_edges(alloc_inst, MPI_COMM_WORLD, added);
+  ASSERT_GT(mpi::mpi_all_reduce(uint64_t(graph->delta_size()),
+                                std::plus<uint64_t>(), MPI_COMM_WORLD), 0u);
+
+  EXPECT_EQ(reference_count(edges), mpi::triangle_count_sorted(*graph));
+}
+
+}} //end namespace havoqgt::test
+
+//mpi main for gteset
+GTEST_API_ int main(int argc, char **argv) {
+  havoqgt::havoqgt_init(&argc, &argv);
+  std::cout << "Running main() from gtest_main.cc\n";
+
+  testing::InitGoogleTest(&argc, argv);
+  int to_return = RUN_ALL_TESTS();
+  havoqgt::havoqgt_finalize();
+  return to_return;
+}